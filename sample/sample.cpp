@@ -1,6 +1,8 @@
+#include <chrono>
 #include <cstddef>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -12,6 +14,7 @@
 #include "lua/lua_engine/lua_binding_class.h"
 #include "lua/lua_engine/lua_binding_mgr.h"
 #include "lua/lua_engine/lua_binding_namespace.h"
+#include "lua/lua_engine/lua_binding_value_class.h"
 #include "lua/lua_engine/lua_engine.h"
 
 #include <common/file_system.h>
@@ -107,14 +110,22 @@ namespace script {
     }     // namespace lua
 } // namespace script
 
-int main(int argc, char *argv[]) {
-    script::lua::lua_engine::ptr_t lua_engine = script::lua::lua_engine::create();
-    lua_engine->add_on_inited([&lua_engine](lua_State *) {
+// 测试接口中需要访问sample的lua_engine
+static script::lua::lua_engine *sample_engine = NULL;
+
+static void sample_setup_engine(script::lua::lua_engine *engine) {
+    engine->add_on_inited([engine](lua_State *) {
         // 初始化完成后加载扩展库
-        lua_engine->add_ext_lib(script::lua::lua_profile_openlib);
-        lua_engine->add_ext_lib(script::lua::lua_table_ext_openlib);
-        lua_engine->add_ext_lib(script::lua::lua_time_ext_openlib);
+        engine->add_ext_lib(script::lua::lua_profile_openlib);
+        engine->add_ext_lib(script::lua::lua_table_ext_openlib);
+        engine->add_ext_lib(script::lua::lua_time_ext_openlib);
     });
+}
+
+int main(int argc, char *argv[]) {
+    script::lua::lua_engine::ptr_t lua_engine = script::lua::lua_engine::create();
+    sample_engine = lua_engine.get();
+    sample_setup_engine(lua_engine.get());
 
     // 对象池管理器初始化
     lua_engine->init();
@@ -137,10 +148,12 @@ int main(int argc, char *argv[]) {
         lua_engine->run_code(code.c_str());
         code.clear();
 
-        // 定期调用 lua_engine->proc(); 或 lua_binding_mgr::me()->proc(); 后者会对所有注册的lua_State做处理
+        // 定期调用 lua_engine->proc(); 或 lua_binding_mgr::me()->proc(); 后者会对当前线程所属的所有lua_State做处理
         // 对C++层的对象回收将会在这里进行
         lua_engine->proc();
     }
+
+    sample_engine = NULL;
     return 0;
 }
 
@@ -181,3 +194,357 @@ LUA_BIND_OBJECT(sample_class, L) {
         clazz.add_method("print_map", &sample_class::print_map);
     }
 }
+
+// ============================ 快照的测试接口 ============================
+// 在新的lua_engine中执行初始化代码并保存快照，再恢复到另一个lua_engine中，返回恢复后sample_snapshot.check()的结果
+static std::string sample_snapshot_roundtrip(const std::string &init_code) {
+    std::string ret;
+
+    std::string data;
+    {
+        script::lua::lua_engine::ptr_t origin = script::lua::lua_engine::create();
+        sample_setup_engine(origin.get());
+        origin->init();
+        if (!origin->run_code(init_code.c_str())) {
+            return ret;
+        }
+
+        if (0 != origin->save_snapshot(data)) {
+            std::cerr << "save snapshot failed: " << data << std::endl;
+            return ret;
+        }
+    }
+
+    script::lua::lua_engine::ptr_t restored = script::lua::lua_engine::create();
+    sample_setup_engine(restored.get());
+    restored->init();
+    if (0 != restored->restore_snapshot(data)) {
+        std::cerr << "restore snapshot failed" << std::endl;
+        return ret;
+    }
+
+    lua_State *L = restored->get_lua_state();
+    script::lua::lua_auto_block block(L);
+    if (restored->auto_call(std::string("sample_snapshot.check")) > 0 && lua_isstring(L, -1)) {
+        ret = lua_tostring(L, -1);
+    }
+    return ret;
+}
+
+LUA_BIND_OBJECT(sample_snapshot, L) {
+    script::lua::lua_binding_namespace ns("game.sample", L);
+    ns.add_method("snapshot_roundtrip", sample_snapshot_roundtrip);
+}
+
+// ============================ 定时器调度的测试接口 ============================
+// 固定步长(毫秒)、一帧的时间预算(微秒，0表示不限制)，不限制一帧的步数
+static void sample_tick_setup(int step_ms, int budget_us) {
+    if (NULL == sample_engine) {
+        return;
+    }
+
+    const script::lua::lua_tick_scheduler::ptr_t &scheduler = sample_engine->get_tick_scheduler();
+    scheduler->set_fixed_step(std::chrono::milliseconds(step_ms));
+    scheduler->set_max_steps(0);
+    scheduler->set_frame_budget(std::chrono::microseconds(budget_us));
+}
+
+static uint32_t sample_tick(float delta) { return NULL == sample_engine ? 0 : sample_engine->tick(delta); }
+
+static uint64_t sample_tick_stat(const std::string &name) {
+    if (NULL == sample_engine || !sample_engine->get_tick_scheduler()) {
+        return 0;
+    }
+
+    const script::lua::lua_tick_scheduler::stats_t &stats = sample_engine->get_tick_scheduler()->get_stats();
+    if ("fired" == name) {
+        return stats.fired_count;
+    } else if ("coalesced" == name) {
+        return stats.coalesced_count;
+    } else if ("deferred" == name) {
+        return stats.deferred_count;
+    } else if ("error" == name) {
+        return stats.error_count;
+    }
+
+    return 0;
+}
+
+LUA_BIND_OBJECT(sample_tick_scheduler, L) {
+    script::lua::lua_binding_namespace ns("game.sample", L);
+    ns.add_method("tick_setup", sample_tick_setup);
+    ns.add_method("tick", sample_tick);
+    ns.add_method("tick_stat", sample_tick_stat);
+}
+
+// ============================ 引用缓存的测试接口 ============================
+// 引用缓存中的对象在proc()时释放
+static size_t sample_ref_cache_size(lua_State *L) {
+    return script::lua::lua_binding_class_mgr_inst<sample_class>::me()->get_ref_cache_size(L);
+}
+
+static size_t sample_ref_cache_peak(lua_State *L) {
+    return script::lua::lua_binding_class_mgr_inst<sample_class>::me()->get_ref_cache_peak(L);
+}
+
+static void sample_proc() {
+    if (NULL != sample_engine) {
+        sample_engine->proc();
+    }
+}
+
+LUA_BIND_OBJECT(sample_ref_cache, L) {
+    script::lua::lua_binding_namespace ns("game.sample", L);
+    ns.add_method("ref_cache_size", sample_ref_cache_size);
+    ns.add_method("ref_cache_peak", sample_ref_cache_peak);
+    ns.add_method("proc", sample_proc);
+}
+
+// ============================ 所有权模式的测试接口 ============================
+// C++中持有的对象，lua中通过push拿到，通过reset/invalidate/destroy让lua中的对象失效
+template <typename TC>
+static int64_t sample_live_objects(lua_State *L) {
+    return script::lua::lua_binding_class_mgr_inst<TC>::me()->get_live_objects(L);
+}
+
+// 弱引用模式(默认)
+static std::shared_ptr<sample_class> sample_weak_obj;
+
+static std::shared_ptr<sample_class> sample_weak_push() {
+    if (!sample_weak_obj) {
+        sample_weak_obj = std::make_shared<sample_class>();
+    }
+    return sample_weak_obj;
+}
+
+static void sample_weak_reset() { sample_weak_obj.reset(); }
+
+// 句柄模式，析构时计数，用于在lua中检查对象是否被释放
+static int sample_handle_destroyed_count = 0;
+
+class sample_handle_object {
+public:
+    sample_handle_object() : v_(0) {}
+    ~sample_handle_object() { ++sample_handle_destroyed_count; }
+
+    int get() const { return v_; }
+    void set(int v) { v_ = v; }
+
+private:
+    int v_;
+};
+
+LUA_BINDING_DECLARE_OWNERSHIP(sample_handle_object, ::script::lua::lua_binding_ownership_handle)
+
+static std::shared_ptr<sample_handle_object> sample_handle_obj;
+
+static std::shared_ptr<sample_handle_object> sample_handle_push() {
+    if (!sample_handle_obj) {
+        sample_handle_obj = std::make_shared<sample_handle_object>();
+    }
+    return sample_handle_obj;
+}
+
+static bool sample_handle_invalidate(lua_State *L) {
+    return sample_handle_obj && script::lua::fn::invalidate_handle(L, sample_handle_obj.get());
+}
+
+static void sample_handle_reset() { sample_handle_obj.reset(); }
+
+static int sample_handle_destroyed() { return sample_handle_destroyed_count; }
+
+LUA_BIND_OBJECT(sample_handle_object, L) {
+    {
+        script::lua::lua_binding_class<sample_handle_object> clazz("sample_handle_object", "game.sample", L);
+        clazz.set_default_new<>();
+        clazz.add_method("get", &sample_handle_object::get);
+        clazz.add_method("set", &sample_handle_object::set);
+    }
+
+    {
+        script::lua::lua_binding_namespace ns("game.sample", L);
+        ns.add_method("weak_push", sample_weak_push);
+        ns.add_method("weak_reset", sample_weak_reset);
+        ns.add_method("weak_live_objects", sample_live_objects<sample_class>);
+        ns.add_method("handle_push", sample_handle_push);
+        ns.add_method("handle_invalidate", sample_handle_invalidate);
+        ns.add_method("handle_reset", sample_handle_reset);
+        ns.add_method("handle_destroyed", sample_handle_destroyed);
+        ns.add_method("handle_live_objects", sample_live_objects<sample_handle_object>);
+    }
+}
+
+// 侵入式引用计数模式
+static int sample_intrusive_destroyed_count = 0;
+
+class sample_intrusive_object : public script::lua::lua_intrusive_object<sample_intrusive_object> {
+public:
+    sample_intrusive_object() : v_(0) {}
+    ~sample_intrusive_object() { ++sample_intrusive_destroyed_count; }
+
+    int get() const { return v_; }
+    void set(int v) { v_ = v; }
+
+private:
+    int v_;
+};
+
+LUA_BINDING_DECLARE_OWNERSHIP(sample_intrusive_object, ::script::lua::lua_binding_ownership_intrusive)
+
+static script::lua::lua_intrusive_ptr<sample_intrusive_object> sample_intrusive_obj;
+
+static script::lua::lua_intrusive_ptr<sample_intrusive_object> sample_intrusive_push() {
+    if (!sample_intrusive_obj) {
+        sample_intrusive_obj.reset(new sample_intrusive_object());
+    }
+    return sample_intrusive_obj;
+}
+
+static void sample_intrusive_reset() { sample_intrusive_obj.reset(); }
+
+static int sample_intrusive_destroyed() { return sample_intrusive_destroyed_count; }
+
+LUA_BIND_OBJECT(sample_intrusive_object, L) {
+    {
+        script::lua::lua_binding_class<sample_intrusive_object> clazz("sample_intrusive_object", "game.sample", L);
+        clazz.set_default_new<>();
+        clazz.add_method("get", &sample_intrusive_object::get);
+        clazz.add_method("set", &sample_intrusive_object::set);
+    }
+
+    {
+        script::lua::lua_binding_namespace ns("game.sample", L);
+        ns.add_method("intrusive_push", sample_intrusive_push);
+        ns.add_method("intrusive_reset", sample_intrusive_reset);
+        ns.add_method("intrusive_destroyed", sample_intrusive_destroyed);
+        ns.add_method("intrusive_live_objects", sample_live_objects<sample_intrusive_object>);
+    }
+}
+
+// 值类型模式，平凡析构，不设置__gc
+struct sample_vec2 {
+    float x;
+    float y;
+
+    float get_x() const { return x; }
+    float get_y() const { return y; }
+    float length_sq() const { return x * x + y * y; }
+    void scale(float s) {
+        x *= s;
+        y *= s;
+    }
+};
+
+LUA_BINDING_DECLARE_OWNERSHIP(sample_vec2, ::script::lua::lua_binding_ownership_value)
+
+static sample_vec2 sample_vec2_obj = {1.0f, 2.0f};
+
+static sample_vec2 sample_vec2_add(sample_vec2 l, sample_vec2 r) {
+    sample_vec2 ret;
+    ret.x = l.x + r.x;
+    ret.y = l.y + r.y;
+    return ret;
+}
+
+static sample_vec2 sample_make_vec2(float x, float y) {
+    sample_vec2 ret;
+    ret.x = x;
+    ret.y = y;
+    return ret;
+}
+
+// 入栈的是副本，lua中修改不影响C++中的对象
+static sample_vec2 sample_vec2_get() { return sample_vec2_obj; }
+
+static float sample_vec2_get_x() { return sample_vec2_obj.x; }
+
+LUA_BIND_OBJECT(sample_vec2, L) {
+    {
+        script::lua::lua_binding_value_class<sample_vec2> clazz("sample_vec2", "game.sample", L);
+        clazz.set_default_new<>();
+        clazz.add_method("get_x", &sample_vec2::get_x);
+        clazz.add_method("get_y", &sample_vec2::get_y);
+        clazz.add_method("length_sq", &sample_vec2::length_sq);
+        clazz.add_method("scale", &sample_vec2::scale);
+        clazz.add_meta_method("__add", sample_vec2_add);
+    }
+
+    {
+        script::lua::lua_binding_namespace ns("game.sample", L);
+        ns.add_method("make_vec2", sample_make_vec2);
+        ns.add_method("vec2_get", sample_vec2_get);
+        ns.add_method("vec2_get_x", sample_vec2_get_x);
+        ns.add_method("vec2_live_objects", sample_live_objects<sample_vec2>);
+    }
+}
+
+// 借用模式，对象由C++管理
+class sample_world : public script::lua::lua_borrowable_object {
+public:
+    sample_world() : frame_(0) {}
+
+    int tick() { return ++frame_; }
+    int frame() const { return frame_; }
+
+private:
+    int frame_;
+};
+
+LUA_BINDING_DECLARE_OWNERSHIP(sample_world, ::script::lua::lua_binding_ownership_borrowed)
+
+static std::unique_ptr<sample_world> sample_borrowed_obj;
+
+static sample_world *sample_borrowed_push() {
+    if (!sample_borrowed_obj) {
+        sample_borrowed_obj.reset(new sample_world());
+    }
+    return sample_borrowed_obj.get();
+}
+
+static void sample_borrowed_destroy() { sample_borrowed_obj.reset(); }
+
+LUA_BIND_OBJECT(sample_world, L) {
+    {
+        // 借用模式没有new，只能由C++入栈
+        script::lua::lua_binding_class<sample_world> clazz("sample_world", "game.sample", L);
+        clazz.add_method("tick", &sample_world::tick);
+        clazz.add_method("frame", &sample_world::frame);
+    }
+
+    {
+        script::lua::lua_binding_namespace ns("game.sample", L);
+        ns.add_method("borrowed_push", sample_borrowed_push);
+        ns.add_method("borrowed_destroy", sample_borrowed_destroy);
+        ns.add_method("world_live_objects", sample_live_objects<sample_world>);
+    }
+}
+
+// ============================ 指令预算的测试接口 ============================
+// 在预算调用中创建协程，预算调用返回后不经过预算直接恢复，返回协程的结果和超出预算的次数
+static std::string sample_budget_coroutine(int budget) {
+    script::lua::lua_engine::ptr_t engine = script::lua::lua_engine::create();
+    sample_setup_engine(engine.get());
+    engine->init();
+    engine->set_instruction_budget(static_cast<size_t>(budget));
+
+    // 预算内的调用，超出预算时报错
+    engine->run_code("local n = 0 for i = 1, 100000 do n = n + i end");
+    if (!engine->run_code("sample_budget_co = coroutine.create(function() local n = 0 for i = 1, 100000 do n = n + i end return n end)")) {
+        return std::string();
+    }
+
+    lua_State *L = engine->get_lua_state();
+    script::lua::lua_engine::run_code(L, "local ok, n = coroutine.resume(sample_budget_co) sample_budget_ret = ok and string.format('%.0f', n) or tostring(n)");
+
+    script::lua::lua_auto_block block(L);
+    lua_getglobal(L, "sample_budget_ret");
+    std::string ret = lua_isstring(L, -1) ? lua_tostring(L, -1) : "nil";
+    ret += ",";
+    ret += std::to_string(engine->get_budget_stats().instruction_breach_count);
+    return ret;
+}
+
+LUA_BIND_OBJECT(sample_budget, L) {
+    script::lua::lua_binding_namespace ns("game.sample", L);
+    ns.add_method("budget_coroutine", sample_budget_coroutine);
+}
@@ -45,4 +45,201 @@ vardump(ntb)
 
 print('============================ time_ext ============================')
 print(string.format('time_ext.now_ms() = %d', time_ext.now_ms()))
-print(string.format('time_ext.now_us() = %d', time_ext.now_us()))
\ No newline at end of file
+print(string.format('time_ext.now_us() = %d', time_ext.now_us()))
+
+print('============================ snapshot ============================')
+local sample = game.sample
+if _VERSION == 'Lua 5.1' then
+    print('snapshot is not supported in ' .. _VERSION)
+else
+    -- 快照在新的lua_State中生成，init_code相当于服务器启动时执行的初始化脚本
+    local init_code = [[
+        local shared = { 1, 2, 3 }
+        local counter = 10
+        sample_snapshot = {
+            list = shared,
+            alias = shared,
+            next_id = function()
+                counter = counter + 1
+                return counter
+            end,
+        }
+        sample_snapshot.self = sample_snapshot
+        sample_snapshot.check = function()
+            local s = sample_snapshot
+            assert(s.self == s)
+            assert(s.list == s.alias and #s.list == 3)
+            assert(getmetatable(game.logic.sample_class) == getmetatable(game.logic.sample_class))
+            return string.format('%d,%d', s.next_id(), s.next_id())
+        end
+    ]]
+    assert(sample.snapshot_roundtrip(init_code) == '11,12')
+    print('snapshot ok')
+end
+
+print('============================ tick scheduler ============================')
+sample.tick_setup(10, 0)
+local fired, elapsed = 0, 0
+local loop_id = tick_scheduler.add_timer(10, function(e)
+    fired = fired + 1
+    elapsed = e
+end, 1, true)
+-- 一帧推进10步，循环定时器错过的周期合并为一次触发
+local coalesced = sample.tick_stat('coalesced')
+assert(sample.tick(0.1) == 10)
+assert(fired == 1)
+assert(math.abs(elapsed - 0.1) < 0.0001)
+assert(sample.tick_stat('coalesced') == coalesced + 9)
+assert(tick_scheduler.remove_timer(loop_id))
+assert(not pcall(tick_scheduler.add_timer, 10, function() end, 3))
+
+-- 帧预算只有1微秒，关键通道中的完整GC必定超出预算
+-- 超出帧预算后，普通通道至少触发一个，可推迟通道留到下一帧
+sample.tick_setup(10, 1)
+local order = {}
+local function record(tag, gc)
+    return function()
+        table.insert(order, tag)
+        if gc then
+            collectgarbage()
+        end
+    end
+end
+tick_scheduler.add_timer(10, record('critical1', true), 0)
+tick_scheduler.add_timer(10, record('critical2', true), 0)
+tick_scheduler.add_timer(10, record('normal1'), 1)
+tick_scheduler.add_timer(10, record('normal2'), 1)
+tick_scheduler.add_timer(10, record('deferrable'), 2)
+local deferred = sample.tick_stat('deferred')
+sample.tick(0.01)
+assert(table.concat(order, ',') == 'critical1,critical2,normal1')
+assert(sample.tick_stat('deferred') == deferred + 2)
+sample.tick_setup(10, 0)
+sample.tick(0)
+assert(table.concat(order, ',') == 'critical1,critical2,normal1,normal2,deferrable')
+print('tick scheduler ok')
+
+print('============================ ref cache ============================')
+sample.proc()
+assert(sample.ref_cache_size() == 0)
+local objs = {}
+for i = 1, 16 do
+    objs[i] = game.logic.sample_class.new()
+end
+assert(sample.ref_cache_size() == 16)
+assert(sample.ref_cache_peak() >= 16)
+objs = nil
+sample.proc()
+assert(sample.ref_cache_size() == 0)
+collectgarbage()
+print('ref cache ok')
+
+print('============================ ownership: weak ============================')
+local weak_obj = sample.weak_push()
+weak_obj:set_m(5)
+assert(weak_obj:get_m() == 5)
+assert(sample.weak_push():get_m() == 5)
+-- C++释放后lua中的弱引用失效，调用成员方法会输出错误日志并返回nil
+sample.weak_reset()
+assert(weak_obj:get_m() == nil)
+weak_obj = nil
+collectgarbage()
+
+-- new出来的对象在引用缓存中，下一次proc()后只剩lua中的弱引用
+local live = sample.weak_live_objects()
+local cached_obj = game.logic.sample_class.new()
+cached_obj:set_m(7)
+assert(sample.weak_live_objects() == live + 1)
+sample.proc()
+assert(cached_obj:get_m() == nil)
+cached_obj = nil
+collectgarbage()
+assert(sample.weak_live_objects() == live)
+print('weak ok')
+
+print('============================ ownership: handle ============================')
+local destroyed = sample.handle_destroyed()
+local handle_obj = sample.handle_push()
+handle_obj:set(11)
+assert(handle_obj:get() == 11)
+-- 使句柄失效后，即使C++仍然持有对象，lua中也不能再访问
+assert(sample.handle_invalidate())
+assert(handle_obj:get() == nil)
+sample.handle_reset()
+assert(sample.handle_destroyed() == destroyed + 1)
+
+-- 没有失效的句柄持有对象，lua中的userdata全部回收后才释放
+handle_obj = sample.handle_push()
+handle_obj:set(12)
+sample.handle_reset()
+assert(handle_obj:get() == 12)
+assert(sample.handle_destroyed() == destroyed + 1)
+handle_obj = nil
+collectgarbage()
+assert(sample.handle_destroyed() == destroyed + 2)
+assert(sample.handle_live_objects() == 0)
+print('handle ok')
+
+print('============================ ownership: intrusive ============================')
+local intrusive_destroyed = sample.intrusive_destroyed()
+local intrusive_obj = sample.intrusive_push()
+intrusive_obj:set(21)
+-- userdata持有引用，C++释放后对象仍然有效
+sample.intrusive_reset()
+assert(intrusive_obj:get() == 21)
+assert(sample.intrusive_destroyed() == intrusive_destroyed)
+intrusive_obj = nil
+collectgarbage()
+assert(sample.intrusive_destroyed() == intrusive_destroyed + 1)
+
+-- new出来的对象不经过引用缓存
+intrusive_obj = game.sample.sample_intrusive_object.new()
+intrusive_obj:set(22)
+sample.proc()
+assert(intrusive_obj:get() == 22)
+intrusive_obj = nil
+collectgarbage()
+assert(sample.intrusive_destroyed() == intrusive_destroyed + 2)
+assert(sample.intrusive_live_objects() == 0)
+print('intrusive ok')
+
+print('============================ ownership: value ============================')
+local v1 = sample.make_vec2(3, 4)
+assert(v1:length_sq() == 25)
+local v2 = v1 + v1
+assert(v2:get_x() == 6 and v2:get_y() == 8)
+-- 成员方法修改的是userdata中的对象
+v1:scale(2)
+assert(v1:get_x() == 6)
+-- 入栈的是副本
+local v3 = sample.vec2_get()
+v3:scale(10)
+assert(sample.vec2_get_x() == 1)
+assert(game.sample.sample_vec2.new():length_sq() == 0)
+-- 平凡析构的值类型没有__gc，也不计入存活对象数
+assert(sample.vec2_live_objects() == 0)
+v1, v2, v3 = nil, nil, nil
+collectgarbage()
+print('value ok')
+
+print('============================ ownership: borrowed ============================')
+local world = sample.borrowed_push()
+assert(world:tick() == 1)
+assert(sample.borrowed_push():frame() == 1)
+-- C++销毁对象后令牌失效
+sample.borrowed_destroy()
+assert(world:frame() == nil)
+-- 新对象即使复用了相同的地址，旧的借用指针也不会生效
+local new_world = sample.borrowed_push()
+assert(new_world:frame() == 0)
+assert(world:frame() == nil)
+sample.borrowed_destroy()
+world, new_world = nil, nil
+collectgarbage()
+assert(sample.world_live_objects() == 0)
+print('borrowed ok')
+
+print('============================ instruction budget ============================')
+-- 第一次调用超出预算，协程在预算调用返回后恢复时不受限制
+assert(sample.budget_coroutine(1000) == '5000050000,1')
+print('instruction budget ok')
@@ -83,6 +83,16 @@ function loader.clear()
     package.loaded['utils.class'] = nil
     package.loaded['utils.loader'] = nil
     package.loaded['utils.event'] = nil
+
+    -- 清空后可能新增了文件，丢弃native路径解析缓存中"找不到"的记录
+    if package.resolver_flush then
+        package.resolver_flush(true)
+    end
+
+    -- 模块重新加载后全局对象会变化，native中缓存的lua_item_path的值需要失效
+    if package.item_path_invalidate then
+        package.item_path_invalidate()
+    end
     
     -- vardump(package.loaded, {ostream = log_stream, recursive = 1})
 
@@ -112,6 +122,16 @@ function loader.smart_reload()
     end
 end
 
+--增量重加载，只重新加载修改过的模块和依赖它们的模块
+--需要native层开启lua_engine::enable_reload_mgr，否则等同于smart_reload
+function loader.incremental_reload()
+    if package.reload_changed then
+        return package.reload_changed()
+    end
+
+    loader.smart_reload()
+end
+
 -- 安全预加载模块, 不允许加载userdata
 -- 不会被clear清空
 function loader.preload(modname)
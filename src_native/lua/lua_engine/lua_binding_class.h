@@ -41,7 +41,8 @@ namespace script {
             typedef typename lua_binding_userdata_info<value_type>::userdata_type userdata_type;
             typedef typename lua_binding_userdata_info<proxy_type>::pointer_type pointer_type;
             typedef typename lua_binding_userdata_info<proxy_type>::userdata_ptr_type userdata_ptr_type;
-            typedef std::function<int(lua_State *, pointer_type)> member_proxy_method_t;
+            typedef typename lua_binding_userdata_info<proxy_type>::ownership_type ownership_type;
+            typedef std::function<int(lua_State *, proxy_type *)> member_proxy_method_t;
 
 
             enum FUNC_TYPE {
@@ -205,14 +206,14 @@ namespace script {
                 lua_pushstring(state, func_name);
 
                 member_proxy_method_t *fn_ptr = lua_binding_placement_new_and_delete<member_proxy_method_t>::create(state);
-                *fn_ptr = [fn](lua_State *L, pointer_type pobj) {
+                *fn_ptr = [fn](lua_State *L, proxy_type *pobj) {
 #if defined(LIBATFRAME_UTILS_ENABLE_RTTI) && LIBATFRAME_UTILS_ENABLE_RTTI
-                    return detail::unwraper_member_fn<R, TClass, TParam...>::LuaCFunction(L, dynamic_cast<TClass *>(pobj.get()), fn);
+                    return detail::unwraper_member_fn<R, TClass, TParam...>::LuaCFunction(L, dynamic_cast<TClass *>(pobj), fn);
 #else
-                    return detail::unwraper_member_fn<R, TClass, TParam...>::LuaCFunction(L, static_cast<TClass *>(pobj.get()), fn);
+                    return detail::unwraper_member_fn<R, TClass, TParam...>::LuaCFunction(L, static_cast<TClass *>(pobj), fn);
 #endif
                 };
-                lua_pushcclosure(state, __member_method_unwrapper, 1);
+                push_member_method_closure(state);
                 lua_settable(state, get_member_table());
 
                 return (*this);
@@ -237,14 +238,14 @@ namespace script {
                 lua_pushstring(state, func_name);
 
                 member_proxy_method_t *fn_ptr = lua_binding_placement_new_and_delete<member_proxy_method_t>::create(state);
-                *fn_ptr = [fn](lua_State *L, pointer_type pobj) {
+                *fn_ptr = [fn](lua_State *L, proxy_type *pobj) {
 #if defined(LIBATFRAME_UTILS_ENABLE_RTTI) && LIBATFRAME_UTILS_ENABLE_RTTI
-                    return detail::unwraper_member_fn<R, TClass, TParam...>::LuaCFunction(L, dynamic_cast<TClass *>(pobj.get()), fn);
+                    return detail::unwraper_member_fn<R, TClass, TParam...>::LuaCFunction(L, dynamic_cast<TClass *>(pobj), fn);
 #else
-                    return detail::unwraper_member_fn<R, TClass, TParam...>::LuaCFunction(L, static_cast<TClass *>(pobj.get()), fn);
+                    return detail::unwraper_member_fn<R, TClass, TParam...>::LuaCFunction(L, static_cast<TClass *>(pobj), fn);
 #endif
                 };
-                lua_pushcclosure(state, __member_method_unwrapper, 1);
+                push_member_method_closure(state);
                 lua_settable(state, get_member_table());
 
                 return (*this);
@@ -389,7 +390,8 @@ namespace script {
             void finish_class() {
                 if (NULL == default_funcs_[FT_TOSTRING]) set_to_string(__tostring);
 
-                if (NULL == default_funcs_[FT_GC]) set_gc(__lua_gc);
+                // 借用模式的对象不由lua管理，平凡析构的值类型也不需要析构，都不设置__gc
+                if (NULL == default_funcs_[FT_GC] && ownership_type::use_gc) set_gc(__lua_gc);
             }
 
             //================ 以下方法皆为lua接口，并提供给C++层使用 ================
@@ -403,13 +405,21 @@ namespace script {
              */
             template <typename... TParams>
             static pointer_type create(lua_State *L, TParams &&... params) {
-                pointer_type obj = std::make_shared<proxy_type>(std::forward<TParams>(params)...);
+                pointer_type obj = ownership_type::template create<TParams...>(std::forward<TParams>(params)...);
 
                 // 添加到缓存表，防止被立即析构
-                lua_binding_class_mgr_inst<proxy_type>::me()->add_ref(L, obj);
+                add_ref(L, obj, std::integral_constant<bool, ownership_type::use_ref_cache>());
                 return obj;
             }
 
+        private:
+            static void add_ref(lua_State *L, const pointer_type &obj, std::true_type) {
+                lua_binding_class_mgr_inst<proxy_type>::me()->add_ref(L, obj);
+            }
+
+            // lua userdata持有强引用的模式不需要引用缓存
+            static void add_ref(lua_State *, const pointer_type &, std::false_type) {}
+
         private:
             /**
              * __tostring 方法
@@ -430,7 +440,8 @@ namespace script {
 
                 std::stringstream ss;
                 userdata_ptr_type pobj = static_cast<userdata_ptr_type>(lua_touserdata(L, 1));
-                pointer_type real_ptr = pobj->lock();
+                typename ownership_type::holder_type holder;
+                const void *real_ptr = ownership_type::get(L, pobj, holder);
 
                 lua_pushliteral(L, "__type");
                 lua_gettable(L, -2);
@@ -450,7 +461,7 @@ namespace script {
                     ss << lua_tostring(L, -1);
                 else
                     ss << " unknown type";
-                ss << "] @" << real_ptr.get();
+                ss << "] @" << real_ptr;
 
                 std::string str = ss.str();
                 lua_pushlstring(L, str.c_str(), str.size());
@@ -482,7 +493,8 @@ namespace script {
 
                 // 析构
                 userdata_ptr_type pobj = static_cast<userdata_ptr_type>(lua_touserdata(L, 1));
-                pobj->~userdata_type();
+                ownership_type::destroy(L, pobj);
+                lua_binding_class_mgr_inst<proxy_type>::me()->remove_live_object(L);
 
                 return 0;
             }
@@ -500,6 +512,16 @@ namespace script {
             //    return 0;
             //}
 
+        protected:
+            /**
+             * @brief 把栈顶的member_proxy_method_t打包为成员方法闭包
+             * @note 第二个上值是所有权模式的上下文(句柄模式的槽位表)，调用时不需要再查找
+             */
+            static void push_member_method_closure(lua_State *L) {
+                lua_pushlightuserdata(L, ownership_type::get_method_context(L));
+                lua_pushcclosure(L, __member_method_unwrapper, 2);
+            }
+
             static int __member_method_unwrapper(lua_State *L) {
                 member_proxy_method_t *fn = reinterpret_cast<member_proxy_method_t *>(lua_touserdata(L, lua_upvalueindex(1)));
                 if (NULL == fn) {
@@ -517,7 +539,9 @@ namespace script {
                     return 0;
                 }
 
-                pointer_type obj_ptr = pobj->lock();
+                // 调用期间通过holder持有对象，句柄模式下只检查代数
+                typename ownership_type::holder_type holder;
+                proxy_type *obj_ptr = ownership_type::get(L, pobj, holder, lua_touserdata(L, lua_upvalueindex(2)));
                 lua_remove(L, 1);
 
                 if (!obj_ptr) {
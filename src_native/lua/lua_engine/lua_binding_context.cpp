@@ -0,0 +1,145 @@
+#include <cstdlib>
+
+extern "C" {
+#include "lauxlib.h"
+}
+
+#include "lua_binding_context.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            static char lua_binding_context_registry_key = 0;
+        } // namespace detail
+
+        std::atomic<uint64_t> lua_binding_context::state_id_seq_(0);
+        std::atomic<size_t> lua_binding_context::class_id_seq_(0);
+        std::atomic<size_t> lua_binding_context::handle_type_id_seq_(0);
+
+        lua_binding_context::lua_binding_context(constructor_helper &helper)
+            : state_(helper.L), state_id_(state_id_seq_.fetch_add(1, std::memory_order_relaxed) + 1), owner_thread_(std::this_thread::get_id()),
+              ref_peak_(0), key_count_(0), item_path_generation_(1) {}
+
+        // lua_State由lua_engine关闭，这里不再访问
+        lua_binding_context::~lua_binding_context() {}
+
+        lua_binding_context::ptr_t lua_binding_context::create(lua_State *L) {
+            if (NULL == L) {
+                return ptr_t();
+            }
+
+            constructor_helper helper;
+            helper.L = L;
+            return std::make_shared<lua_binding_context>(helper);
+        }
+
+        void lua_binding_context::add_ref(size_t class_id, const std::shared_ptr<void> &ptr) {
+            if (class_id >= ref_sizes_.size()) {
+                ref_sizes_.resize(class_id + 1, 0);
+                ref_peaks_.resize(class_id + 1, 0);
+            }
+
+            size_t &size = ref_sizes_[class_id];
+            if (0 == size) {
+                dirty_list_.push_back(class_id);
+            }
+            ++size;
+            if (size > ref_peaks_[class_id]) {
+                ref_peaks_[class_id] = size;
+            }
+
+            ref_arena_.push(ptr);
+            if (ref_arena_.size() > ref_peak_) {
+                ref_peak_ = ref_arena_.size();
+            }
+        }
+
+        size_t lua_binding_context::proc() {
+            if (ref_arena_.empty()) {
+                return 0;
+            }
+
+            for (size_t i = 0; i < dirty_list_.size(); ++i) {
+                ref_sizes_[dirty_list_[i]] = 0;
+            }
+            dirty_list_.clear();
+
+            // 析构对象时可能再次调用add_ref，计数已经清零，新的引用保留到下一次proc()
+            return ref_arena_.release();
+        }
+
+        size_t lua_binding_context::get_ref_cache_size(size_t class_id) const {
+            if (class_id >= ref_sizes_.size()) {
+                return 0;
+            }
+
+            return ref_sizes_[class_id];
+        }
+
+        size_t lua_binding_context::get_ref_cache_peak(size_t class_id) const {
+            if (class_id >= ref_peaks_.size()) {
+                return 0;
+            }
+
+            return ref_peaks_[class_id];
+        }
+
+        void lua_binding_context::reset_ref_cache_peak() {
+            // 当前周期还没有proc()，从当前的大小开始统计
+            ref_peaks_ = ref_sizes_;
+            ref_peak_  = ref_arena_.size();
+        }
+
+        void lua_binding_context::push_key(lua_State *L, const lua_interned_key &key) {
+            size_t id = key.get_id();
+            if (id < key_refs_.size() && LUA_NOREF != key_refs_[id]) {
+                lua_rawgeti(L, LUA_REGISTRYINDEX, key_refs_[id]);
+                return;
+            }
+
+            if (id >= key_refs_.size()) {
+                key_refs_.resize(id + 1, LUA_NOREF);
+            }
+
+            lua_pushlstring(L, key.get_key().data(), key.get_key().size());
+            lua_pushvalue(L, -1);
+            key_refs_[id] = luaL_ref(L, LUA_REGISTRYINDEX);
+            ++key_count_;
+        }
+
+        lua_binding_handle_table *lua_binding_context::get_handle_table(size_t type_id) {
+            if (type_id >= handle_tables_.size()) {
+                handle_tables_.resize(type_id + 1);
+            }
+
+            lua_binding_handle_table::ptr_t &table = handle_tables_[type_id];
+            if (!table) {
+                table = std::make_shared<lua_binding_handle_table>();
+            }
+
+            return table.get();
+        }
+
+        size_t lua_binding_context::alloc_class_id() { return class_id_seq_.fetch_add(1, std::memory_order_relaxed); }
+
+        size_t lua_binding_context::alloc_handle_type_id() { return handle_type_id_seq_.fetch_add(1, std::memory_order_relaxed); }
+
+        void lua_binding_context::bind(lua_State *L, lua_binding_context *ctx) {
+            lua_pushlightuserdata(L, &detail::lua_binding_context_registry_key);
+            if (NULL == ctx) {
+                lua_pushnil(L);
+            } else {
+                lua_pushlightuserdata(L, ctx);
+            }
+            lua_rawset(L, LUA_REGISTRYINDEX);
+        }
+
+        lua_binding_context *lua_binding_context::get(lua_State *L) {
+            lua_pushlightuserdata(L, &detail::lua_binding_context_registry_key);
+            lua_rawget(L, LUA_REGISTRYINDEX);
+            lua_binding_context *ret = reinterpret_cast<lua_binding_context *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+            return ret;
+        }
+    } // namespace lua
+} // namespace script
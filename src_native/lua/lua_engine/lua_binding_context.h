@@ -0,0 +1,199 @@
+#ifndef SCRIPT_LUA_LUABINDINGCONTEXT
+#define SCRIPT_LUA_LUABINDINGCONTEXT
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "lua.h"
+}
+
+#include <design_pattern/noncopyable.h>
+
+#include "lua_binding_handle.h"
+#include "lua_interned_key.h"
+#include "lua_ref_arena.h"
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 每个lua_State的绑定上下文
+         * 持有这个lua_State中所有绑定类的引用缓存，引用统一写入分块的lua_ref_arena，按类的编号记录数量和峰值
+         * @note 只能在运行这个lua_State的线程(所属线程)中使用，不加锁
+         * @note 通过bind绑定到lua_State后，同一个lua_State的所有协程都可以通过get获取
+         */
+        class lua_binding_context : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_binding_context> ptr_t;
+
+        private:
+            struct constructor_helper {
+                lua_State *L;
+            };
+
+        public:
+            lua_binding_context(constructor_helper &helper);
+            ~lua_binding_context();
+
+            static ptr_t create(lua_State *L);
+
+            inline lua_State *get_lua_state() const { return state_; }
+
+            /**
+             * @brief 获取lua_State的编号，进程内唯一且不会重用
+             * @note lua_State关闭后新的lua_State可能分配到相同的地址，需要区分lua_State时使用这个编号
+             */
+            inline uint64_t get_state_id() const { return state_id_; }
+
+            /**
+             * @brief 把调用线程设置为所属线程，lua_State交给其他线程运行时需要在新线程中调用
+             * @note 创建时和lua_binding_mgr::proc(engine)时会自动设置
+             */
+            inline void set_owner_thread() { owner_thread_.store(std::this_thread::get_id(), std::memory_order_relaxed); }
+
+            /**
+             * @brief 调用线程是否是所属线程
+             */
+            inline bool is_owner_thread() const { return owner_thread_.load(std::memory_order_relaxed) == std::this_thread::get_id(); }
+
+            /**
+             * @brief 添加引用，防止对象在下一次proc()前被析构
+             * @param class_id 由alloc_class_id分配的类编号
+             * @param ptr 对象
+             */
+            void add_ref(size_t class_id, const std::shared_ptr<void> &ptr);
+
+            /**
+             * @brief 清理引用缓存
+             * @return 清理的引用数
+             */
+            size_t proc();
+
+            /**
+             * @brief 记录创建了一个类的lua userdata
+             */
+            inline void add_live_object(size_t class_id) {
+                if (class_id >= live_objects_.size()) {
+                    live_objects_.resize(class_id + 1, 0);
+                }
+                ++live_objects_[class_id];
+            }
+
+            /**
+             * @brief 记录回收了一个类的lua userdata
+             */
+            inline void remove_live_object(size_t class_id) {
+                if (class_id < live_objects_.size()) {
+                    --live_objects_[class_id];
+                }
+            }
+
+            /**
+             * @brief 获取类的存活的lua userdata数
+             */
+            inline int64_t get_live_objects(size_t class_id) const { return class_id < live_objects_.size() ? live_objects_[class_id] : 0; }
+
+            /**
+             * @brief 获取类的引用缓存大小
+             */
+            size_t get_ref_cache_size(size_t class_id) const;
+
+            /**
+             * @brief 获取类的引用缓存在两次proc()之间的最大值
+             * @note 统计从上一次reset_ref_cache_peak()开始，lua_engine::proc()自动发布指标后会重置
+             */
+            size_t get_ref_cache_peak(size_t class_id) const;
+
+            /**
+             * @brief 获取所有类的引用缓存在两次proc()之间的最大值
+             * @note 统计从上一次reset_ref_cache_peak()开始，lua_engine::proc()自动发布指标后会重置
+             */
+            inline size_t get_ref_cache_peak() const { return ref_peak_; }
+
+            /**
+             * @brief 重置峰值统计，下一个统计周期从当前的引用缓存大小开始
+             */
+            void reset_ref_cache_peak();
+
+            /**
+             * @brief 释放引用缓存中空闲的块
+             */
+            inline void shrink_ref_cache() { ref_arena_.shrink(); }
+
+            /**
+             * @brief 把驻留的键入栈，第一次使用时保存为registry引用
+             * @param L 这个lua_State或它的协程
+             * @param key 驻留的键
+             */
+            void push_key(lua_State *L, const lua_interned_key &key);
+
+            /**
+             * @brief 获取已经缓存了registry引用的键数量
+             */
+            inline size_t get_key_count() const { return key_count_; }
+
+            /**
+             * @brief 获取lua_item_path缓存值的版本号
+             */
+            inline uint64_t get_item_path_generation() const { return item_path_generation_; }
+
+            /**
+             * @brief 使这个lua_State中所有lua_item_path缓存的值失效
+             */
+            inline void invalidate_item_paths() { ++item_path_generation_; }
+
+            /**
+             * @brief 获取句柄模式类型的槽位表，第一次使用时创建
+             * @param type_id 由alloc_handle_type_id分配的类型编号
+             */
+            lua_binding_handle_table *get_handle_table(size_t type_id);
+
+            /**
+             * @brief 分配类编号
+             */
+            static size_t alloc_class_id();
+
+            /**
+             * @brief 分配句柄模式的类型编号
+             */
+            static size_t alloc_handle_type_id();
+
+            static void bind(lua_State *L, lua_binding_context *ctx);
+
+            /**
+             * @brief 获取lua_State绑定的上下文
+             * @return 未绑定时返回NULL
+             */
+            static lua_binding_context *get(lua_State *L);
+
+        private:
+            lua_State *                  state_;
+            uint64_t                     state_id_;
+            std::atomic<std::thread::id> owner_thread_;
+            lua_ref_arena                ref_arena_;
+            std::vector<size_t>          ref_sizes_;  // 类编号 => 引用缓存大小
+            std::vector<size_t>          ref_peaks_;  // 类编号 => 引用缓存峰值
+            std::vector<size_t>          dirty_list_; // 有数据的缓存的类编号
+            size_t                       ref_peak_;
+            std::vector<int>             key_refs_; // 驻留键编号 => registry引用
+            size_t                       key_count_;
+            std::vector<int64_t>         live_objects_; // 类编号 => 存活的lua userdata数
+            uint64_t                     item_path_generation_;
+
+            std::vector<lua_binding_handle_table::ptr_t> handle_tables_; // 句柄类型编号 => 槽位表
+
+            static std::atomic<uint64_t> state_id_seq_;
+            static std::atomic<size_t> class_id_seq_;
+            static std::atomic<size_t> handle_type_id_seq_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
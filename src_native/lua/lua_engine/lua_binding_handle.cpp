@@ -0,0 +1,126 @@
+#include "lua_binding_handle.h"
+
+namespace script {
+    namespace lua {
+        lua_binding_handle_table::lua_binding_handle_table() {}
+
+        lua_binding_handle_table::~lua_binding_handle_table() { clear(); }
+
+        lua_binding_handle lua_binding_handle_table::acquire(const std::shared_ptr<void> &holder, void *ptr) {
+            lua_binding_handle ret;
+            std::unordered_map<const void *, uint32_t>::iterator iter = index_.find(ptr);
+            if (iter != index_.end()) {
+                slot_t &slot = slots_[iter->second];
+                ++slot.lua_refs;
+
+                ret.slot       = iter->second;
+                ret.generation = slot.generation;
+                return ret;
+            }
+
+            uint32_t index;
+            if (free_slots_.empty()) {
+                index = static_cast<uint32_t>(slots_.size());
+                slots_.push_back(slot_t());
+                slots_.back().ptr        = NULL;
+                slots_.back().generation = 1;
+                slots_.back().lua_refs   = 0;
+                slots_.back().pins       = 0;
+            } else {
+                index = free_slots_.back();
+                free_slots_.pop_back();
+            }
+
+            slot_t &slot  = slots_[index];
+            slot.holder   = holder;
+            slot.ptr      = ptr;
+            slot.lua_refs = 1;
+            index_[ptr]   = index;
+
+            ret.slot       = index;
+            ret.generation = slot.generation;
+            return ret;
+        }
+
+        void lua_binding_handle_table::release(const lua_binding_handle &handle) {
+            if (handle.slot >= slots_.size()) {
+                return;
+            }
+
+            slot_t &slot = slots_[handle.slot];
+            // 已经被invalidate的槽位不再处理
+            if (slot.generation != handle.generation || NULL == slot.ptr) {
+                return;
+            }
+
+            if (slot.lua_refs > 0) {
+                --slot.lua_refs;
+            }
+
+            if (0 == slot.lua_refs) {
+                free_slot(handle.slot);
+            }
+        }
+
+        void lua_binding_handle_table::unpin(uint32_t slot) {
+            if (slot >= slots_.size() || 0 == slots_[slot].pins) {
+                return;
+            }
+
+            // 执行期间被释放的槽位，最后一次解除占用时回收
+            if (0 == --slots_[slot].pins && NULL == slots_[slot].ptr) {
+                recycle_slot(slot);
+            }
+        }
+
+        std::shared_ptr<void> lua_binding_handle_table::lock(const lua_binding_handle &handle) const {
+            if (NULL == resolve(handle)) {
+                return std::shared_ptr<void>();
+            }
+
+            return slots_[handle.slot].holder;
+        }
+
+        bool lua_binding_handle_table::invalidate(const void *ptr) {
+            std::unordered_map<const void *, uint32_t>::iterator iter = index_.find(ptr);
+            if (iter == index_.end()) {
+                return false;
+            }
+
+            free_slot(iter->second);
+            return true;
+        }
+
+        void lua_binding_handle_table::clear() {
+            for (uint32_t i = 0; i < static_cast<uint32_t>(slots_.size()); ++i) {
+                if (NULL != slots_[i].ptr) {
+                    free_slot(i);
+                }
+            }
+        }
+
+        void lua_binding_handle_table::free_slot(uint32_t index) {
+            slot_t &slot = slots_[index];
+            index_.erase(slot.ptr);
+
+            // 先使所有句柄失效，成员方法执行中时对象保留到最后一次unpin
+            slot.ptr      = NULL;
+            slot.lua_refs = 0;
+            ++slot.generation;
+            if (0 == slot.generation) {
+                slot.generation = 1;
+            }
+
+            if (0 == slot.pins) {
+                recycle_slot(index);
+            }
+        }
+
+        void lua_binding_handle_table::recycle_slot(uint32_t index) {
+            // 对象析构时可能再次访问这个表，先更新状态再释放强引用
+            std::shared_ptr<void> holder;
+            holder.swap(slots_[index].holder);
+            free_slots_.push_back(index);
+        }
+    } // namespace lua
+} // namespace script
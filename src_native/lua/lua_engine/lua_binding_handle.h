@@ -0,0 +1,127 @@
+#ifndef SCRIPT_LUA_LUABINDINGHANDLE
+#define SCRIPT_LUA_LUABINDINGHANDLE
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 带代数的句柄，lua userdata中只保存这两个字段
+         */
+        struct lua_binding_handle {
+            uint32_t slot;
+            uint32_t generation;
+        };
+
+        /**
+         * 句柄槽位表
+         * 每个槽位持有对象的强引用和裸指针，槽位释放时代数加一，之前的句柄全部失效
+         * 检查句柄是否有效只需要比较代数，不需要原子操作
+         * 槽位在以下情况释放:
+         *   1. 引用这个槽位的所有lua userdata都被回收
+         *   2. 调用invalidate主动失效
+         * 成员方法执行期间会占用(pin)槽位，这时释放槽位只增加代数，强引用保留到最后一次unpin
+         * @note 每个lua_State的每个类型一个，只能在运行这个lua_State的线程中使用
+         */
+        class lua_binding_handle_table : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_binding_handle_table> ptr_t;
+
+        private:
+            struct slot_t {
+                std::shared_ptr<void> holder;
+                void *                ptr;
+                uint32_t              generation;
+                uint32_t              lua_refs; // 引用这个槽位的lua userdata数
+                uint32_t              pins;     // 执行中的成员方法数
+            };
+
+        public:
+            lua_binding_handle_table();
+            ~lua_binding_handle_table();
+
+            /**
+             * @brief 获取对象的句柄，同一个对象共享同一个槽位
+             * @param holder 对象的强引用
+             * @param ptr 对象指针
+             */
+            lua_binding_handle acquire(const std::shared_ptr<void> &holder, void *ptr);
+
+            /**
+             * @brief 占用槽位，占用期间槽位不会被重用，对象不会被释放
+             * @return 句柄对应的对象指针，句柄已失效时返回NULL且不占用
+             * @note 返回非NULL时需要和unpin配对使用
+             */
+            inline void *pin(const lua_binding_handle &handle) {
+                void *ret = resolve(handle);
+                if (NULL != ret) {
+                    ++slots_[handle.slot].pins;
+                }
+                return ret;
+            }
+
+            /**
+             * @brief 解除占用，槽位已经释放时在最后一次解除占用时释放对象
+             * @param slot 槽位，和pin时句柄的槽位相同(这时代数可能已经变化)
+             */
+            void unpin(uint32_t slot);
+
+            /**
+             * @brief 释放一个lua userdata的引用
+             */
+            void release(const lua_binding_handle &handle);
+
+            /**
+             * @brief 获取句柄对应的对象指针
+             * @return 句柄已失效时返回NULL
+             */
+            inline void *resolve(const lua_binding_handle &handle) const {
+                if (handle.slot >= slots_.size()) {
+                    return NULL;
+                }
+
+                const slot_t &slot = slots_[handle.slot];
+                return slot.generation == handle.generation ? slot.ptr : NULL;
+            }
+
+            /**
+             * @brief 获取句柄对应的对象的强引用
+             * @return 句柄已失效时返回空
+             */
+            std::shared_ptr<void> lock(const lua_binding_handle &handle) const;
+
+            /**
+             * @brief 使对象的所有句柄失效，并释放槽位持有的强引用
+             * @return 对象存在时返回true
+             */
+            bool invalidate(const void *ptr);
+
+            /**
+             * @brief 获取使用中的槽位数
+             */
+            inline size_t size() const { return index_.size(); }
+
+            void clear();
+
+        private:
+            void free_slot(uint32_t slot);
+            void recycle_slot(uint32_t slot);
+
+        private:
+            std::vector<slot_t>                        slots_;
+            std::vector<uint32_t>                      free_slots_;
+            std::unordered_map<const void *, uint32_t> index_; // 对象指针 => 槽位
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
@@ -6,10 +6,54 @@
 
 namespace script {
     namespace lua {
-        lua_binding_class_mgr_base::lua_binding_class_mgr_base() { lua_binding_mgr::me()->lua_states_.push_back(this); }
+        lua_binding_class_mgr_base::lua_binding_class_mgr_base() : class_id_(lua_binding_context::alloc_class_id()) {
+            ::util::lock::write_lock_holder< ::util::lock::spin_rw_lock> wlh(lua_binding_mgr::me()->lua_states_lock_);
+            lua_binding_mgr::me()->lua_states_.push_back(this);
+        }
 
         lua_binding_class_mgr_base::~lua_binding_class_mgr_base() {}
 
+        int64_t lua_binding_class_mgr_base::get_live_objects(lua_State *L) const {
+            lua_binding_context *ctx = NULL == L ? NULL : lua_binding_context::get(L);
+            if (NULL == ctx) {
+                return 0;
+            }
+
+            return ctx->get_live_objects(class_id_);
+        }
+
+        void lua_binding_class_mgr_base::add_live_object(lua_State *L) {
+            lua_binding_context *ctx = lua_binding_context::get(L);
+            if (NULL != ctx) {
+                ctx->add_live_object(class_id_);
+            }
+        }
+
+        void lua_binding_class_mgr_base::remove_live_object(lua_State *L) {
+            lua_binding_context *ctx = lua_binding_context::get(L);
+            if (NULL != ctx) {
+                ctx->remove_live_object(class_id_);
+            }
+        }
+
+        size_t lua_binding_class_mgr_base::get_ref_cache_size(lua_State *L) const {
+            lua_binding_context *ctx = NULL == L ? NULL : lua_binding_context::get(L);
+            if (NULL == ctx) {
+                return 0;
+            }
+
+            return ctx->get_ref_cache_size(class_id_);
+        }
+
+        size_t lua_binding_class_mgr_base::get_ref_cache_peak(lua_State *L) const {
+            lua_binding_context *ctx = NULL == L ? NULL : lua_binding_context::get(L);
+            if (NULL == ctx) {
+                return 0;
+            }
+
+            return ctx->get_ref_cache_peak(class_id_);
+        }
+
         lua_binding_mgr::lua_binding_mgr() {}
 
         lua_binding_mgr::~lua_binding_mgr() {}
@@ -24,8 +68,10 @@ namespace script {
                 fn(engine->get_lua_state());
             }
 
-            for (auto &cmgr : lua_states_) {
-                cmgr->add_lua_state(engine->get_lua_state());
+            lua_binding_context *ctx = engine->get_binding_context().get();
+            if (NULL != ctx) {
+                ::util::lock::write_lock_holder< ::util::lock::spin_rw_lock> wlh(contexts_lock_);
+                contexts_.push_back(ctx);
             }
 
             return 0;
@@ -36,21 +82,31 @@ namespace script {
                 return -1;
             }
 
-            for (auto &cmgr : lua_states_) {
-                cmgr->remove_lua_state(engine->get_lua_state());
+            lua_binding_context *ctx = engine->get_binding_context().get();
+            if (NULL != ctx) {
+                ::util::lock::write_lock_holder< ::util::lock::spin_rw_lock> wlh(contexts_lock_);
+                contexts_.remove(ctx);
             }
 
             return 0;
         }
 
         int lua_binding_mgr::proc(lua_engine *engine) {
-            lua_State* L = NULL;
             if (NULL != engine) {
-                L = engine->get_lua_state();
+                const lua_binding_context::ptr_t &ctx = engine->get_binding_context();
+                if (ctx) {
+                    ctx->set_owner_thread();
+                    ctx->proc();
+                }
+                return 0;
             }
 
-            for (auto &mgr : lua_states_) {
-                mgr->proc(L);
+            ::util::lock::read_lock_holder< ::util::lock::spin_rw_lock> rlh(contexts_lock_);
+            for (lua_binding_context *ctx : contexts_) {
+                // 其他线程所属的上下文不加锁，不能在这里访问
+                if (ctx->is_owner_thread()) {
+                    ctx->proc();
+                }
             }
 
             return 0;
@@ -58,6 +114,22 @@ namespace script {
 
         void lua_binding_mgr::add_bind(func_type fn) { auto_bind_list_.push_back(fn); }
 
+        void lua_binding_mgr::collect_class_metrics(lua_State *L, std::vector<lua_class_metrics> &out) {
+            // 每个类的统计都在同一个上下文中，只查找一次
+            lua_binding_context *ctx = NULL == L ? NULL : lua_binding_context::get(L);
+
+            ::util::lock::read_lock_holder< ::util::lock::spin_rw_lock> rlh(lua_states_lock_);
+            for (auto &cmgr : lua_states_) {
+                size_t            class_id = cmgr->get_class_id();
+                lua_class_metrics m;
+                m.class_name     = cmgr->get_class_name();
+                m.live_objects   = NULL == ctx ? 0 : ctx->get_live_objects(class_id);
+                m.ref_cache_size = NULL == ctx ? 0 : ctx->get_ref_cache_size(class_id);
+                m.ref_cache_peak = NULL == ctx ? 0 : ctx->get_ref_cache_peak(class_id);
+                out.push_back(m);
+            }
+        }
+
         lua_binding_wrapper::lua_binding_wrapper(lua_binding_mgr::func_type fn) { lua_binding_mgr::me()->add_bind(fn); }
 
         lua_binding_wrapper::~lua_binding_wrapper() {}
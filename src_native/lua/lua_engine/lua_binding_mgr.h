@@ -1,5 +1,6 @@
 ﻿/**
- * @note 多线程多lua虚拟机情况下，应该在每个线程单独对虚拟机执行lua_binding_mgr::me()->proc(L);以防止多线程冲突
+ * @note 多线程多lua虚拟机情况下，应该在每个线程单独对虚拟机执行lua_binding_mgr::me()->proc(engine);以防止多线程冲突
+ * @note lua_binding_mgr::me()->proc()只处理所属线程是调用线程的lua虚拟机
  */
 
 #ifndef SCRIPT_LUA_LUABINDINGMGR
@@ -15,6 +16,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <config/compiler_features.h>
 #include <design_pattern/singleton.h>
@@ -23,7 +25,9 @@
 #include <lock/lock_holder.h>
 #include <lock/spin_rw_lock.h>
 
+#include "lua_binding_context.h"
 #include "lua_binding_utils.h"
+#include "lua_engine_metrics.h"
 
 namespace script {
     namespace lua {
@@ -37,11 +41,42 @@ namespace script {
         public:
             virtual ~lua_binding_class_mgr_base() = 0;
 
-            virtual int proc(lua_State *L) = 0;
+            virtual const char *get_class_name() const = 0;
 
-            virtual void add_lua_state(lua_State *L) = 0;
+            /**
+             * @brief 获取lua_State中存活的lua userdata数
+             */
+            int64_t get_live_objects(lua_State *L) const;
+
+            /**
+             * @brief 记录lua_State中创建了一个lua userdata
+             * @note 计数保存在lua_binding_context中，没有原子操作，必须在运行这个lua_State的线程中调用
+             */
+            void add_live_object(lua_State *L);
+
+            /**
+             * @brief 记录lua_State中回收了一个lua userdata
+             */
+            void remove_live_object(lua_State *L);
+
+            /**
+             * @brief 获取类在lua_binding_context中的编号
+             */
+            inline size_t get_class_id() const { return class_id_; }
+
+            /**
+             * @brief 获取lua_State的引用缓存大小
+             */
+            size_t get_ref_cache_size(lua_State *L) const;
 
-            virtual void remove_lua_state(lua_State *L) = 0;
+            /**
+             * @brief 获取lua_State的引用缓存在两次proc()之间的最大值
+             * @note 统计从上一次lua_binding_context::reset_ref_cache_peak()开始
+             */
+            size_t get_ref_cache_peak(lua_State *L) const;
+
+        private:
+            size_t class_id_;
         };
 
 
@@ -49,58 +84,30 @@ namespace script {
         class lua_binding_class_mgr_inst : public lua_binding_class_mgr_base,
                                            public util::design_pattern::singleton<lua_binding_class_mgr_inst<TC> > {
         public:
-            virtual int proc(lua_State *L) UTIL_CONFIG_OVERRIDE {
-                if (NULL == L) {
-                    ::util::lock::write_lock_holder< ::util::lock::spin_rw_lock> wlh(cache_lock_);
-                    cache_maps_.clear();
-                    return 0;
-                }
-
-                ::util::lock::read_lock_holder< ::util::lock::spin_rw_lock> rlh(cache_lock_);
-                intptr_t index = reinterpret_cast<intptr_t>(L);
-                auto iter = cache_maps_.find(index);
-                if (cache_maps_.end() == iter) {
-                    return -1;
-                }
-
-                iter->second.clear();
-                return 0;
-            }
+            lua_binding_class_mgr_inst() {}
 
+            /**
+             * @brief 添加到lua_State的引用缓存，防止被立即析构
+             * @note 必须在运行这个lua_State的线程中调用
+             */
             bool add_ref(lua_State *L, const std::shared_ptr<TC> &ptr) {
                 if (NULL == L) {
                     return false;
                 }
 
-                ::util::lock::read_lock_holder< ::util::lock::spin_rw_lock> rlh(cache_lock_);
-
-                intptr_t index = reinterpret_cast<intptr_t>(L);
-                auto iter = cache_maps_.find(index);
-                if (cache_maps_.end() == iter) {
+                lua_binding_context *ctx = lua_binding_context::get(L);
+                if (NULL == ctx) {
                     return false;
                 }
 
-                iter->second.push_back(ptr);
+                ctx->add_ref(get_class_id(), ptr);
                 return true;
             }
 
-            virtual void add_lua_state(lua_State *L) UTIL_CONFIG_OVERRIDE {
-                ::util::lock::write_lock_holder< ::util::lock::spin_rw_lock> wlh(cache_lock_);
-
-                intptr_t index = reinterpret_cast<intptr_t>(L);
-                cache_maps_[index];
-            }
-
-            virtual void remove_lua_state(lua_State *L) UTIL_CONFIG_OVERRIDE {
-                ::util::lock::write_lock_holder< ::util::lock::spin_rw_lock> wlh(cache_lock_);
-
-                intptr_t index = reinterpret_cast<intptr_t>(L);
-                cache_maps_.erase(index);
+            virtual const char *get_class_name() const UTIL_CONFIG_OVERRIDE {
+                return lua_binding_userdata_info<TC>::get_lua_metatable_name();
             }
 
-        private:
-            std::map<intptr_t, std::list<std::shared_ptr<TC> > > cache_maps_;
-            ::util::lock::spin_rw_lock cache_lock_;
         };
 
         class lua_binding_mgr : public util::design_pattern::singleton<lua_binding_mgr> {
@@ -117,12 +124,22 @@ namespace script {
 
             /**
              * 自动更新/清理入口
-             * @param 指定要清理的lua虚拟机，不指定为清理全部
+             * @param 指定要清理的lua虚拟机，不指定为清理调用线程所属的全部lua虚拟机
+             * @note 指定lua虚拟机时只清理它自己的lua_binding_context，不加锁，并把调用线程设置为它的所属线程
+             * @note 不指定时跳过其他线程所属的lua虚拟机，它们的lua_binding_context只能在自己的线程中访问
+             * @see lua_binding_context::set_owner_thread
              */
             int proc(lua_engine *engine = NULL);
 
             void add_bind(func_type fn);
 
+            /**
+             * @brief 收集所有绑定类的指标
+             * @param L 统计引用缓存大小的lua虚拟机
+             * @param out 输出，会追加到末尾
+             */
+            void collect_class_metrics(lua_State *L, std::vector<lua_class_metrics> &out);
+
         public:
             template <typename TC>
             bool add_ref(lua_State *L, const std::shared_ptr<TC> &ptr) {
@@ -131,7 +148,10 @@ namespace script {
 
         private:
             std::list<func_type> auto_bind_list_;
-            std::list<lua_binding_class_mgr_base *> lua_states_;
+            std::list<lua_binding_class_mgr_base *> lua_states_; // 类管理器的单例可能在任意线程中创建，需要加锁
+            ::util::lock::spin_rw_lock lua_states_lock_;
+            std::list<lua_binding_context *> contexts_; // 只用于清理调用线程所属的全部lua虚拟机，proc(engine)不访问
+            ::util::lock::spin_rw_lock contexts_lock_;
             friend class lua_binding_class_mgr_base;
         };
 
@@ -0,0 +1,367 @@
+#ifndef SCRIPT_LUA_LUABINDINGOWNERSHIP
+#define SCRIPT_LUA_LUABINDINGOWNERSHIP
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include "lua.h"
+}
+
+#include <design_pattern/noncopyable.h>
+
+#include "lua_binding_context.h"
+#include "lua_binding_handle.h"
+#include "lua_borrow_token.h"
+#include "lua_intrusive_ptr.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            // 和lua 5.1-5.3的L_Umaxalign一致，lua_newuserdata返回的内存只保证这个对齐
+            union lua_binding_userdata_max_align {
+                double u;
+                void * s;
+                long   l;
+            };
+        } // namespace detail
+
+        /**
+         * 默认模式，lua userdata中保存std::weak_ptr，每次调用成员方法时lock()
+         */
+        struct lua_binding_ownership_weak {};
+
+        /**
+         * 句柄模式，lua userdata中只保存{槽位, 代数}，对象由每个lua_State的槽位表持有
+         * 调用成员方法时只比较代数，没有原子操作
+         * @note 槽位表持有对象的强引用，直到这个对象的所有userdata都被回收或者调用fn::invalidate_handle
+         * @note 成员方法执行期间会占用槽位，这期间调用fn::invalidate_handle时句柄立即失效，对象在方法返回后释放
+         * @note 槽位表作为成员方法闭包的上值，调用成员方法时不需要查找lua_binding_context
+         * @see lua_binding_handle_table
+         */
+        struct lua_binding_ownership_handle {};
+
+        /**
+         * 侵入式引用计数模式，lua userdata中只保存对象指针，每个userdata持有一个引用
+         * 对象通过lua_intrusive_ptr传递，不需要std::shared_ptr的控制块
+         * @note 引用计数由对象自己实现，继承lua_intrusive_object时为非原子计数，只能在单线程的lua_engine中使用
+         * @see lua_intrusive_ptr
+         */
+        struct lua_binding_ownership_intrusive {};
+
+        /**
+         * 值类型模式，对象直接保存在lua userdata中，由lua的GC管理
+         * 入栈时复制一份，不需要std::shared_ptr、引用缓存和额外的堆内存分配，适合向量、id、时间段等小对象
+         * @note 使用lua_binding_value_class注册
+         * @note 类型的对齐要求不能超过lua userdata的对齐(lua 5.1-5.3为L_Umaxalign)
+         * @note 平凡析构的类型不设置__gc，也不计入存活对象数
+         */
+        struct lua_binding_ownership_value {};
+
+        /**
+         * 借用模式，对象由C++管理(通常是整个进程都存在的管理器、世界状态等)，类型需要继承lua_borrowable_object
+         * C++中以裸指针TC*入栈，lua userdata中保存指针和有效性令牌，对象析构时令牌失效
+         * 没有引用计数、引用缓存，也不设置__gc
+         * @see lua_borrow_token
+         */
+        struct lua_binding_ownership_borrowed {};
+
+        /**
+         * 借用模式的lua userdata
+         */
+        struct lua_binding_borrowed {
+            void *                              ptr;
+            const lua_borrow_token::cell_type *cell;
+            uint32_t                            generation;
+        };
+
+        /**
+         * 绑定类的所有权模式，特化这个模板来切换模式:
+         * @code
+         *     namespace script { namespace lua {
+         *         template <>
+         *         struct lua_binding_ownership_traits<my_class> {
+         *             typedef lua_binding_ownership_handle type;
+         *         };
+         *     } }
+         * @endcode
+         * 也可以在全局命名空间使用LUA_BINDING_DECLARE_OWNERSHIP(my_class, ::script::lua::lua_binding_ownership_handle)
+         * @note 必须在第一次绑定或使用这个类之前特化
+         */
+        template <typename TC>
+        struct lua_binding_ownership_traits {
+            typedef lua_binding_ownership_weak type;
+        };
+
+        template <typename TC>
+        struct lua_binding_is_value_class
+            : public std::is_same<typename lua_binding_ownership_traits<TC>::type, lua_binding_ownership_value> {};
+
+        template <typename TC>
+        struct lua_binding_is_borrowed_class
+            : public std::is_same<typename lua_binding_ownership_traits<TC>::type, lua_binding_ownership_borrowed> {};
+
+        template <typename TC, typename TMode = typename lua_binding_ownership_traits<TC>::type>
+        struct lua_binding_ownership;
+
+        template <typename TC>
+        struct lua_binding_ownership<TC, lua_binding_ownership_weak> {
+            typedef std::shared_ptr<TC> pointer_type;
+            typedef std::weak_ptr<TC>   userdata_type;
+            typedef std::shared_ptr<TC> holder_type; // 调用期间持有对象
+
+            // lua中只有弱引用，新创建的对象需要放入引用缓存
+            static const bool use_ref_cache = true;
+            static const bool use_gc        = true;
+
+            template <typename... TParams>
+            static inline pointer_type create(TParams &&... params) {
+                return std::make_shared<TC>(std::forward<TParams>(params)...);
+            }
+
+            static inline void construct(lua_State *, userdata_type *ud, const std::shared_ptr<TC> &v) { new (ud) userdata_type(v); }
+
+            static inline void construct(lua_State *, userdata_type *ud, const std::weak_ptr<TC> &v) { new (ud) userdata_type(v); }
+
+            static inline void destroy(lua_State *, userdata_type *ud) { ud->~userdata_type(); }
+
+            static inline std::shared_ptr<TC> lock(lua_State *, userdata_type *ud) { return ud->lock(); }
+
+            static inline void *get_method_context(lua_State *) { return NULL; }
+
+            static inline TC *get(lua_State *, userdata_type *ud, holder_type &holder, void * = NULL) {
+                holder = ud->lock();
+                return holder.get();
+            }
+        };
+
+        template <typename TC>
+        struct lua_binding_ownership<TC, lua_binding_ownership_handle> {
+            typedef std::shared_ptr<TC> pointer_type;
+            typedef lua_binding_handle  userdata_type;
+
+            // 对象入栈之前只有调用者持有，和默认模式一样放入引用缓存
+            static const bool use_ref_cache = true;
+            static const bool use_gc        = true;
+
+            template <typename... TParams>
+            static inline pointer_type create(TParams &&... params) {
+                return std::make_shared<TC>(std::forward<TParams>(params)...);
+            }
+
+            // 调用期间占用槽位，防止self被回收或者句柄失效时释放对象
+            struct holder_type : public ::util::design_pattern::noncopyable {
+                lua_binding_handle_table *table;
+                uint32_t                  slot;
+
+                holder_type() : table(NULL), slot(0) {}
+                ~holder_type() {
+                    if (NULL != table) {
+                        table->unpin(slot);
+                    }
+                }
+            };
+
+            static lua_binding_handle_table *get_table(lua_State *L) {
+                static size_t type_id = lua_binding_context::alloc_handle_type_id();
+
+                lua_binding_context *ctx = lua_binding_context::get(L);
+                if (NULL == ctx) {
+                    return NULL;
+                }
+
+                return ctx->get_handle_table(type_id);
+            }
+
+            static void construct(lua_State *L, userdata_type *ud, const std::shared_ptr<TC> &v) {
+                lua_binding_handle_table *table = get_table(L);
+                if (NULL == table) {
+                    // 没有绑定上下文的lua_State(不是由lua_engine创建的)，句柄永远无效
+                    ud->slot       = UINT32_MAX;
+                    ud->generation = 0;
+                    return;
+                }
+
+                *ud = table->acquire(v, const_cast<void *>(static_cast<const void *>(v.get())));
+            }
+
+            static inline void construct(lua_State *L, userdata_type *ud, const std::weak_ptr<TC> &v) { construct(L, ud, v.lock()); }
+
+            static void destroy(lua_State *L, userdata_type *ud) {
+                lua_binding_handle_table *table = get_table(L);
+                if (NULL != table) {
+                    table->release(*ud);
+                }
+            }
+
+            static std::shared_ptr<TC> lock(lua_State *L, userdata_type *ud) {
+                lua_binding_handle_table *table = get_table(L);
+                if (NULL == table) {
+                    return std::shared_ptr<TC>();
+                }
+
+                return std::static_pointer_cast<TC>(table->lock(*ud));
+            }
+
+            /**
+             * @brief 成员方法闭包的上值，这个lua_State的槽位表
+             */
+            static inline void *get_method_context(lua_State *L) { return get_table(L); }
+
+            /**
+             * @param method_context 成员方法闭包中保存的槽位表，NULL时从lua_binding_context中查找
+             */
+            static inline TC *get(lua_State *L, userdata_type *ud, holder_type &holder, void *method_context = NULL) {
+                lua_binding_handle_table *table =
+                    NULL != method_context ? static_cast<lua_binding_handle_table *>(method_context) : get_table(L);
+                if (NULL == table) {
+                    return NULL;
+                }
+
+                TC *ret = static_cast<TC *>(table->pin(*ud));
+                if (NULL != ret) {
+                    holder.table = table;
+                    holder.slot  = ud->slot;
+                }
+                return ret;
+            }
+
+            static bool invalidate(lua_State *L, const TC *ptr) {
+                lua_binding_handle_table *table = get_table(L);
+                if (NULL == table) {
+                    return false;
+                }
+
+                return table->invalidate(ptr);
+            }
+        };
+
+        template <typename TC>
+        struct lua_binding_ownership<TC, lua_binding_ownership_intrusive> {
+            typedef lua_intrusive_ptr<TC> pointer_type;
+            typedef TC *                  userdata_type;
+            typedef lua_intrusive_ptr<TC> holder_type; // 调用期间持有对象
+
+            // userdata持有引用，不需要引用缓存
+            static const bool use_ref_cache = false;
+            static const bool use_gc        = true;
+
+            template <typename... TParams>
+            static inline pointer_type create(TParams &&... params) {
+                return pointer_type(new TC(std::forward<TParams>(params)...));
+            }
+
+            static inline void construct(lua_State *, userdata_type *ud, const lua_intrusive_ptr<TC> &v) {
+                *ud = v.get();
+                if (NULL != *ud) {
+                    intrusive_ptr_add_ref(*ud);
+                }
+            }
+
+            static inline void destroy(lua_State *, userdata_type *ud) {
+                TC *p = *ud;
+                *ud   = NULL;
+                if (NULL != p) {
+                    intrusive_ptr_release(p);
+                }
+            }
+
+            static inline pointer_type lock(lua_State *, userdata_type *ud) { return pointer_type(*ud); }
+
+            static inline void *get_method_context(lua_State *) { return NULL; }
+
+            static inline TC *get(lua_State *, userdata_type *ud, holder_type &holder, void * = NULL) {
+                holder = pointer_type(*ud);
+                return *ud;
+            }
+        };
+
+        template <typename TC>
+        struct lua_binding_ownership<TC, lua_binding_ownership_value> {
+            typedef TC pointer_type;
+            typedef TC userdata_type;
+            struct holder_type {};
+
+            static_assert(alignof(TC) <= alignof(detail::lua_binding_userdata_max_align),
+                          "value class is over-aligned for lua userdata");
+
+            // 对象在userdata中，不需要引用缓存；平凡析构的类型不需要__gc
+            static const bool use_ref_cache = false;
+            static const bool use_gc        = !std::is_trivially_destructible<TC>::value;
+
+            template <typename... TParams>
+            static inline pointer_type create(TParams &&... params) {
+                return TC(std::forward<TParams>(params)...);
+            }
+
+            static inline void construct(lua_State *, userdata_type *ud, const TC &v) { new (ud) TC(v); }
+
+            static inline void destroy(lua_State *, userdata_type *ud) { ud->~TC(); }
+
+            static inline void *get_method_context(lua_State *) { return NULL; }
+
+            static inline TC *get(lua_State *, userdata_type *ud, holder_type &, void * = NULL) { return ud; }
+        };
+
+        template <typename TC>
+        struct lua_binding_ownership<TC, lua_binding_ownership_borrowed> {
+            typedef TC *                 pointer_type;
+            typedef lua_binding_borrowed userdata_type;
+            struct holder_type {};
+
+            // 对象由C++管理，lua中不持有也不释放
+            static const bool use_ref_cache = false;
+            static const bool use_gc        = false;
+
+            static inline void construct(lua_State *, userdata_type *ud, TC *v) {
+                static_assert(std::is_base_of<lua_borrowable_object, TC>::value, "borrowed class must inherit lua_borrowable_object");
+
+                const lua_borrow_token &token = static_cast<const lua_borrowable_object *>(v)->get_lua_borrow_token();
+                ud->ptr                       = v;
+                ud->cell                      = token.get_cell();
+                ud->generation                = token.get_generation();
+            }
+
+            static inline void destroy(lua_State *, userdata_type *) {}
+
+            static inline TC *lock(lua_State *, userdata_type *ud) {
+                return lua_borrow_token::check(ud->cell, ud->generation) ? static_cast<TC *>(ud->ptr) : NULL;
+            }
+
+            static inline void *get_method_context(lua_State *) { return NULL; }
+
+            static inline TC *get(lua_State *, userdata_type *ud, holder_type &, void * = NULL) {
+                return lua_borrow_token::check(ud->cell, ud->generation) ? static_cast<TC *>(ud->ptr) : NULL;
+            }
+        };
+
+        namespace fn {
+            /**
+             * @brief 使句柄模式的对象在lua_State中的所有句柄失效，之后lua中调用它的成员方法会报错
+             * @return 对象存在时返回true
+             */
+            template <typename TC>
+            bool invalidate_handle(lua_State *L, const TC *ptr) {
+                return lua_binding_ownership<TC, lua_binding_ownership_handle>::invalidate(L, ptr);
+            }
+        } // namespace fn
+    }     // namespace lua
+} // namespace script
+
+#define LUA_BINDING_DECLARE_OWNERSHIP(TC, MODE)       \
+    namespace script {                                \
+        namespace lua {                               \
+            template <>                               \
+            struct lua_binding_ownership_traits<TC> { \
+                typedef MODE type;                    \
+            };                                        \
+        }                                             \
+    }
+
+#endif
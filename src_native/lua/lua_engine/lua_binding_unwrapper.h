@@ -221,7 +221,8 @@ namespace script {
             template <typename TC, typename... Ty>
             struct unwraper_var<std::shared_ptr<TC>, Ty...> {
                 static std::shared_ptr<TC> unwraper(lua_State *L, int index) {
-                    typedef typename lua_binding_userdata_info<TC>::userdata_type ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::userdata_type  ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::ownership_type ownership_t;
 
                     LUA_CHECK_TYPE_AND_RET(userdata, L, index, std::shared_ptr<TC>());
                     const char *class_name = lua_binding_userdata_info<TC>::get_lua_metatable_name();
@@ -231,7 +232,7 @@ namespace script {
                         return std::shared_ptr<TC>();
                     }
 
-                    return watcher->lock();
+                    return ownership_t::lock(L, watcher);
                 }
             };
 
@@ -239,7 +240,8 @@ namespace script {
             template <typename TC, typename... Ty>
             struct unwraper_var<std::weak_ptr<TC>, Ty...> {
                 static std::weak_ptr<TC> unwraper(lua_State *L, int index) {
-                    typedef typename lua_binding_userdata_info<TC>::userdata_type ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::userdata_type  ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::ownership_type ownership_t;
 
                     LUA_CHECK_TYPE_AND_RET(userdata, L, index, std::weak_ptr<TC>());
 
@@ -250,7 +252,27 @@ namespace script {
                         return std::weak_ptr<TC>();
                     }
 
-                    return watcher;
+                    return ownership_t::lock(L, watcher);
+                }
+            };
+
+            // 注册类的打解包(侵入式引用计数模式)
+            template <typename TC, typename... Ty>
+            struct unwraper_var<lua_intrusive_ptr<TC>, Ty...> {
+                static lua_intrusive_ptr<TC> unwraper(lua_State *L, int index) {
+                    typedef typename lua_binding_userdata_info<TC>::userdata_type  ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::ownership_type ownership_t;
+
+                    LUA_CHECK_TYPE_AND_RET(userdata, L, index, lua_intrusive_ptr<TC>());
+
+                    const char *class_name = lua_binding_userdata_info<TC>::get_lua_metatable_name();
+                    ud_t *watcher = static_cast<ud_t *>(luaL_checkudata(L, index, class_name));
+
+                    if (NULL == watcher) {
+                        return lua_intrusive_ptr<TC>();
+                    }
+
+                    return ownership_t::lock(L, watcher);
                 }
             };
 
@@ -401,15 +423,52 @@ namespace script {
             };
             // -------------- 数组支持 --------------
 
+            // 值类型注册类的解包，返回userdata中对象的副本
+            template <typename TC>
+            struct unwraper_value_var {
+                static TC unwraper(lua_State *L, int index) {
+                    typedef typename lua_binding_userdata_info<TC>::userdata_type ud_t;
+
+                    const char *class_name = lua_binding_userdata_info<TC>::get_lua_metatable_name();
+                    ud_t *      obj        = static_cast<ud_t *>(luaL_checkudata(L, index, class_name));
+                    return *obj;
+                }
+            };
+
+            // 借用模式注册类的解包，对象已经析构时返回NULL
+            template <typename TC>
+            struct unwraper_borrowed_var {
+                static TC *unwraper(lua_State *L, int index) {
+                    typedef typename lua_binding_userdata_info<TC>::userdata_type  ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::ownership_type ownership_t;
+
+                    if (lua_gettop(L) < index || lua_isnil(L, index)) {
+                        return NULL;
+                    }
+
+                    const char *class_name = lua_binding_userdata_info<TC>::get_lua_metatable_name();
+                    ud_t *      obj        = static_cast<ud_t *>(luaL_checkudata(L, index, class_name));
+                    return ownership_t::lock(L, obj);
+                }
+            };
+
             template <typename Ty, typename... Tl>
             struct unwraper_var
                 : public std::conditional<
                       std::is_enum<Ty>::value || std::is_integral<Ty>::value,
                       unwraper_var_lua_type<Ty, typename std::conditional<std::is_enum<Ty>::value || std::is_unsigned<Ty>::value,
                                                                           lua_Unsigned, lua_Integer>::type>,    // 枚举类型
-                      typename std::conditional<std::is_pointer<Ty>::value, unwraper_ptr_var_lua_type<Ty, Ty>,  // 指针类型
-                                                unwraper_var_lua_type<Ty, Ty>                                   // POD类型
-                                                >::type>::type {};
+                      typename std::conditional<
+                          std::is_pointer<Ty>::value,
+                          typename std::conditional<
+                              lua_binding_is_borrowed_class<typename std::remove_cv<typename std::remove_pointer<Ty>::type>::type>::value,
+                              unwraper_borrowed_var<typename std::remove_cv<typename std::remove_pointer<Ty>::type>::type>,  // 借用模式注册类
+                              unwraper_ptr_var_lua_type<Ty, Ty>                                                             // 指针类型
+                              >::type,
+                                                typename std::conditional<lua_binding_is_value_class<Ty>::value,
+                                                                          unwraper_value_var<Ty>,       // 值类型注册类
+                                                                          unwraper_var_lua_type<Ty, Ty> // POD类型
+                                                                          >::type>::type>::type {};
 
 
             // --------------- 解包装接口结束 ----------------
@@ -1,8 +1,17 @@
-﻿#include <cmath>
+﻿#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <list>
 #include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
 extern "C" {
 #include "lauxlib.h"
@@ -11,6 +20,8 @@ extern "C" {
 }
 
 #include "lua_binding_utils.h"
+#include "lua_bytecode_cache.h"
+#include "lua_code_cache.h"
 
 namespace script {
     namespace lua {
@@ -29,19 +40,135 @@ namespace script {
         }
 #endif
 
+        namespace detail {
+            static char lua_pcall_error_state_key = 0;
+#if LUA_VERSION_NUM < 502
+            static char lua_pcall_hmsg_key = 0;
+#endif
+
+            struct lua_pcall_error_state {
+                uint64_t error_count;      // 出错次数
+                uint64_t suppressed_count; // 被限流没有生成traceback的次数
+                uint32_t rate;             // 每秒允许生成的traceback数，0表示不限制
+                uint32_t burst;            // 允许突发生成的traceback数
+                double   tokens;
+                int64_t  last_refill_ns;
+            };
+
+            static lua_pcall_error_state *lua_pcall_get_error_state(lua_State *L, bool create) {
+                lua_pushlightuserdata(L, &lua_pcall_error_state_key);
+                lua_rawget(L, LUA_REGISTRYINDEX);
+                lua_pcall_error_state *ret = reinterpret_cast<lua_pcall_error_state *>(lua_touserdata(L, -1));
+                lua_pop(L, 1);
+
+                if (NULL != ret || !create) {
+                    return ret;
+                }
+
+                lua_pushlightuserdata(L, &lua_pcall_error_state_key);
+                ret = reinterpret_cast<lua_pcall_error_state *>(lua_newuserdata(L, sizeof(lua_pcall_error_state)));
+                memset(ret, 0, sizeof(lua_pcall_error_state));
+                lua_rawset(L, LUA_REGISTRYINDEX);
+                return ret;
+            }
+
+            // 令牌桶，每秒补充rate个，最多burst个
+            static bool lua_pcall_acquire_traceback(lua_pcall_error_state &state) {
+                if (0 == state.rate) {
+                    return true;
+                }
+
+                int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                if (now_ns > state.last_refill_ns) {
+                    state.tokens += static_cast<double>(now_ns - state.last_refill_ns) * state.rate / 1000000000.0;
+                    if (state.tokens > state.burst) {
+                        state.tokens = state.burst;
+                    }
+                }
+                state.last_refill_ns = now_ns;
+
+                if (state.tokens < 1.0) {
+                    return false;
+                }
+
+                state.tokens -= 1.0;
+                return true;
+            }
+
+            // 统计出错次数，只有没被限流时才生成traceback
+            static int lua_pcall_error_handler(lua_State *L) {
+                lua_pcall_error_state *state = lua_pcall_get_error_state(L, false);
+                if (NULL != state) {
+                    ++state->error_count;
+                    if (!lua_pcall_acquire_traceback(*state)) {
+                        ++state->suppressed_count;
+                        lua_settop(L, 1);
+                        return 1;
+                    }
+                }
+
+                lua_getglobal(L, "stackdump");
+                if (lua_isfunction(L, -1)) {
+                    lua_insert(L, 1);
+                    lua_call(L, lua_gettop(L) - 1, 1);
+                    return 1;
+                }
+                lua_pop(L, 1);
+
+#if LUA_VERSION_NUM >= 502
+                luaL_traceback(L, L, lua_tostring(L, 1), 1);
+                return 1;
+#else
+                return fn::lua_stackdump(L);
+#endif
+            }
+        } // namespace detail
+
         namespace fn {
             int get_pcall_hmsg(lua_State *L) {
                 if (NULL == L) return 0;
 
-                lua_getglobal(L, "stackdump");
+#if LUA_VERSION_NUM >= 502
+                // 轻量C函数不会分配内存
+                lua_pushcfunction(L, detail::lua_pcall_error_handler);
+#else
+                // lua 5.1的lua_pushcfunction每次都会创建闭包，缓存在registry中
+                lua_pushlightuserdata(L, &detail::lua_pcall_hmsg_key);
+                lua_rawget(L, LUA_REGISTRYINDEX);
                 if (!lua_isfunction(L, -1)) {
                     lua_pop(L, 1);
-                    lua_pushcfunction(L, lua_stackdump);
+                    lua_pushcfunction(L, detail::lua_pcall_error_handler);
+                    lua_pushlightuserdata(L, &detail::lua_pcall_hmsg_key);
+                    lua_pushvalue(L, -2);
+                    lua_rawset(L, LUA_REGISTRYINDEX);
                 }
-
+#endif
                 return lua_gettop(L);
             }
 
+            uint64_t get_pcall_error_count(lua_State *L) {
+                if (NULL == L) return 0;
+
+                return detail::lua_pcall_get_error_state(L, true)->error_count;
+            }
+
+            uint64_t get_pcall_traceback_suppressed_count(lua_State *L) {
+                if (NULL == L) return 0;
+
+                return detail::lua_pcall_get_error_state(L, true)->suppressed_count;
+            }
+
+            void set_pcall_traceback_limit(lua_State *L, uint32_t rate, uint32_t burst) {
+                if (NULL == L) return;
+
+                detail::lua_pcall_error_state *state = detail::lua_pcall_get_error_state(L, true);
+                state->rate                          = rate;
+                state->burst                         = burst < 1 ? 1 : burst;
+                state->tokens                        = state->burst;
+                state->last_refill_ns =
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
             bool load_item(lua_State *L, const std::string &path, bool auto_create_table) {
                 return load_item(L, path.c_str(), auto_create_table);
             }
@@ -96,6 +223,18 @@ namespace script {
                 return res && !lua_isnil(L, -1);
             }
 
+            bool load_item(lua_State *L, const lua_item_path &path, bool auto_create_table) {
+                return path.load(L, auto_create_table);
+            }
+
+            bool load_item(lua_State *L, const lua_item_path &path, int table_index, bool auto_create_table) {
+                return path.load(L, table_index, auto_create_table);
+            }
+
+            bool remove_item(lua_State *L, const lua_item_path &path) { return path.remove(L); }
+
+            bool remove_item(lua_State *L, const lua_item_path &path, int table_index) { return path.remove(L, table_index); }
+
             bool remove_item(lua_State *L, const std::string &path) {
                 return remove_item(L, path.c_str());
             }
@@ -200,7 +339,7 @@ namespace script {
                 lua_auto_block autoBlock(L);
 
                 int hmsg = get_pcall_hmsg(L);
-                if (luaL_loadfile(L, file_path) || lua_pcall(L, 0, LUA_MULTRET, hmsg)) {
+                if (lua_bytecode_cache::load_file(L, file_path) || lua_pcall(L, 0, LUA_MULTRET, hmsg)) {
                     WLOGERROR("%s", luaL_checkstring(L, -1));
                     return false;
                 }
@@ -211,7 +350,7 @@ namespace script {
             bool exec_code(lua_State *L, const char *codes) {
                 lua_auto_block autoBlock(L);
                 int hmsg = get_pcall_hmsg(L);
-                if (luaL_loadstring(L, codes) || lua_pcall(L, 0, LUA_MULTRET, hmsg)) {
+                if (lua_code_cache::load_code(L, codes) || lua_pcall(L, 0, LUA_MULTRET, hmsg)) {
                     WLOGERROR("%s", luaL_checkstring(L, -1));
                     return false;
                 }
@@ -223,7 +362,7 @@ namespace script {
                 lua_auto_block autoBlock(L);
 
                 int hmsg = get_pcall_hmsg(L);
-                if (LUA_OK != luaL_loadfile(L, file_path)) {
+                if (LUA_OK != lua_bytecode_cache::load_file(L, file_path)) {
                     WLOGERROR("%s", luaL_checkstring(L, -1));
                     return false;
                 }
@@ -427,6 +566,17 @@ namespace script {
 
                 return ss.str();
             }
+
+            std::string make_temp_file_path(const std::string &file_path) {
+#ifdef _WIN32
+                long pid = static_cast<long>(_getpid());
+#else
+                long pid = static_cast<long>(getpid());
+#endif
+                std::stringstream ss;
+                ss << file_path << "." << pid << "." << std::hex << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+                return ss.str();
+            }
         } // namespace fn
     }     // namespace lua
 } // namespace script
@@ -5,6 +5,7 @@
 
 #include <cstdio>
 #include <memory>
+#include <stdint.h>
 #include <string>
 #include <typeinfo>
 
@@ -15,6 +16,8 @@
 #include <std/explicit_declare.h>
 
 #include "../lua_module/lua_adaptor.h"
+#include "lua_binding_ownership.h"
+#include "lua_item_path.h"
 
 namespace script {
     namespace lua {
@@ -41,10 +44,11 @@ namespace script {
 
         template <typename TC>
         struct lua_binding_userdata_info {
-            typedef TC                          value_type;
-            typedef std::shared_ptr<value_type> pointer_type;
-            typedef std::weak_ptr<value_type>   userdata_type;
-            typedef userdata_type *             userdata_ptr_type;
+            typedef TC                                     value_type;
+            typedef lua_binding_ownership<value_type>      ownership_type;
+            typedef typename ownership_type::pointer_type  pointer_type;
+            typedef typename ownership_type::userdata_type userdata_type;
+            typedef userdata_type *                        userdata_ptr_type;
 
             static const char *get_lua_metatable_name() {
 #if defined(LIBATFRAME_UTILS_ENABLE_RTTI) && LIBATFRAME_UTILS_ENABLE_RTTI
@@ -146,6 +150,25 @@ namespace script {
         namespace fn {
             int get_pcall_hmsg(lua_State *L);
 
+            /**
+             * @brief 获取使用get_pcall_hmsg的保护调用出错的次数
+             * @note 第一次调用时开始计数
+             */
+            uint64_t get_pcall_error_count(lua_State *L);
+
+            /**
+             * @brief 获取被限流没有生成traceback的出错次数
+             */
+            uint64_t get_pcall_traceback_suppressed_count(lua_State *L);
+
+            /**
+             * @brief 限制get_pcall_hmsg生成traceback的频率，超出时错误信息原样返回
+             * @param L lua State
+             * @param rate 每秒允许生成的traceback数，0表示不限制
+             * @param burst 允许突发生成的traceback数
+             */
+            void set_pcall_traceback_limit(lua_State *L, uint32_t rate, uint32_t burst);
+
             /**
              * @brief load _G.path and push it into stack
              * @param L lua State
@@ -188,6 +211,27 @@ namespace script {
              */
             bool load_item(lua_State *L, const char* path, int table_index, bool auto_create_table = false);
 
+            /**
+             * @brief load _G.path by precompiled path and push it into stack
+             * @param L lua State
+             * @param path precompiled path
+             * @param auto_create_table create table if not exists
+             * @note this API always push a value into stack, push nil if failed
+             * @return true if success
+             */
+            bool load_item(lua_State *L, const lua_item_path &path, bool auto_create_table = false);
+
+            /**
+             * @brief load path from table by precompiled path and push it into stack
+             * @param L lua State
+             * @param path precompiled path
+             * @param table_index stack index of table to load
+             * @param auto_create_table create table if not exists
+             * @note this API always push a value into stack, push nil if failed
+             * @return true if success
+             */
+            bool load_item(lua_State *L, const lua_item_path &path, int table_index, bool auto_create_table = false);
+
             bool remove_item(lua_State *L, const std::string &path);
 
             bool remove_item(lua_State *L, const char* path);
@@ -196,6 +240,10 @@ namespace script {
 
             bool remove_item(lua_State *L, const char* path, int table_index);
 
+            bool remove_item(lua_State *L, const lua_item_path &path);
+
+            bool remove_item(lua_State *L, const lua_item_path &path, int table_index);
+
             void print_stack(lua_State *L);
 
             void print_traceback(lua_State *L, const std::string &msg);
@@ -269,6 +317,13 @@ namespace script {
             int lua_stackdump(lua_State *L);
 
             std::string lua_stackdump_to_string(lua_State *L);
+
+            /**
+             * @brief 生成写文件用的临时文件路径，包含进程id和线程id，多个进程或线程同时写同一个文件时不会冲突
+             * @param file_path 最终的文件路径
+             * @return 和file_path同目录的临时文件路径，写完后rename到file_path
+             */
+            std::string make_temp_file_path(const std::string &file_path);
         } // namespace fn
     }     // namespace lua
 } // namespace script
@@ -0,0 +1,104 @@
+#ifndef SCRIPT_LUA_LUABINDINGVALUECLASS
+#define SCRIPT_LUA_LUABINDINGVALUECLASS
+
+#pragma once
+
+#include <string>
+#include <type_traits>
+
+#include "lua_binding_class.h"
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 值类型的lua类，对象直接保存在userdata中，注意只能用于局部变量
+         * 在lua_binding_class的基础上支持元方法(运算符)，创建对象时不需要std::shared_ptr、引用缓存和额外的堆内存分配
+         * 使用前需要在全局命名空间声明:
+         * @code
+         *     LUA_BINDING_DECLARE_OWNERSHIP(vec3, ::script::lua::lua_binding_ownership_value)
+         *
+         *     script::lua::lua_binding_value_class<vec3> clazz("vec3", "game.math", L);
+         *     clazz.set_default_new<>();
+         *     clazz.add_method("length", &vec3::length);
+         *     clazz.add_meta_method("__add", &vec3_add); // vec3 vec3_add(vec3 l, vec3 r)
+         *     clazz.add_meta_method("__eq", &vec3::operator==);
+         * @endcode
+         * @note 成员方法中修改的是userdata中的对象，传给C++函数的参数和返回值是副本
+         */
+        template <typename TC>
+        class lua_binding_value_class : public lua_binding_class<TC> {
+        public:
+            typedef lua_binding_class<TC>                     base_type;
+            typedef lua_binding_value_class<TC>               self_type;
+            typedef typename base_type::value_type            value_type;
+            typedef typename base_type::member_proxy_method_t member_proxy_method_t;
+
+            static_assert(lua_binding_is_value_class<TC>::value,
+                          "value class must be declared by LUA_BINDING_DECLARE_OWNERSHIP(TC, ::script::lua::lua_binding_ownership_value)");
+
+        public:
+            lua_binding_value_class(const char *lua_name, const char *namespace_, lua_State *L) : base_type(lua_name, namespace_, L) {}
+
+            lua_binding_value_class(const char *lua_name, lua_binding_namespace &ns) : base_type(lua_name, ns) {}
+
+            /**
+             * @brief 添加元方法(静态函数)，例如__add、__sub、__mul、__unm、__eq、__lt、__le、__concat
+             * @param meta_name 元方法名
+             * @param fn 函数，参数依次为lua传入的操作数
+             */
+            template <typename R, typename... TParam>
+            self_type &add_meta_method(const char *meta_name, R (*fn)(TParam... param)) {
+                lua_State *state = base_type::get_lua_state();
+                lua_pushstring(state, meta_name);
+                lua_pushlightuserdata(state, reinterpret_cast<void *>(fn));
+                lua_pushcclosure(state, detail::unwraper_static_fn<R, TParam...>::LuaCFunction, 1);
+                lua_settable(state, base_type::get_user_meta_table());
+
+                return (*this);
+            }
+
+            /**
+             * @brief 添加元方法(成员函数)，左操作数必须是这个类型
+             */
+            template <typename R, typename TClass, typename... TParam>
+            self_type &add_meta_method(const char *meta_name, R (TClass::*fn)(TParam... param)) {
+                static_assert(std::is_convertible<value_type *, TClass *>::value, "class of member method invalid");
+
+                lua_State *state = base_type::get_lua_state();
+                lua_pushstring(state, meta_name);
+
+                member_proxy_method_t *fn_ptr = lua_binding_placement_new_and_delete<member_proxy_method_t>::create(state);
+                *fn_ptr = [fn](lua_State *L, value_type *pobj) {
+                    return detail::unwraper_member_fn<R, TClass, TParam...>::LuaCFunction(L, static_cast<TClass *>(pobj), fn);
+                };
+                base_type::push_member_method_closure(state);
+                lua_settable(state, base_type::get_user_meta_table());
+
+                return (*this);
+            }
+
+            /**
+             * @brief 添加元方法(常量成员函数)，左操作数必须是这个类型
+             */
+            template <typename R, typename TClass, typename... TParam>
+            self_type &add_meta_method(const char *meta_name, R (TClass::*fn)(TParam... param) const) {
+                static_assert(std::is_convertible<value_type *, TClass *>::value, "class of member method invalid");
+
+                lua_State *state = base_type::get_lua_state();
+                lua_pushstring(state, meta_name);
+
+                member_proxy_method_t *fn_ptr = lua_binding_placement_new_and_delete<member_proxy_method_t>::create(state);
+                *fn_ptr = [fn](lua_State *L, value_type *pobj) {
+                    return detail::unwraper_member_fn<R, TClass, TParam...>::LuaCFunction(L, static_cast<TClass *>(pobj), fn);
+                };
+                base_type::push_member_method_closure(state);
+                lua_settable(state, base_type::get_user_meta_table());
+
+                return (*this);
+            }
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "lua_binding_mgr.h"
 #include "lua_binding_utils.h"
+#include "lua_interned_key.h"
 
 
 #ifdef max
@@ -236,7 +237,8 @@ namespace script {
             template <typename TC, typename... Ty>
             struct wraper_var<std::shared_ptr<TC>, Ty...> {
                 static int wraper(lua_State *L, const std::shared_ptr<TC> &v) {
-                    typedef typename lua_binding_userdata_info<TC>::userdata_type ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::userdata_type  ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::ownership_type ownership_t;
 
                     // 无效则push nil
                     if (!v) {
@@ -245,7 +247,8 @@ namespace script {
                     }
 
                     void *buff = lua_newuserdata(L, sizeof(ud_t));
-                    new (buff) ud_t(v);
+                    ownership_t::construct(L, static_cast<ud_t *>(buff), v);
+                    lua_binding_class_mgr_inst<TC>::me()->add_live_object(L);
 
                     const char *class_name = lua_binding_userdata_info<TC>::get_lua_metatable_name();
                     luaL_getmetatable(L, class_name);
@@ -259,7 +262,8 @@ namespace script {
             template <typename TC, typename... Ty>
             struct wraper_var<std::weak_ptr<TC>, Ty...> {
                 static int wraper(lua_State *L, const std::weak_ptr<TC> &v) {
-                    typedef typename lua_binding_userdata_info<TC>::userdata_type ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::userdata_type  ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::ownership_type ownership_t;
 
                     // 无效则push nil
                     if (v.expired()) {
@@ -268,7 +272,33 @@ namespace script {
                     }
 
                     void *buff = lua_newuserdata(L, sizeof(ud_t));
-                    new (buff) ud_t(v);
+                    ownership_t::construct(L, static_cast<ud_t *>(buff), v);
+                    lua_binding_class_mgr_inst<TC>::me()->add_live_object(L);
+
+                    const char *class_name = lua_binding_userdata_info<TC>::get_lua_metatable_name();
+                    luaL_getmetatable(L, class_name);
+
+                    lua_setmetatable(L, -2);
+                    return 1;
+                }
+            };
+
+            // 注册类的打解包(侵入式引用计数模式)
+            template <typename TC, typename... Ty>
+            struct wraper_var<lua_intrusive_ptr<TC>, Ty...> {
+                static int wraper(lua_State *L, const lua_intrusive_ptr<TC> &v) {
+                    typedef typename lua_binding_userdata_info<TC>::userdata_type  ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::ownership_type ownership_t;
+
+                    // 无效则push nil
+                    if (!v) {
+                        lua_pushnil(L);
+                        return 1;
+                    }
+
+                    void *buff = lua_newuserdata(L, sizeof(ud_t));
+                    ownership_t::construct(L, static_cast<ud_t *>(buff), v);
+                    lua_binding_class_mgr_inst<TC>::me()->add_live_object(L);
 
                     const char *class_name = lua_binding_userdata_info<TC>::get_lua_metatable_name();
                     luaL_getmetatable(L, class_name);
@@ -286,6 +316,14 @@ namespace script {
                 }
             };
 
+            template <typename... Ty>
+            struct wraper_var< ::script::lua::lua_interned_key, Ty...> {
+                static int wraper(lua_State *L, const ::script::lua::lua_interned_key &v) {
+                    ::script::lua::fn::push_key(L, v);
+                    return 1;
+                }
+            };
+
             // ============== stl 扩展 =================
             template <typename TLeft, typename TRight, typename... Ty>
             struct wraper_var<std::pair<TLeft, TRight>, Ty...> {
@@ -392,6 +430,55 @@ namespace script {
             };
             // -------------- 数组支持 --------------
 
+            // 值类型注册类的打包，直接复制到userdata中
+            template <typename TC>
+            struct wraper_value_var {
+                static int wraper(lua_State *L, const TC &v) {
+                    typedef typename lua_binding_userdata_info<TC>::userdata_type  ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::ownership_type ownership_t;
+
+                    void *buff = lua_newuserdata(L, sizeof(ud_t));
+                    ownership_t::construct(L, static_cast<ud_t *>(buff), v);
+                    // 没有__gc的类型无法在回收时减少计数，不计入存活对象数
+                    if (ownership_t::use_gc) {
+                        lua_binding_class_mgr_inst<TC>::me()->add_live_object(L);
+                    }
+
+                    const char *class_name = lua_binding_userdata_info<TC>::get_lua_metatable_name();
+                    luaL_getmetatable(L, class_name);
+
+                    lua_setmetatable(L, -2);
+                    return 1;
+                }
+            };
+
+            // 借用模式注册类的打包，只保存指针和有效性令牌，不持有对象
+            template <typename TC>
+            struct wraper_borrowed_var {
+                // lua中可以调用所有注册的成员方法，包括非const方法，所以不允许传入const指针
+                static_assert(!std::is_const<TC>::value, "const pointer of borrowed class can not be pushed into lua");
+
+                static int wraper(lua_State *L, TC *v) {
+                    typedef typename lua_binding_userdata_info<TC>::userdata_type  ud_t;
+                    typedef typename lua_binding_userdata_info<TC>::ownership_type ownership_t;
+
+                    if (NULL == v) {
+                        lua_pushnil(L);
+                        return 1;
+                    }
+
+                    // 没有__gc，不计入存活对象数
+                    void *buff = lua_newuserdata(L, sizeof(ud_t));
+                    ownership_t::construct(L, static_cast<ud_t *>(buff), v);
+
+                    const char *class_name = lua_binding_userdata_info<TC>::get_lua_metatable_name();
+                    luaL_getmetatable(L, class_name);
+
+                    lua_setmetatable(L, -2);
+                    return 1;
+                }
+            };
+
             template <typename Ty, typename... Tl>
             struct wraper_var
                 : public std::conditional<
@@ -400,9 +487,16 @@ namespace script {
                           std::is_enum<Ty>::value || std::is_unsigned<Ty>::value, lua_Unsigned,
                           lua_Integer>::type>,  // 枚举类型和未识别的整数(某些编译器的size_t和uint32_t/uint64_t被判定为不同类型)
                       typename std::conditional<std::is_pointer<Ty>::value,
-                                                wraper_ptr_var_lua_type<Ty>,  // 指针类型
-                                                wraper_var_lua_type<Ty>       // POD类型
-                                                >::type>::type {};
+                                                typename std::conditional<lua_binding_is_borrowed_class<typename std::remove_cv<
+                                                                              typename std::remove_pointer<Ty>::type>::type>::value,
+                                                                          wraper_borrowed_var<typename std::remove_volatile<
+                                                                              typename std::remove_pointer<Ty>::type>::type>,  // 借用模式注册类
+                                                                          wraper_ptr_var_lua_type<Ty>  // 指针类型
+                                                                          >::type,
+                                                typename std::conditional<lua_binding_is_value_class<Ty>::value,
+                                                                          wraper_value_var<Ty>,    // 值类型注册类
+                                                                          wraper_var_lua_type<Ty>  // POD类型
+                                                                          >::type>::type>::type {};
 
 
             struct wraper_bat_cmd {
@@ -496,6 +590,37 @@ namespace script {
             return res ? res : (lua_gettop(L) - top);
         };
 
+        /**
+         * @brief 按预编译的路径自动打包调用lua函数，查找函数时不再拆分路径
+         * @return 参数个数，如果返回值小于0则不会改变参数个数
+         */
+        template <typename... TParams>
+        int auto_call(lua_State *L, const lua_item_path &path, TParams &&... params) {
+            int top = lua_gettop(L);
+            int hmsg = script::lua::fn::get_pcall_hmsg(L);
+
+            fn::load_item(L, path);
+            if (!lua_isfunction(L, -1)) {
+                WLOGERROR("var in lua stack %s is not a function.", path.get_path().c_str());
+                lua_settop(L, top);
+                return LUA_ERRRUN;
+            }
+
+            int param_num = detail::wraper_bat_cmd::wraper_bat_count(L, std::forward_as_tuple(params...),
+                                                                     typename detail::build_args_index<TParams...>::index_seq_type());
+
+            int res = lua_pcall(L, param_num, LUA_MULTRET, hmsg);
+            if (res) {
+                WLOGERROR("call stack %s error. ret code: %d\n%s", path.get_path().c_str(), res, lua_tostring(L, -1));
+                lua_settop(L, top);
+            } else {
+                // 移除hmsg
+                lua_remove(L, hmsg);
+            }
+
+            return res ? res : (lua_gettop(L) - top);
+        };
+
         template <typename... TParams>
         int auto_push(lua_State *L, TParams &&... params) {
             return detail::wraper_bat_cmd::wraper_bat_count(L, std::forward_as_tuple(params...),
@@ -0,0 +1,65 @@
+#include <mutex>
+#include <vector>
+
+#include "lua_borrow_token.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            // 代数单元按块分配，地址不变且永远不释放，失效的令牌留在lua中也可以安全读取
+            class lua_borrow_token_pool {
+            public:
+                enum { CHUNK_SIZE = 1024 };
+
+                static lua_borrow_token_pool &me() {
+                    // 不析构，防止静态对象析构后仍有令牌访问
+                    static lua_borrow_token_pool *ret = new lua_borrow_token_pool();
+                    return *ret;
+                }
+
+                lua_borrow_token::cell_type *alloc() {
+                    std::lock_guard<std::mutex> lock_guard(lock_);
+                    if (free_cells_.empty()) {
+                        lua_borrow_token::cell_type *chunk = new lua_borrow_token::cell_type[CHUNK_SIZE];
+                        for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+                            chunk[i].store(1, std::memory_order_relaxed);
+                            free_cells_.push_back(&chunk[CHUNK_SIZE - i - 1]);
+                        }
+                    }
+
+                    lua_borrow_token::cell_type *ret = free_cells_.back();
+                    free_cells_.pop_back();
+                    return ret;
+                }
+
+                void free(lua_borrow_token::cell_type *cell) {
+                    // 代数加一后旧的借用指针全部失效
+                    cell->fetch_add(1, std::memory_order_acq_rel);
+
+                    std::lock_guard<std::mutex> lock_guard(lock_);
+                    free_cells_.push_back(cell);
+                }
+
+            private:
+                std::mutex                                 lock_;
+                std::vector<lua_borrow_token::cell_type *> free_cells_;
+            };
+        } // namespace detail
+
+        lua_borrow_token::lua_borrow_token() : cell_(detail::lua_borrow_token_pool::me().alloc()), generation_(0) {
+            generation_ = cell_->load(std::memory_order_acquire);
+        }
+
+        lua_borrow_token::~lua_borrow_token() { invalidate(); }
+
+        void lua_borrow_token::invalidate() {
+            if (NULL == cell_) {
+                return;
+            }
+
+            cell_type *cell = cell_;
+            cell_           = NULL;
+            detail::lua_borrow_token_pool::me().free(cell);
+        }
+    } // namespace lua
+} // namespace script
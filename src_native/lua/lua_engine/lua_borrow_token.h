@@ -0,0 +1,78 @@
+#ifndef SCRIPT_LUA_LUABORROWTOKEN
+#define SCRIPT_LUA_LUABORROWTOKEN
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 借用指针的有效性令牌
+         * 每个令牌占用一个进程内的代数单元，单元的内存永远不会释放，令牌失效时代数加一并回收单元
+         * lua userdata中保存单元地址和代数，检查是否有效只需要一次原子读取，不需要加锁和引用计数
+         * @note 构造和失效时需要加锁，检查有效性不需要
+         */
+        class lua_borrow_token : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::atomic<uint32_t> cell_type;
+
+        public:
+            lua_borrow_token();
+            ~lua_borrow_token();
+
+            /**
+             * @brief 使令牌失效，之后lua中持有的借用指针都会变为无效
+             * @note 析构时会自动调用，对象在析构前就不再允许lua访问时可以提前调用
+             */
+            void invalidate();
+
+            inline bool is_valid() const { return NULL != cell_; }
+
+            inline const cell_type *get_cell() const { return cell_; }
+
+            inline uint32_t get_generation() const { return generation_; }
+
+            /**
+             * @brief 检查lua userdata中保存的单元地址和代数是否仍然有效
+             */
+            static inline bool check(const cell_type *cell, uint32_t generation) {
+                return NULL != cell && cell->load(std::memory_order_acquire) == generation;
+            }
+
+        private:
+            cell_type *cell_;
+            uint32_t   generation_;
+        };
+
+        /**
+         * 可以借用给lua的对象基类，对象的生命周期由C++管理
+         * 复制或移动得到的对象有自己的令牌，lua中借用的仍然是原来的对象；赋值时两边的令牌都保持不变
+         * @note lua中可以调用非const的成员方法，所以只能以非const指针入栈
+         * @see lua_binding_ownership_borrowed
+         */
+        class lua_borrowable_object {
+        public:
+            inline const lua_borrow_token &get_lua_borrow_token() const { return lua_borrow_token_; }
+
+            inline lua_borrow_token &get_lua_borrow_token() { return lua_borrow_token_; }
+
+        protected:
+            lua_borrowable_object() {}
+            lua_borrowable_object(const lua_borrowable_object &) {}
+            ~lua_borrowable_object() {}
+
+            lua_borrowable_object &operator=(const lua_borrowable_object &) { return *this; }
+
+        private:
+            lua_borrow_token lua_borrow_token_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
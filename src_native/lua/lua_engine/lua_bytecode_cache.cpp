@@ -0,0 +1,239 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <common/file_system.h>
+#include <common/string_oprs.h>
+#include <log/log_wrapper.h>
+
+#include "../lua_module/lua_adaptor.h"
+#include "lua_binding_utils.h"
+#include "lua_bytecode_cache.h"
+#include "lua_module_resolver.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            static char lua_bytecode_cache_registry_key = 0;
+
+            struct lua_bytecode_cache_header {
+                char     magic[4];
+                int32_t  lua_version_num;
+                int32_t  pointer_size;
+                int32_t  number_size;
+                int64_t  source_mtime;
+                int64_t  source_size;
+                uint32_t path_length;
+            };
+
+            static uint64_t lua_bytecode_cache_hash(const char *s) {
+                // FNV-1a
+                uint64_t ret = 14695981039346656037ULL;
+                while (s && *s) {
+                    ret ^= static_cast<unsigned char>(*s);
+                    ret *= 1099511628211ULL;
+                    ++s;
+                }
+                return ret;
+            }
+
+            static int lua_bytecode_cache_writer(lua_State *, const void *p, size_t sz, void *ud) {
+                reinterpret_cast<std::string *>(ud)->append(reinterpret_cast<const char *>(p), sz);
+                return 0;
+            }
+
+            static bool lua_bytecode_cache_read_file(const std::string &path, std::string &out) {
+                FILE *f = fopen(path.c_str(), "rb");
+                if (NULL == f) {
+                    return false;
+                }
+
+                fseek(f, 0, SEEK_END);
+                long sz = ftell(f);
+                fseek(f, 0, SEEK_SET);
+                if (sz <= 0) {
+                    fclose(f);
+                    return false;
+                }
+
+                out.resize(static_cast<size_t>(sz));
+                size_t rsz = fread(&out[0], 1, out.size(), f);
+                fclose(f);
+                return rsz == out.size();
+            }
+
+            static void lua_bytecode_cache_init_header(lua_bytecode_cache_header &header, const struct stat &st, size_t path_len) {
+                memset(&header, 0, sizeof(header));
+                memcpy(header.magic, "LBCC", 4);
+                header.lua_version_num = static_cast<int32_t>(LUA_VERSION_NUM);
+                header.pointer_size    = static_cast<int32_t>(sizeof(void *));
+                header.number_size     = static_cast<int32_t>(sizeof(lua_Number));
+                header.source_mtime    = static_cast<int64_t>(st.st_mtime);
+                header.source_size     = static_cast<int64_t>(st.st_size);
+                header.path_length     = static_cast<uint32_t>(path_len);
+            }
+        } // namespace detail
+
+        lua_bytecode_cache::lua_bytecode_cache(constructor_helper &helper) : cache_dir_(helper.cache_dir) {
+            memset(&stats_, 0, sizeof(stats_));
+        }
+
+        lua_bytecode_cache::~lua_bytecode_cache() {}
+
+        lua_bytecode_cache::ptr_t lua_bytecode_cache::create(const std::string &cache_dir) {
+            if (cache_dir.empty()) {
+                return ptr_t();
+            }
+
+            if (!util::file_system::is_exist(cache_dir.c_str()) && !util::file_system::mkdir(cache_dir.c_str(), true)) {
+                WLOGERROR("create lua bytecode cache directory %s failed", cache_dir.c_str());
+                return ptr_t();
+            }
+
+            constructor_helper helper;
+            helper.cache_dir = cache_dir;
+            return std::make_shared<lua_bytecode_cache>(helper);
+        }
+
+        int lua_bytecode_cache::load(lua_State *L, const char *file_path) {
+            struct stat st;
+            if (NULL == file_path || 0 != stat(file_path, &st)) {
+                // 交给luaL_loadfile生成错误信息
+                return luaL_loadfile(L, file_path);
+            }
+
+            size_t                            path_len = strlen(file_path);
+            detail::lua_bytecode_cache_header expect_header;
+            detail::lua_bytecode_cache_init_header(expect_header, st, path_len);
+
+            std::string chunk_name = std::string("@") + file_path;
+            std::string cache_path = make_cache_path(file_path);
+            std::string cache_data;
+
+            // 读缓存
+            if (detail::lua_bytecode_cache_read_file(cache_path, cache_data) &&
+                cache_data.size() > sizeof(expect_header) + path_len &&
+                0 == memcmp(cache_data.data(), &expect_header, sizeof(expect_header)) &&
+                0 == memcmp(cache_data.data() + sizeof(expect_header), file_path, path_len)) {
+                size_t offset = sizeof(expect_header) + path_len;
+                if (LUA_OK == luaL_loadbuffer(L, cache_data.data() + offset, cache_data.size() - offset, chunk_name.c_str())) {
+                    ++stats_.hit_count;
+                    return LUA_OK;
+                }
+
+                // 字节码不可用(比如编译选项不一致)，重新生成
+                lua_pop(L, 1);
+                ++stats_.error_count;
+            }
+
+            ++stats_.miss_count;
+            int ret = luaL_loadfile(L, file_path);
+            if (LUA_OK != ret) {
+                return ret;
+            }
+
+            // 写缓存
+            std::string bytecode;
+            bytecode.append(reinterpret_cast<const char *>(&expect_header), sizeof(expect_header));
+            bytecode.append(file_path, path_len);
+#if LUA_VERSION_NUM >= 503
+            int dump_res = lua_dump(L, detail::lua_bytecode_cache_writer, &bytecode, 0);
+#else
+            int dump_res = lua_dump(L, detail::lua_bytecode_cache_writer, &bytecode);
+#endif
+            if (0 != dump_res) {
+                ++stats_.error_count;
+                return LUA_OK;
+            }
+
+            // 先写临时文件再改名，防止多进程同时写入时读到不完整的缓存，临时文件名各进程和线程不同
+            std::string tmp_path = fn::make_temp_file_path(cache_path);
+            FILE *      f        = fopen(tmp_path.c_str(), "wb");
+            if (NULL == f) {
+                ++stats_.error_count;
+                return LUA_OK;
+            }
+
+            bool write_ok = fwrite(bytecode.data(), 1, bytecode.size(), f) == bytecode.size();
+            fclose(f);
+            if (write_ok) {
+#ifdef _WIN32
+                // windows下rename不会覆盖已存在的文件
+                remove(cache_path.c_str());
+#endif
+                write_ok = 0 == rename(tmp_path.c_str(), cache_path.c_str());
+            }
+
+            if (write_ok) {
+                ++stats_.store_count;
+            } else {
+                remove(tmp_path.c_str());
+                ++stats_.error_count;
+            }
+
+            return LUA_OK;
+        }
+
+        void lua_bytecode_cache::bind(lua_State *L, lua_bytecode_cache *cache) {
+            lua_pushlightuserdata(L, &detail::lua_bytecode_cache_registry_key);
+            if (NULL == cache) {
+                lua_pushnil(L);
+            } else {
+                lua_pushlightuserdata(L, cache);
+            }
+            lua_rawset(L, LUA_REGISTRYINDEX);
+        }
+
+        lua_bytecode_cache *lua_bytecode_cache::get(lua_State *L) {
+            lua_pushlightuserdata(L, &detail::lua_bytecode_cache_registry_key);
+            lua_rawget(L, LUA_REGISTRYINDEX);
+            lua_bytecode_cache *ret = reinterpret_cast<lua_bytecode_cache *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+            return ret;
+        }
+
+        int lua_bytecode_cache::load_file(lua_State *L, const char *file_path) {
+            lua_bytecode_cache *cache = get(L);
+            if (NULL == cache) {
+                return luaL_loadfile(L, file_path);
+            }
+
+            return cache->load(L, file_path);
+        }
+
+        bool lua_bytecode_cache::find_module_file(lua_State *L, const char *module_name, std::string &out) {
+            return lua_module_resolver::find_module_file(L, module_name, out);
+        }
+
+        int lua_bytecode_cache::lua_searcher(lua_State *L) {
+            const char *module_name = luaL_checkstring(L, 1);
+
+            std::string file_path;
+            if (!find_module_file(L, module_name, file_path)) {
+                lua_pushfstring(L, "\n\tno file for module '%s' in bytecode cache searcher", module_name);
+                return 1;
+            }
+
+            if (LUA_OK != load_file(L, file_path.c_str())) {
+                return luaL_error(L, "error loading module '%s' from file '%s':\n\t%s", module_name, file_path.c_str(),
+                                  lua_tostring(L, -1));
+            }
+
+            lua_pushlstring(L, file_path.c_str(), file_path.size());
+            return 2;
+        }
+
+        std::string lua_bytecode_cache::make_cache_path(const char *file_path) const {
+            char name[32] = {0};
+            UTIL_STRFUNC_SNPRINTF(name, sizeof(name), "%016llx.luac", static_cast<unsigned long long>(detail::lua_bytecode_cache_hash(file_path)));
+
+            std::string ret = cache_dir_;
+            ret += util::file_system::DIRECTORY_SEPARATOR;
+            ret += name;
+            return ret;
+        }
+    } // namespace lua
+} // namespace script
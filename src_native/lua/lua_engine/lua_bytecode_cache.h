@@ -0,0 +1,105 @@
+#ifndef SCRIPT_LUA_LUABYTECODECACHE
+#define SCRIPT_LUA_LUABYTECODECACHE
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+extern "C" {
+#include "lauxlib.h"
+#include "lua.h"
+}
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * lua字节码磁盘缓存
+         * 以 文件路径+修改时间+文件大小+Lua版本 作为缓存键，把lua_dump的结果存放到缓存目录下
+         * 缓存有效时直接加载字节码，跳过词法和语法分析
+         * @note 通过bind绑定到lua_State后，fn::exec_file和require(需要调用install_searcher)都会使用缓存
+         */
+        class lua_bytecode_cache : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_bytecode_cache> ptr_t;
+
+            struct stats_t {
+                size_t hit_count;   // 命中缓存的次数
+                size_t miss_count;  // 未命中或缓存失效的次数
+                size_t store_count; // 写入缓存的次数
+                size_t error_count; // 读写缓存失败的次数
+            };
+
+        private:
+            struct constructor_helper {
+                std::string cache_dir;
+            };
+
+        public:
+            lua_bytecode_cache(constructor_helper &helper);
+            ~lua_bytecode_cache();
+
+            /**
+             * @brief 创建字节码缓存
+             * @param cache_dir 缓存目录，不存在时会自动创建
+             * @return 失败返回空指针
+             */
+            static ptr_t create(const std::string &cache_dir);
+
+            /**
+             * @brief 加载lua文件，优先使用缓存
+             * @note 和luaL_loadfile一致，成功时把函数入栈，失败时把错误信息入栈
+             * @return lua错误码
+             */
+            int load(lua_State *L, const char *file_path);
+
+            inline const std::string &get_cache_dir() const { return cache_dir_; }
+
+            inline const stats_t &get_stats() const { return stats_; }
+
+            /**
+             * @brief 绑定到lua_State，cache为NULL时解除绑定
+             * @note 调用者需要保证cache的生命周期长于lua_State
+             */
+            static void bind(lua_State *L, lua_bytecode_cache *cache);
+
+            /**
+             * @brief 获取lua_State绑定的字节码缓存
+             * @return 未绑定时返回NULL
+             */
+            static lua_bytecode_cache *get(lua_State *L);
+
+            /**
+             * @brief 加载lua文件，lua_State绑定了字节码缓存时使用缓存，否则等同于luaL_loadfile
+             */
+            static int load_file(lua_State *L, const char *file_path);
+
+            /**
+             * @brief 按package.path查找模块文件，lua_State绑定了lua_module_resolver时使用解析缓存
+             * @param L lua State
+             * @param module_name 模块名
+             * @param out 输出找到的文件路径
+             * @return 找到返回true
+             */
+            static bool find_module_file(lua_State *L, const char *module_name, std::string &out);
+
+            /**
+             * @brief package.loaders/package.searchers 中使用的加载器，通过lua_engine::add_lua_loader添加
+             */
+            static int lua_searcher(lua_State *L);
+
+        private:
+            std::string make_cache_path(const char *file_path) const;
+
+        private:
+            std::string cache_dir_;
+            stats_t     stats_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
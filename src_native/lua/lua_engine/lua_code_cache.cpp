@@ -0,0 +1,143 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "../lua_module/lua_adaptor.h"
+#include "lua_code_cache.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            static char lua_code_cache_registry_key = 0;
+
+            static uint64_t lua_code_cache_hash(const char *s, size_t &len) {
+                // FNV-1a
+                uint64_t    ret = 14695981039346656037ULL;
+                const char *c   = s;
+                while (*c) {
+                    ret ^= static_cast<unsigned char>(*c);
+                    ret *= 1099511628211ULL;
+                    ++c;
+                }
+
+                len = static_cast<size_t>(c - s);
+                return ret;
+            }
+        } // namespace detail
+
+        lua_code_cache::lua_code_cache(constructor_helper &helper) : state_(helper.L), max_entries_(helper.max_entries) {
+            memset(&stats_, 0, sizeof(stats_));
+        }
+
+        lua_code_cache::~lua_code_cache() {
+            // lua_State已经关闭时不需要再释放引用
+            lru_.clear();
+            index_.clear();
+        }
+
+        lua_code_cache::ptr_t lua_code_cache::create(lua_State *L, size_t max_entries) {
+            if (NULL == L || 0 == max_entries) {
+                return ptr_t();
+            }
+
+            constructor_helper helper;
+            helper.L           = L;
+            helper.max_entries = max_entries;
+            return std::make_shared<lua_code_cache>(helper);
+        }
+
+        int lua_code_cache::load(lua_State *L, const char *codes) {
+            if (NULL == codes) {
+                return luaL_loadstring(L, codes);
+            }
+
+            size_t   len  = 0;
+            uint64_t hash = detail::lua_code_cache_hash(codes, len);
+
+            index_map_t::iterator iter = index_.find(hash);
+            if (index_.end() != iter) {
+                lru_list_t::iterator entry = iter->second;
+                if (entry->code.size() == len && 0 == memcmp(entry->code.data(), codes, len)) {
+                    ++stats_.hit_count;
+                    // 移到LRU头部
+                    lru_.splice(lru_.begin(), lru_, entry);
+                    lua_rawgeti(L, LUA_REGISTRYINDEX, entry->ref);
+                    return LUA_OK;
+                }
+
+                // hash冲突，淘汰旧的
+                luaL_unref(state_, LUA_REGISTRYINDEX, entry->ref);
+                lru_.erase(entry);
+                index_.erase(iter);
+                ++stats_.evict_count;
+            }
+
+            ++stats_.miss_count;
+            int ret = luaL_loadstring(L, codes);
+            if (LUA_OK != ret) {
+                return ret;
+            }
+
+            while (lru_.size() >= max_entries_) {
+                evict_back();
+            }
+
+            lua_pushvalue(L, -1);
+            cache_entry entry;
+            entry.hash = hash;
+            entry.code.assign(codes, len);
+            entry.ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+            lru_.push_front(entry);
+            index_[hash] = lru_.begin();
+            return LUA_OK;
+        }
+
+        void lua_code_cache::clear() {
+            for (lru_list_t::iterator iter = lru_.begin(); iter != lru_.end(); ++iter) {
+                luaL_unref(state_, LUA_REGISTRYINDEX, iter->ref);
+            }
+
+            lru_.clear();
+            index_.clear();
+        }
+
+        void lua_code_cache::bind(lua_State *L, lua_code_cache *cache) {
+            lua_pushlightuserdata(L, &detail::lua_code_cache_registry_key);
+            if (NULL == cache) {
+                lua_pushnil(L);
+            } else {
+                lua_pushlightuserdata(L, cache);
+            }
+            lua_rawset(L, LUA_REGISTRYINDEX);
+        }
+
+        lua_code_cache *lua_code_cache::get(lua_State *L) {
+            lua_pushlightuserdata(L, &detail::lua_code_cache_registry_key);
+            lua_rawget(L, LUA_REGISTRYINDEX);
+            lua_code_cache *ret = reinterpret_cast<lua_code_cache *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+            return ret;
+        }
+
+        int lua_code_cache::load_code(lua_State *L, const char *codes) {
+            lua_code_cache *cache = get(L);
+            if (NULL == cache) {
+                return luaL_loadstring(L, codes);
+            }
+
+            return cache->load(L, codes);
+        }
+
+        void lua_code_cache::evict_back() {
+            if (lru_.empty()) {
+                return;
+            }
+
+            cache_entry &entry = lru_.back();
+            luaL_unref(state_, LUA_REGISTRYINDEX, entry.ref);
+            index_.erase(entry.hash);
+            lru_.pop_back();
+            ++stats_.evict_count;
+        }
+    } // namespace lua
+} // namespace script
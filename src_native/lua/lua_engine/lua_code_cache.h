@@ -0,0 +1,114 @@
+#ifndef SCRIPT_LUA_LUACODECACHE
+#define SCRIPT_LUA_LUACODECACHE
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+extern "C" {
+#include "lauxlib.h"
+#include "lua.h"
+}
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 代码片段编译缓存(LRU)
+         * 以代码字符串的hash为键，把luaL_loadstring编译出的函数保存在registry中，重复执行相同代码时跳过编译
+         * @note 通过bind绑定到lua_State后，fn::exec_code会使用缓存
+         * @note 带环境表的执行接口会修改函数的upvalue，不使用缓存
+         */
+        class lua_code_cache : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_code_cache> ptr_t;
+
+            struct stats_t {
+                size_t hit_count;   // 命中次数
+                size_t miss_count;  // 未命中次数
+                size_t evict_count; // 淘汰次数
+            };
+
+        private:
+            struct constructor_helper {
+                lua_State *L;
+                size_t     max_entries;
+            };
+
+            struct cache_entry {
+                uint64_t    hash;
+                std::string code;
+                int         ref;
+            };
+
+            typedef std::list<cache_entry>                                 lru_list_t;
+            typedef std::unordered_map<uint64_t, lru_list_t::iterator> index_map_t;
+
+        public:
+            lua_code_cache(constructor_helper &helper);
+            ~lua_code_cache();
+
+            /**
+             * @brief 创建代码缓存
+             * @param L lua State，函数引用保存在这个虚拟机的registry中
+             * @param max_entries 最大缓存数量
+             * @return 失败返回空指针
+             */
+            static ptr_t create(lua_State *L, size_t max_entries);
+
+            /**
+             * @brief 编译代码，优先使用缓存
+             * @note 和luaL_loadstring一致，成功时把函数入栈，失败时把错误信息入栈
+             * @return lua错误码
+             */
+            int load(lua_State *L, const char *codes);
+
+            /**
+             * @brief 清空缓存
+             */
+            void clear();
+
+            inline size_t size() const { return lru_.size(); }
+
+            inline size_t get_max_entries() const { return max_entries_; }
+
+            inline const stats_t &get_stats() const { return stats_; }
+
+            /**
+             * @brief 绑定到lua_State，cache为NULL时解除绑定
+             * @note 调用者需要保证cache的生命周期长于lua_State
+             */
+            static void bind(lua_State *L, lua_code_cache *cache);
+
+            /**
+             * @brief 获取lua_State绑定的代码缓存
+             * @return 未绑定时返回NULL
+             */
+            static lua_code_cache *get(lua_State *L);
+
+            /**
+             * @brief 编译代码，lua_State绑定了代码缓存时使用缓存，否则等同于luaL_loadstring
+             */
+            static int load_code(lua_State *L, const char *codes);
+
+        private:
+            void evict_back();
+
+        private:
+            lua_State * state_;
+            size_t      max_entries_;
+            lru_list_t  lru_;
+            index_map_t index_;
+            stats_t     stats_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
@@ -0,0 +1,267 @@
+#include <cstdlib>
+#include <cstring>
+
+#include <log/log_wrapper.h>
+
+#include "../lua_module/lua_adaptor.h"
+#include "lua_coroutine_mgr.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            static char lua_coroutine_mgr_registry_key = 0;
+
+            static int lua_coroutine_mgr_resume(lua_State *co, lua_State *from, int nargs) {
+#if LUA_VERSION_NUM >= 504
+                int nres = 0;
+                return lua_resume(co, from, nargs, &nres);
+#elif LUA_VERSION_NUM >= 502
+                return lua_resume(co, from, nargs);
+#else
+                (void)from;
+                return lua_resume(co, nargs);
+#endif
+            }
+        } // namespace detail
+
+        lua_coroutine_mgr::lua_coroutine_mgr(constructor_helper &helper)
+            : state_(helper.L), max_pool_size_(helper.max_pool_size), token_seq_(0) {
+            memset(&stats_, 0, sizeof(stats_));
+        }
+
+        // lua_State由lua_engine关闭，这里不再访问
+        lua_coroutine_mgr::~lua_coroutine_mgr() {}
+
+        lua_coroutine_mgr::ptr_t lua_coroutine_mgr::create(lua_State *L, size_t max_pool_size) {
+            if (NULL == L) {
+                return ptr_t();
+            }
+
+            constructor_helper helper;
+            helper.L             = L;
+            helper.max_pool_size = max_pool_size;
+            return std::make_shared<lua_coroutine_mgr>(helper);
+        }
+
+        int lua_coroutine_mgr::spawn(int nargs) {
+            lua_State *L = state_;
+            if (nargs < 0 || lua_gettop(L) < nargs + 1 || !lua_isfunction(L, -(nargs + 1))) {
+                WLOGERROR("spawn lua coroutine failed, var in lua stack %d is not a function", -(nargs + 1));
+                lua_pop(L, nargs + 1 > lua_gettop(L) ? lua_gettop(L) : nargs + 1);
+                return -1;
+            }
+
+            lua_State *co = acquire_thread();
+            if (NULL == co) {
+                lua_pop(L, nargs + 1);
+                return -1;
+            }
+
+            ++stats_.spawn_count;
+            lua_xmove(L, co, nargs + 1);
+            resume(co, nargs);
+            return 0;
+        }
+
+        lua_coroutine_mgr::token_t lua_coroutine_mgr::await(lua_State *co) { return wait(co, ready_fn_t(), push_fn_t()); }
+
+        lua_coroutine_mgr::token_t lua_coroutine_mgr::await(lua_State *co, ready_fn_t ready, push_fn_t push) {
+            if (!ready) {
+                return 0;
+            }
+
+            token_t ret = wait(co, ready, push);
+            if (0 != ret) {
+                polling_.push_back(ret);
+            }
+            return ret;
+        }
+
+        void lua_coroutine_mgr::complete(token_t token, push_fn_t push) {
+            completion_t c;
+            c.token = token;
+            c.push  = push;
+            completions_.push(std::move(c));
+        }
+
+        int lua_coroutine_mgr::proc() {
+            int ret = 0;
+
+            // 异步回调完成的协程
+            completion_t c;
+            while (completions_.pop(c)) {
+                std::unordered_map<token_t, waiting_t>::iterator iter = waiting_.find(c.token);
+                if (iter == waiting_.end()) {
+                    continue;
+                }
+
+                lua_State *co = iter->second.co;
+                waiting_.erase(iter);
+                threads_[co].token = 0;
+
+                int nargs = c.push ? c.push(co) : 0;
+                resume(co, nargs);
+                ++ret;
+            }
+
+            // 轮询就绪的协程
+            for (std::list<token_t>::iterator iter = polling_.begin(); iter != polling_.end();) {
+                std::unordered_map<token_t, waiting_t>::iterator wait_iter = waiting_.find(*iter);
+                if (wait_iter == waiting_.end()) {
+                    iter = polling_.erase(iter);
+                    continue;
+                }
+
+                if (!wait_iter->second.ready()) {
+                    ++iter;
+                    continue;
+                }
+
+                iter = polling_.erase(iter);
+
+                lua_State *co   = wait_iter->second.co;
+                push_fn_t  push = wait_iter->second.push;
+                waiting_.erase(wait_iter);
+                threads_[co].token = 0;
+
+                int nargs = push ? push(co) : 0;
+                resume(co, nargs);
+                ++ret;
+            }
+
+            // 脚本主动让出的协程，resume中可能再次加入
+            if (!yielded_.empty()) {
+                std::vector<lua_State *> yielded;
+                yielded.swap(yielded_);
+                for (size_t i = 0; i < yielded.size(); ++i) {
+                    resume(yielded[i], 0);
+                    ++ret;
+                }
+            }
+
+            return ret;
+        }
+
+        lua_coroutine_mgr::stats_t lua_coroutine_mgr::get_stats() const {
+            stats_t ret       = stats_;
+            ret.running_count = threads_.size() - pool_.size();
+            ret.pending_count = waiting_.size();
+            ret.pool_size     = pool_.size();
+            return ret;
+        }
+
+        int lua_coroutine_mgr::yield(lua_State *co) { return lua_yield(co, 0); }
+
+        void lua_coroutine_mgr::bind(lua_State *L, lua_coroutine_mgr *mgr) {
+            lua_pushlightuserdata(L, &detail::lua_coroutine_mgr_registry_key);
+            if (NULL == mgr) {
+                lua_pushnil(L);
+            } else {
+                lua_pushlightuserdata(L, mgr);
+            }
+            lua_rawset(L, LUA_REGISTRYINDEX);
+        }
+
+        lua_coroutine_mgr *lua_coroutine_mgr::get(lua_State *L) {
+            lua_pushlightuserdata(L, &detail::lua_coroutine_mgr_registry_key);
+            lua_rawget(L, LUA_REGISTRYINDEX);
+            lua_coroutine_mgr *ret = reinterpret_cast<lua_coroutine_mgr *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+            return ret;
+        }
+
+        lua_State *lua_coroutine_mgr::acquire_thread() {
+            if (!pool_.empty()) {
+                lua_State *ret = pool_.back();
+                pool_.pop_back();
+                ++stats_.reuse_count;
+                return ret;
+            }
+
+            lua_State *co = lua_newthread(state_);
+            if (NULL == co) {
+                return NULL;
+            }
+
+            thread_t t;
+            t.ref        = luaL_ref(state_, LUA_REGISTRYINDEX);
+            t.token      = 0;
+            threads_[co] = t;
+            return co;
+        }
+
+        void lua_coroutine_mgr::release_thread(lua_State *co, bool reuse) {
+            std::unordered_map<lua_State *, thread_t>::iterator iter = threads_.find(co);
+            if (iter == threads_.end()) {
+                return;
+            }
+
+            if (0 != iter->second.token) {
+                waiting_.erase(iter->second.token);
+                iter->second.token = 0;
+            }
+
+            // lua 5.1-5.3中出错的协程不能再次使用
+            if (reuse && pool_.size() < max_pool_size_) {
+                lua_settop(co, 0);
+                pool_.push_back(co);
+                return;
+            }
+
+            luaL_unref(state_, LUA_REGISTRYINDEX, iter->second.ref);
+            threads_.erase(iter);
+        }
+
+        void lua_coroutine_mgr::resume(lua_State *co, int nargs) {
+            ++stats_.resume_count;
+
+            int res = detail::lua_coroutine_mgr_resume(co, state_, nargs);
+            if (LUA_YIELD == res) {
+                std::unordered_map<lua_State *, thread_t>::iterator iter = threads_.find(co);
+                if (iter != threads_.end() && 0 == iter->second.token) {
+                    yielded_.push_back(co);
+                }
+
+                // 丢弃coroutine.yield传出的值
+                lua_settop(co, 0);
+                return;
+            }
+
+            if (LUA_OK == res) {
+                ++stats_.finish_count;
+                release_thread(co, true);
+                return;
+            }
+
+            ++stats_.error_count;
+#if LUA_VERSION_NUM >= 502
+            luaL_traceback(state_, co, lua_tostring(co, -1), 0);
+            WLOGERROR("[Lua]: coroutine error. ret code: %d\n%s", res, lua_tostring(state_, -1));
+            lua_pop(state_, 1);
+#else
+            WLOGERROR("[Lua]: coroutine error. ret code: %d\n%s", res, lua_tostring(co, -1));
+#endif
+            release_thread(co, false);
+        }
+
+        lua_coroutine_mgr::token_t lua_coroutine_mgr::wait(lua_State *co, ready_fn_t ready, push_fn_t push) {
+            std::unordered_map<lua_State *, thread_t>::iterator iter = threads_.find(co);
+            if (iter == threads_.end()) {
+                return 0;
+            }
+
+            if (0 != iter->second.token) {
+                waiting_.erase(iter->second.token);
+            }
+
+            token_t token      = ++token_seq_;
+            iter->second.token = token;
+
+            waiting_t &w = waiting_[token];
+            w.co         = co;
+            w.ready      = ready;
+            w.push       = push;
+            return token;
+        }
+    } // namespace lua
+} // namespace script
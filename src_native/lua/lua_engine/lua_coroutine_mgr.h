@@ -0,0 +1,174 @@
+#ifndef SCRIPT_LUA_LUACOROUTINEMGR
+#define SCRIPT_LUA_LUACOROUTINEMGR
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include "lauxlib.h"
+#include "lua.h"
+}
+
+#include <design_pattern/noncopyable.h>
+
+#include "lua_mpsc_queue.h"
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 协程调度器
+         * spawn在复用的lua_newthread协程中执行函数，native函数可以调用await挂起当前协程，
+         * 异步操作完成后调用complete(可以在任意线程)，协程会在下一次proc()中恢复执行
+         *
+         * native函数中的用法:
+         * @code
+         *     lua_coroutine_mgr *mgr = lua_coroutine_mgr::get(L);
+         *     lua_coroutine_mgr::token_t token = mgr->await(L);
+         *     if (0 == token) return luaL_error(L, "not in a spawned coroutine");
+         *     start_async_io([mgr, token](result r) {
+         *         mgr->complete(token, [r](lua_State *co) { lua_pushinteger(co, r.code); return 1; });
+         *     });
+         *     return lua_coroutine_mgr::yield(L);
+         * @endcode
+         */
+        class lua_coroutine_mgr : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_coroutine_mgr> ptr_t;
+            typedef uint64_t                           token_t;
+            typedef std::function<int(lua_State *)>    push_fn_t;  // 恢复协程时把结果压入协程栈，返回结果个数
+            typedef std::function<bool()>              ready_fn_t; // proc()中轮询，返回true时恢复协程
+
+            struct stats_t {
+                size_t spawn_count;    // 启动的协程数
+                size_t finish_count;   // 正常结束的协程数
+                size_t error_count;    // 出错结束的协程数
+                size_t resume_count;   // 恢复执行的次数
+                size_t reuse_count;    // 复用协程的次数
+                size_t running_count;  // 当前未结束的协程数
+                size_t pending_count;  // 当前等待异步结果的协程数
+                size_t pool_size;      // 当前可复用的协程数
+            };
+
+        private:
+            struct constructor_helper {
+                lua_State *L;
+                size_t     max_pool_size;
+            };
+
+            struct thread_t {
+                int     ref;   // registry引用
+                token_t token; // 正在等待的令牌
+            };
+
+            struct waiting_t {
+                lua_State *co;
+                ready_fn_t ready;
+                push_fn_t  push;
+            };
+
+            struct completion_t {
+                token_t   token;
+                push_fn_t push;
+            };
+
+        public:
+            lua_coroutine_mgr(constructor_helper &helper);
+            ~lua_coroutine_mgr();
+
+            /**
+             * @brief 创建协程调度器
+             * @param L 主lua State
+             * @param max_pool_size 最大缓存的空闲协程数
+             */
+            static ptr_t create(lua_State *L, size_t max_pool_size = 64);
+
+            /**
+             * @brief 在新协程中执行栈顶的函数
+             * @note 栈上依次是函数和nargs个参数，调用后会全部出栈；协程会立即执行直到第一次挂起或结束
+             * @return 0或错误码
+             */
+            int spawn(int nargs);
+
+            /**
+             * @brief 挂起当前协程，等待complete
+             * @param co 当前协程(native函数的lua_State参数)
+             * @return 完成令牌，co不是spawn创建的协程时返回0
+             * @note 调用后native函数需要 return lua_coroutine_mgr::yield(co)
+             */
+            token_t await(lua_State *co);
+
+            /**
+             * @brief 挂起当前协程，每次proc()时调用ready，返回true时恢复执行
+             * @param co 当前协程
+             * @param ready 就绪检查函数，比如检查std::future::wait_for(0)
+             * @param push 恢复时压入结果，可以为空
+             * @return 完成令牌，co不是spawn创建的协程时返回0
+             */
+            token_t await(lua_State *co, ready_fn_t ready, push_fn_t push);
+
+            /**
+             * @brief 标记异步操作完成，任意线程
+             * @param token await返回的令牌
+             * @param push 恢复时压入结果，可以为空
+             */
+            void complete(token_t token, push_fn_t push);
+
+            /**
+             * @brief 恢复所有已完成的协程
+             * @return 恢复的协程数
+             */
+            int proc();
+
+            inline lua_State *get_lua_state() const { return state_; }
+
+            stats_t get_stats() const;
+
+            /**
+             * @brief 挂起协程，兼容各lua版本
+             */
+            static int yield(lua_State *co);
+
+            /**
+             * @brief 绑定到lua_State，mgr为NULL时解除绑定
+             * @note 调用者需要保证mgr的生命周期长于lua_State
+             */
+            static void bind(lua_State *L, lua_coroutine_mgr *mgr);
+
+            /**
+             * @brief 获取lua_State(或它的协程)绑定的调度器
+             * @return 未绑定时返回NULL
+             */
+            static lua_coroutine_mgr *get(lua_State *L);
+
+        private:
+            lua_State *acquire_thread();
+            void       release_thread(lua_State *co, bool reuse);
+            void       resume(lua_State *co, int nargs);
+            token_t    wait(lua_State *co, ready_fn_t ready, push_fn_t push);
+
+        private:
+            lua_State *state_;
+            size_t     max_pool_size_;
+            token_t    token_seq_;
+
+            std::unordered_map<lua_State *, thread_t> threads_; // 所有协程(包括空闲的)
+            std::vector<lua_State *>                  pool_;
+            std::unordered_map<token_t, waiting_t>    waiting_;
+            std::list<token_t>                        polling_;
+            std::vector<lua_State *>                  yielded_; // 脚本直接调用coroutine.yield的协程，下次proc()继续执行
+            lua_mpsc_queue<completion_t>              completions_;
+
+            stats_t stats_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
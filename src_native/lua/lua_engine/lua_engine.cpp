@@ -1,4 +1,6 @@
-﻿#include <cmath>
+﻿#include <chrono>
+#include <climits>
+#include <cmath>
 #include <cstdlib>
 #include <ctime>
 #include <list>
@@ -21,26 +23,73 @@ namespace script {
     namespace lua {
         extern int lua_profile_openlib(lua_State *L);
 
-        lua_auto_stats::lua_auto_stats(lua_engine &engine) : engine_(&engine) { begin_clock_ = std::chrono::system_clock::now(); }
+        lua_auto_stats::lua_auto_stats(lua_engine &engine, lua_stats_entry entry) : engine_(&engine), entry_(entry), call_target_(NULL) {
+            begin_clock_ = std::chrono::steady_clock::now();
+        }
+
+        lua_auto_stats::lua_auto_stats(lua_engine &engine, const std::string &call_target)
+            : engine_(&engine), entry_(LSE_AUTO_CALL), call_target_(&call_target) {
+            begin_clock_ = std::chrono::steady_clock::now();
+        }
 
         lua_auto_stats::~lua_auto_stats() {
             if (NULL != engine_) {
-                auto duration = (std::chrono::system_clock::now() - begin_clock_);
-                engine_->add_lua_stat_time(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() / 1000.0f);
-                // engine_->add_lua_stat_time(abs(end_clock_ - begin_clock_) * 1.0f / CLOCKS_PER_SEC);
+                auto duration = (std::chrono::steady_clock::now() - begin_clock_);
+                engine_->add_lua_stat_time(entry_, std::chrono::duration_cast<std::chrono::nanoseconds>(duration), call_target_);
+            }
+        }
+
+        static char lua_engine_registry_key = 0;
+
+        lua_auto_budget::lua_auto_budget(lua_engine &engine) : engine_(NULL), state_(NULL) {
+            if (0 == engine.instruction_budget_ || NULL == engine.state_ || NULL != lua_gethook(engine.state_)) {
+                return;
             }
+
+            engine_ = &engine;
+            state_  = engine.state_;
+            engine.instruction_budget_active_ = true;
+            lua_sethook(state_, lua_engine::instruction_budget_hook, LUA_MASKCOUNT, static_cast<int>(engine.instruction_budget_));
+        }
+
+        lua_auto_budget::~lua_auto_budget() {
+            if (NULL != state_) {
+                lua_sethook(state_, NULL, 0, 0);
+                engine_->instruction_budget_active_ = false;
+            }
+        }
+
+        static int lua_engine_panic(lua_State *L) {
+            WLOGERROR("[Lua]: PANIC: unprotected error in call to Lua API (%s)", lua_tostring(L, -1));
+            return 0;
         }
 
-        lua_engine::lua_engine(constructor_helper &helper) : state_(helper.L) {
+        lua_engine::lua_engine(constructor_helper &helper)
+            : state_(helper.L), alloc_(helper.alloc), update_timer_path_("utils.event.update"), manual_gc_(false), gc_step_size_(0), instruction_budget_(0), instruction_budget_active_(false), instruction_breach_count_(0),
+              gc_cycle_count_(0), metrics_sequence_(0), metrics_interval_(std::chrono::milliseconds::zero()) {
             lua_update_stats_.lua_time = 0.0f;
             lua_update_stats_.run_time = 0.0f;
+
+            last_gc_stats_.step_count    = 0;
+            last_gc_stats_.cycle_count   = 0;
+            last_gc_stats_.used_time     = std::chrono::nanoseconds::zero();
+            last_gc_stats_.memory_before = 0;
+            last_gc_stats_.memory_after  = 0;
         }
 
 
         lua_engine::~lua_engine() {
             lua_binding_mgr::me()->remove_lua_engine(this);
+            if (binding_context_) {
+                binding_context_->proc();
+            }
 
             if (state_) {
+                // 关闭时不再重新创建GC哨兵
+                lua_pushlightuserdata(state_, &lua_engine_registry_key);
+                lua_pushnil(state_);
+                lua_rawset(state_, LUA_REGISTRYINDEX);
+
                 lua_close(state_);
                 state_ = NULL;
             }
@@ -75,12 +124,44 @@ namespace script {
             return ret;
         }
 
+        lua_engine::ptr_t lua_engine::create(const lua_engine_alloc::ptr_t &alloc) {
+            if (!alloc) {
+                return create(NULL);
+            }
+
+            lua_State *L = lua_newstate(lua_engine_alloc::lua_alloc_fn, alloc.get());
+            if (NULL == L) {
+                return ptr_t();
+            }
+            lua_atpanic(L, lua_engine_panic);
+
+            constructor_helper helper;
+            helper.L              = L;
+            helper.alloc          = alloc;
+            lua_engine::ptr_t ret = std::make_shared<lua_engine>(helper);
+            if (!ret) {
+                lua_close(L);
+            }
+
+            return ret;
+        }
+
         int lua_engine::init() {
             if (NULL == state_) {
                 return -1;
             }
 
             luaL_openlibs(state_);
+            lua_module_resolver::save_std_searcher(state_);
+            lua_item_path::openlib(state_);
+
+            lua_pushlightuserdata(state_, &lua_engine_registry_key);
+            lua_pushlightuserdata(state_, this);
+            lua_rawset(state_, LUA_REGISTRYINDEX);
+
+            // 开始统计出错次数和GC周期数
+            fn::get_pcall_error_count(state_);
+            create_gc_sentinel(state_);
 
             // add 3rdparty librarys
             // add_ext_lib(luaopen_profiler);
@@ -97,6 +178,12 @@ namespace script {
             add_ext_lib(lua_time_ext_openlib);
 
             // 注册到对象池管理器
+            if (!binding_context_) {
+                binding_context_ = lua_binding_context::create(state_);
+                if (binding_context_) {
+                    lua_binding_context::bind(state_, binding_context_.get());
+                }
+            }
             lua_binding_mgr::me()->add_lua_engine(this);
 
             for (std::function<void(lua_State *)> &fn : on_inited_) {
@@ -106,7 +193,210 @@ namespace script {
             return 0;
         }
 
-        int lua_engine::proc() { return lua_binding_mgr::me()->proc(this); }
+        int lua_engine::proc() {
+            // 在清理引用缓存之前发布，引用缓存大小是两次proc()之间累积的数量
+            bool published = false;
+            if (metrics_interval_ > std::chrono::milliseconds::zero()) {
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (now >= metrics_next_publish_) {
+                    metrics_next_publish_ = now + metrics_interval_;
+                    publish_metrics();
+                    published = true;
+                }
+            }
+
+            int ret = lua_binding_mgr::me()->proc(this);
+
+            // 峰值已经发布，清理引用缓存后按发布周期重新统计
+            if (published && binding_context_) {
+                binding_context_->reset_ref_cache_peak();
+            }
+
+            if (event_queue_) {
+                drain_events();
+            }
+
+            if (coroutine_mgr_) {
+                coroutine_mgr_->proc();
+            }
+
+            return ret;
+        }
+
+        static size_t lua_engine_gc_memory(lua_State *L) {
+            return (static_cast<size_t>(lua_gc(L, LUA_GCCOUNT, 0)) << 10) + static_cast<size_t>(lua_gc(L, LUA_GCCOUNTB, 0));
+        }
+
+        int lua_engine::proc(std::chrono::microseconds gc_budget, lua_gc_step_stats *stats) {
+            int ret = proc();
+
+            last_gc_stats_.step_count  = 0;
+            last_gc_stats_.cycle_count = 0;
+            last_gc_stats_.used_time   = std::chrono::nanoseconds::zero();
+
+            if (NULL != state_ && gc_budget.count() > 0) {
+                last_gc_stats_.memory_before = lua_engine_gc_memory(state_);
+
+                std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+                std::chrono::steady_clock::time_point end   = begin + gc_budget;
+                std::chrono::steady_clock::time_point now   = begin;
+                do {
+                    ++last_gc_stats_.step_count;
+                    if (0 != lua_gc(state_, LUA_GCSTEP, gc_step_size_)) {
+                        ++last_gc_stats_.cycle_count;
+                        // 一个周期完成后没有剩余的工作量，不再继续
+                        now = std::chrono::steady_clock::now();
+                        break;
+                    }
+                    now = std::chrono::steady_clock::now();
+                } while (now < end);
+
+                // lua 5.1的LUA_GCSTEP会重置GC阈值，相当于重新开启了自动GC
+                if (manual_gc_) {
+                    lua_gc(state_, LUA_GCSTOP, 0);
+                }
+
+                last_gc_stats_.used_time    = std::chrono::duration_cast<std::chrono::nanoseconds>(now - begin);
+                last_gc_stats_.memory_after = lua_engine_gc_memory(state_);
+            } else if (NULL != state_) {
+                last_gc_stats_.memory_before = last_gc_stats_.memory_after = lua_engine_gc_memory(state_);
+            }
+
+            if (NULL != stats) {
+                *stats = last_gc_stats_;
+            }
+
+            return ret;
+        }
+
+        void lua_engine::set_manual_gc(bool enable) {
+            manual_gc_ = enable;
+            if (NULL == state_) {
+                return;
+            }
+
+            lua_gc(state_, enable ? LUA_GCSTOP : LUA_GCRESTART, 0);
+        }
+
+        void lua_engine::set_instruction_budget(size_t count) {
+            if (count > static_cast<size_t>(INT_MAX)) {
+                count = static_cast<size_t>(INT_MAX);
+            }
+
+            instruction_budget_ = count;
+            if (NULL != state_ && 0 != count) {
+                lua_pushlightuserdata(state_, &lua_engine_registry_key);
+                lua_pushlightuserdata(state_, this);
+                lua_rawset(state_, LUA_REGISTRYINDEX);
+            }
+        }
+
+        int lua_engine::set_memory_limit(size_t bytes) {
+            if (!alloc_) {
+                return -1;
+            }
+
+            alloc_->set_memory_limit(bytes);
+            return 0;
+        }
+
+        size_t lua_engine::get_memory_limit() const { return alloc_ ? alloc_->get_memory_limit() : 0; }
+
+        lua_budget_stats lua_engine::get_budget_stats() const {
+            lua_budget_stats ret;
+            ret.instruction_breach_count = instruction_breach_count_;
+            ret.memory_breach_count      = alloc_ ? alloc_->get_stats().limit_breach_count : 0;
+            return ret;
+        }
+
+        void lua_engine::publish_metrics() {
+            lua_engine_metrics &m = metrics_buffer_.back();
+
+            m.sequence                   = ++metrics_sequence_;
+            m.timestamp_ms               = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            m.heap_bytes                 = NULL == state_ ? 0 : lua_engine_gc_memory(state_);
+            m.peak_heap_bytes            = alloc_ ? alloc_->get_stats().peak_bytes : 0;
+            m.gc_cycle_count             = gc_cycle_count_;
+            m.pcall_error_count          = NULL == state_ ? 0 : fn::get_pcall_error_count(state_);
+            m.traceback_suppressed_count = NULL == state_ ? 0 : fn::get_pcall_traceback_suppressed_count(state_);
+
+            lua_budget_stats budget_stats = get_budget_stats();
+            m.instruction_breach_count    = budget_stats.instruction_breach_count;
+            m.memory_breach_count         = budget_stats.memory_breach_count;
+
+            // 复用缓冲区里上一次分配的内存
+            m.classes.clear();
+            lua_binding_mgr::me()->collect_class_metrics(state_, m.classes);
+
+            m.entries.resize(LSE_MAX);
+            for (int i = 0; i < LSE_MAX; ++i) {
+                m.entries[i].name    = get_stats_entry_name(static_cast<lua_stats_entry>(i));
+                m.entries[i].summary = entry_stats_[i].get_summary();
+            }
+
+            metrics_buffer_.publish();
+        }
+
+        void lua_engine::set_metrics_interval(std::chrono::milliseconds interval) {
+            metrics_interval_     = interval;
+            metrics_next_publish_ = std::chrono::steady_clock::now();
+        }
+
+        const lua_engine_metrics &lua_engine::read_metrics() { return metrics_buffer_.read(); }
+
+        int lua_engine::write_metrics_file(const std::string &file_path, const std::string &engine_name) {
+            const lua_engine_metrics &m = read_metrics();
+            if (0 == m.sequence) {
+                return -1;
+            }
+
+            return fn::write_prometheus_metrics(m, engine_name, file_path);
+        }
+
+        int lua_engine::gc_sentinel_gc(lua_State *L) {
+            lua_engine *engine = get_registry_engine(L);
+            if (NULL == engine) {
+                return 0;
+            }
+
+            // 哨兵被回收说明完成了一个GC周期，再创建一个新的哨兵等待下一个周期
+            ++engine->gc_cycle_count_;
+            create_gc_sentinel(L);
+            return 0;
+        }
+
+        void lua_engine::create_gc_sentinel(lua_State *L) {
+            lua_newuserdata(L, 1);
+            if (luaL_newmetatable(L, "lua_engine.gc_sentinel")) {
+                lua_pushcfunction(L, gc_sentinel_gc);
+                lua_setfield(L, -2, "__gc");
+            }
+            lua_setmetatable(L, -2);
+            lua_pop(L, 1);
+        }
+
+        lua_engine *lua_engine::get_registry_engine(lua_State *L) {
+            lua_pushlightuserdata(L, &lua_engine_registry_key);
+            lua_rawget(L, LUA_REGISTRYINDEX);
+            lua_engine *ret = reinterpret_cast<lua_engine *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+            return ret;
+        }
+
+        void lua_engine::instruction_budget_hook(lua_State *L, lua_Debug *) {
+            lua_engine *engine = get_registry_engine(L);
+
+            // 计数钩子第一次触发时就已经执行了预算内的全部指令
+            lua_sethook(L, NULL, 0, 0);
+
+            // 协程创建时会复制钩子，预算调用返回后再恢复这些协程时不再限制
+            if (NULL == engine || !engine->instruction_budget_active_) {
+                return;
+            }
+
+            ++engine->instruction_breach_count_;
+            luaL_error(L, "instruction budget exceeded");
+        }
 
         void lua_engine::add_ext_lib(lua_CFunction regfunc) { add_ext_lib(state_, regfunc); }
 
@@ -201,8 +491,126 @@ namespace script {
             lua_pop(L, 1);
         }
 
+        int lua_engine::enable_bytecode_cache(const std::string &cache_dir) {
+            if (NULL == state_) {
+                return -1;
+            }
+
+            if (bytecode_cache_) {
+                return bytecode_cache_->get_cache_dir() == cache_dir ? 0 : -1;
+            }
+
+            bytecode_cache_ = lua_bytecode_cache::create(cache_dir);
+            if (!bytecode_cache_) {
+                return -1;
+            }
+
+            lua_bytecode_cache::bind(state_, bytecode_cache_.get());
+            add_lua_loader(lua_bytecode_cache::lua_searcher);
+            return 0;
+        }
+
+        int lua_engine::enable_module_archive(const std::string &archive_path) {
+            if (NULL == state_) {
+                return -1;
+            }
+
+            if (module_archive_) {
+                return module_archive_->get_archive_path() == archive_path ? 0 : -1;
+            }
+
+            module_archive_ = lua_module_archive::open(archive_path);
+            if (!module_archive_) {
+                return -1;
+            }
+
+            lua_module_archive::bind(state_, module_archive_.get());
+            add_lua_loader(lua_module_archive::lua_searcher);
+            return 0;
+        }
+
+        int lua_engine::enable_module_resolver() {
+            if (NULL == state_) {
+                return -1;
+            }
+
+            if (module_resolver_) {
+                return 0;
+            }
+
+            lua_module_resolver::ptr_t resolver = lua_module_resolver::create();
+            if (!resolver) {
+                return -1;
+            }
+
+            lua_module_resolver::bind(state_, resolver.get());
+            if (0 != lua_module_resolver::install(state_)) {
+                lua_module_resolver::bind(state_, NULL);
+                return -1;
+            }
+
+            module_resolver_ = resolver;
+            return 0;
+        }
+
+        int lua_engine::enable_reload_mgr() {
+            if (NULL == state_) {
+                return -1;
+            }
+
+            if (reload_mgr_) {
+                return 0;
+            }
+
+            lua_reload_mgr::ptr_t mgr = lua_reload_mgr::create(state_);
+            if (!mgr || 0 != mgr->install()) {
+                return -1;
+            }
+
+            reload_mgr_ = mgr;
+            return 0;
+        }
+
+        int lua_engine::save_snapshot(std::string &out) {
+            if (NULL == state_) {
+                return -1;
+            }
+
+            lua_auto_stats autoLuaStat(*this, LSE_OTHER);
+            return fn::snapshot_state(state_, out);
+        }
+
+        int lua_engine::restore_snapshot(const std::string &data) {
+            if (NULL == state_) {
+                return -1;
+            }
+
+            lua_auto_stats autoLuaStat(*this, LSE_OTHER);
+            lua_item_path::invalidate(state_);
+            return fn::restore_state(state_, data.data(), data.size());
+        }
+
+        int lua_engine::enable_code_cache(size_t max_entries) {
+            if (NULL == state_) {
+                return -1;
+            }
+
+            if (code_cache_) {
+                return code_cache_->get_max_entries() == max_entries ? 0 : -1;
+            }
+
+            code_cache_ = lua_code_cache::create(state_, max_entries);
+            if (!code_cache_) {
+                return -1;
+            }
+
+            lua_code_cache::bind(state_, code_cache_.get());
+            return 0;
+        }
+
         bool lua_engine::run_code(const char *codes) {
-            lua::lua_auto_stats autoLuaStat(*this);
+            lua::lua_auto_stats  autoLuaStat(*this, LSE_RUN_CODE);
+            lua::lua_auto_budget autoBudget(*this);
 
             return run_code(state_, codes);
         }
@@ -210,7 +618,8 @@ namespace script {
         bool lua_engine::run_code(lua_State *L, const char *codes) { return fn::exec_code(L, codes); }
 
         bool lua_engine::run_file(const char *file_path) {
-            lua::lua_auto_stats autoLuaStat(*this);
+            lua::lua_auto_stats  autoLuaStat(*this, LSE_RUN_FILE);
+            lua::lua_auto_budget autoBudget(*this);
 
             return run_file(state_, file_path);
         }
@@ -219,13 +628,74 @@ namespace script {
 
         lua_State *lua_engine::get_lua_state() { return state_; }
 
+        const lua_coroutine_mgr::ptr_t &lua_engine::get_coroutine_mgr() {
+            if (!coroutine_mgr_ && NULL != state_) {
+                coroutine_mgr_ = lua_coroutine_mgr::create(state_);
+                if (coroutine_mgr_) {
+                    lua_coroutine_mgr::bind(state_, coroutine_mgr_.get());
+                }
+            }
+
+            return coroutine_mgr_;
+        }
+
+        const lua_event_queue::ptr_t &lua_engine::get_event_queue() {
+            if (!event_queue_ && NULL != state_) {
+                event_queue_ = lua_event_queue::create(state_);
+            }
+
+            return event_queue_;
+        }
+
+        size_t lua_engine::drain_events() {
+            if (!event_queue_ || event_queue_->empty()) {
+                return 0;
+            }
+
+            lua_auto_stats  autoLuaStat(*this, LSE_DRAIN_EVENTS);
+            lua_auto_budget autoBudget(*this);
+            return event_queue_->drain();
+        }
+
+        const lua_tick_scheduler::ptr_t &lua_engine::get_tick_scheduler() {
+            if (!tick_scheduler_ && NULL != state_) {
+                tick_scheduler_ = lua_tick_scheduler::create(state_);
+                if (tick_scheduler_) {
+                    lua_tick_scheduler::openlib(state_, tick_scheduler_.get());
+                }
+            }
+
+            return tick_scheduler_;
+        }
+
+        uint32_t lua_engine::tick(float delta) {
+            const lua_tick_scheduler::ptr_t &scheduler = get_tick_scheduler();
+            if (!scheduler) {
+                return 0;
+            }
+
+            uint32_t steps = scheduler->advance(std::chrono::microseconds(static_cast<int64_t>(delta * 1000000.0f)));
+            float    step  = static_cast<float>(scheduler->get_fixed_step().count() / 1000000.0);
+            for (uint32_t i = 0; i < steps; ++i) {
+                update_global_timer(step);
+            }
+
+            if (scheduler->size() > 0) {
+                lua_auto_stats  autoLuaStat(*this, LSE_TICK_TIMERS);
+                lua_auto_budget autoBudget(*this);
+                scheduler->fire();
+            }
+
+            return steps;
+        }
+
         bool lua_engine::load_item(const std::string &path, bool auto_create_table) {
-            lua::lua_auto_stats autoLuaStat(*this);
+            lua::lua_auto_stats autoLuaStat(*this, LSE_LOAD_ITEM);
             return load_item(get_lua_state(), path, auto_create_table);
         }
 
         bool lua_engine::load_item(const std::string &path, int table_index, bool auto_create_table) {
-            lua::lua_auto_stats autoLuaStat(*this);
+            lua::lua_auto_stats autoLuaStat(*this, LSE_LOAD_ITEM);
             return load_item(get_lua_state(), path, table_index, auto_create_table);
         }
 
@@ -239,16 +709,26 @@ namespace script {
         }
 
         bool lua_engine::remove_item(const std::string &path) {
-            lua::lua_auto_stats autoLuaStat(*this);
+            lua::lua_auto_stats autoLuaStat(*this, LSE_REMOVE_ITEM);
             return remove_item(get_lua_state(), path);
         }
 
         bool lua_engine::remove_item(const std::string &path, int table_index) {
-            lua::lua_auto_stats autoLuaStat(*this);
+            lua::lua_auto_stats autoLuaStat(*this, LSE_REMOVE_ITEM);
             return remove_item(get_lua_state(), path, table_index);
         }
 
 
+        bool lua_engine::load_item(const lua_item_path &path, bool auto_create_table) {
+            lua::lua_auto_stats autoLuaStat(*this, LSE_LOAD_ITEM);
+            return fn::load_item(get_lua_state(), path, auto_create_table);
+        }
+
+        bool lua_engine::remove_item(const lua_item_path &path) {
+            lua::lua_auto_stats autoLuaStat(*this, LSE_REMOVE_ITEM);
+            return fn::remove_item(get_lua_state(), path);
+        }
+
         bool lua_engine::remove_item(lua_State *L, const std::string &path) { return fn::remove_item(L, path); }
 
         bool lua_engine::remove_item(lua_State *L, const std::string &path, int table_index) {
@@ -282,7 +762,7 @@ namespace script {
         }
 
         bool lua_engine::load_global_event_trigger(const std::string &bind_name) {
-            lua::lua_auto_stats autoLuaStat(*this);
+            lua::lua_auto_stats autoLuaStat(*this, LSE_LOAD_EVENT_TRIGGER);
 
             return load_global_event_trigger(get_lua_state(), bind_name);
         }
@@ -291,25 +771,21 @@ namespace script {
 
         int lua_engine::get_pcall_hmsg() { return get_pcall_hmsg(get_lua_state()); }
 
+        void lua_engine::set_traceback_rate_limit(uint32_t rate, uint32_t burst) { fn::set_pcall_traceback_limit(state_, rate, burst); }
+
         void lua_engine::update_global_timer(float delta) {
             lua_State *         state = get_lua_state();
             lua::lua_auto_block block(state);
-            lua_auto_stats      autoLuaStat(*this);
+            lua_auto_stats      autoLuaStat(*this, LSE_UPDATE_GLOBAL_TIMER);
+            lua_auto_budget     autoBudget(*this);
 
             int hmsg = get_pcall_hmsg(state);
 
-            lua_getglobal(state, "utils");
-            if (lua_istable(state, -1)) {
-                lua_getfield(state, -1, "event");
-                if (lua_istable(state, -1)) {
-                    lua_getfield(state, -1, "update");
-                    if (lua_isfunction(state, -1)) {
-                        lua_pushnumber(state, delta);
+            if (update_timer_path_.load(state) && lua_isfunction(state, -1)) {
+                lua_pushnumber(state, delta);
 
-                        if (0 != lua_pcall(state, 1, LUA_MULTRET, hmsg)) {
-                            WLOGERROR("[Lua]: %s", luaL_checkstring(state, -1));
-                        }
-                    }
+                if (0 != lua_pcall(state, 1, LUA_MULTRET, hmsg)) {
+                    WLOGERROR("[Lua]: %s", luaL_checkstring(state, -1));
                 }
             }
 
@@ -318,10 +794,63 @@ namespace script {
 
         void lua_engine::add_lua_stat_time(float delta) { lua_update_stats_.lua_time += delta; }
 
+        void lua_engine::add_lua_stat_time(lua_stats_entry entry, std::chrono::nanoseconds duration, const std::string *call_target) {
+            add_lua_stat_time(static_cast<float>(duration.count() / 1000000000.0));
+
+            if (entry >= 0 && entry < LSE_MAX) {
+                entry_stats_[entry].record(duration);
+            }
+
+            if (NULL != call_target) {
+                call_stats_[*call_target].record(duration);
+            }
+        }
+
         std::pair<float, float> lua_engine::get_and_reset_lua_stats() {
             std::pair<float, float> ret = std::make_pair(lua_update_stats_.lua_time, lua_update_stats_.run_time);
             lua_update_stats_.lua_time = lua_update_stats_.run_time = 0.0f;
             return ret;
         }
+
+        const lua_latency_histogram &lua_engine::get_entry_stats(lua_stats_entry entry) const {
+            if (entry < 0 || entry >= LSE_MAX) {
+                return entry_stats_[LSE_OTHER];
+            }
+
+            return entry_stats_[entry];
+        }
+
+        void lua_engine::reset_latency_stats() {
+            for (int i = 0; i < LSE_MAX; ++i) {
+                entry_stats_[i].reset();
+            }
+
+            call_stats_.clear();
+        }
+
+        const char *lua_engine::get_stats_entry_name(lua_stats_entry entry) {
+            switch (entry) {
+            case LSE_RUN_CODE:
+                return "run_code";
+            case LSE_RUN_FILE:
+                return "run_file";
+            case LSE_LOAD_ITEM:
+                return "load_item";
+            case LSE_REMOVE_ITEM:
+                return "remove_item";
+            case LSE_LOAD_EVENT_TRIGGER:
+                return "load_global_event_trigger";
+            case LSE_UPDATE_GLOBAL_TIMER:
+                return "update_global_timer";
+            case LSE_AUTO_CALL:
+                return "auto_call";
+            case LSE_DRAIN_EVENTS:
+                return "drain_events";
+            case LSE_TICK_TIMERS:
+                return "tick_timers";
+            default:
+                return "other";
+            }
+        }
     } // namespace lua
 } // namespace script
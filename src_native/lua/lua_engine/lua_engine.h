@@ -9,6 +9,7 @@
 #include <functional>
 #include <list>
 #include <string>
+#include <unordered_map>
 
 extern "C" {
 #include "lauxlib.h"
@@ -18,30 +19,96 @@ extern "C" {
 #include <design_pattern/noncopyable.h>
 #include <std/smart_ptr.h>
 
+#include "lua_binding_context.h"
 #include "lua_binding_utils.h"
+#include "lua_binding_wrapper.h"
+#include "lua_bytecode_cache.h"
+#include "lua_code_cache.h"
+#include "lua_coroutine_mgr.h"
+#include "lua_engine_alloc.h"
+#include "lua_engine_metrics.h"
+#include "lua_event_queue.h"
+#include "lua_latency_histogram.h"
+#include "lua_module_archive.h"
+#include "lua_module_resolver.h"
+#include "lua_reload_mgr.h"
+#include "lua_state_snapshot.h"
+#include "lua_tick_scheduler.h"
 
 namespace script {
     namespace lua {
 
         class lua_engine;
 
+        /** lua_engine的统计入口 */
+        enum lua_stats_entry {
+            LSE_RUN_CODE = 0,
+            LSE_RUN_FILE,
+            LSE_LOAD_ITEM,
+            LSE_REMOVE_ITEM,
+            LSE_LOAD_EVENT_TRIGGER,
+            LSE_UPDATE_GLOBAL_TIMER,
+            LSE_AUTO_CALL,
+            LSE_DRAIN_EVENTS,
+            LSE_TICK_TIMERS,
+            LSE_OTHER,
+            LSE_MAX,
+        };
+
         /** A lua automatic statistics. */
         struct lua_auto_stats {
-            lua_auto_stats(lua_engine &engine);
+            lua_auto_stats(lua_engine &engine, lua_stats_entry entry = LSE_OTHER);
+
+            /**
+             * @brief 按调用目标统计，call_target的生命周期必须长于本对象
+             */
+            lua_auto_stats(lua_engine &engine, const std::string &call_target);
             ~lua_auto_stats();
 
-            std::chrono::system_clock::time_point begin_clock_;
+            std::chrono::steady_clock::time_point begin_clock_;
             lua_engine *                          engine_;
-            // std::chrono::system_clock::time_point end_clock_;
+            lua_stats_entry                       entry_;
+            const std::string *                   call_target_;
+        };
+
+        /**
+         * 顶层调用的指令数预算
+         * lua_engine设置了指令预算时，在调用期间安装计数钩子，执行的指令数超过预算时抛出lua错误
+         * @note 嵌套调用或已经安装了其他钩子(比如调试器)时不生效
+         */
+        struct lua_auto_budget {
+            lua_auto_budget(lua_engine &engine);
+            ~lua_auto_budget();
+
+            lua_engine *engine_;
+            lua_State * state_; // 安装了钩子的lua_State，NULL表示未生效
+        };
+
+        /** 预算超限统计 */
+        struct lua_budget_stats {
+            size_t instruction_breach_count; // 超过指令预算的次数
+            size_t memory_breach_count;      // 超过内存上限的次数
+        };
+
+        /** 分帧增量GC的执行统计 */
+        struct lua_gc_step_stats {
+            size_t                   step_count;    // 执行的LUA_GCSTEP次数
+            size_t                   cycle_count;   // 完成的GC周期数
+            std::chrono::nanoseconds used_time;     // 实际使用的时间
+            size_t                   memory_before; // 执行前lua内存(字节)
+            size_t                   memory_after;  // 执行后lua内存(字节)
         };
 
         class lua_engine : public ::util::design_pattern::noncopyable {
         public:
             typedef std::shared_ptr<lua_engine> ptr_t;
 
+            friend struct lua_auto_budget;
+
         private:
             struct constructor_helper {
-                lua_State *L;
+                lua_State *             L;
+                lua_engine_alloc::ptr_t alloc;
             };
 
         public:
@@ -54,10 +121,104 @@ namespace script {
 
             static ptr_t create(lua_State *L);
 
+            /**
+             * @brief 使用指定的内存分配器创建lua虚拟机
+             * @param alloc 分配器，为空时使用luaL_newstate
+             * @return 失败返回空指针
+             */
+            static ptr_t create(const lua_engine_alloc::ptr_t &alloc);
+
+            /**
+             * @brief 获取内存分配器，使用luaL_newstate或外部传入lua_State时返回空指针
+             */
+            inline const lua_engine_alloc::ptr_t &get_allocator() const { return alloc_; }
+
             int init();
 
             int proc();
 
+            /**
+             * @brief 执行proc()，并在时间预算内分步执行增量GC
+             * @param gc_budget GC时间预算，为0时不执行GC
+             * @param stats 输出本次GC的统计，可以为空
+             * @note 每次至少执行一步GC，所以实际耗时可能略超出预算
+             * @return proc()的返回值
+             */
+            int proc(std::chrono::microseconds gc_budget, lua_gc_step_stats *stats = NULL);
+
+            /**
+             * @brief 设置手动GC模式，开启后暂停自动GC，所有的回收都在proc(gc_budget)中执行
+             * @note 手动模式下如果长时间不调用proc(gc_budget)，内存会持续增长
+             */
+            void set_manual_gc(bool enable);
+
+            inline bool is_manual_gc() const { return manual_gc_; }
+
+            /**
+             * @brief 设置每次LUA_GCSTEP的步长(KB)，默认为0(由lua决定)
+             */
+            inline void set_gc_step_size(int kb) { gc_step_size_ = kb; }
+
+            inline int get_gc_step_size() const { return gc_step_size_; }
+
+            /**
+             * @brief 获取最近一次proc(gc_budget)的GC统计
+             */
+            inline const lua_gc_step_stats &get_last_gc_stats() const { return last_gc_stats_; }
+
+            /**
+             * @brief 设置每次顶层调用(run_code、run_file、update_global_timer、auto_call)的指令数预算
+             * @param count 指令数，0表示不限制
+             * @note spawn的协程不受限制，预算调用中创建的协程只在预算调用期间受限制
+             */
+            void set_instruction_budget(size_t count);
+
+            inline size_t get_instruction_budget() const { return instruction_budget_; }
+
+            /**
+             * @brief 设置内存上限，只有使用lua_engine_alloc创建的lua_engine可以设置
+             * @param bytes 上限字节数，0表示不限制
+             * @return 0或错误码
+             */
+            int set_memory_limit(size_t bytes);
+
+            size_t get_memory_limit() const;
+
+            lua_budget_stats get_budget_stats() const;
+
+            /**
+             * @brief 获取完成的GC周期数(通过带__gc的哨兵对象统计)
+             */
+            inline uint64_t get_gc_cycle_count() const { return gc_cycle_count_; }
+
+            /**
+             * @brief 采集当前的指标并发布快照
+             * @note 只能在lua_engine所在的线程调用
+             */
+            void publish_metrics();
+
+            /**
+             * @brief 设置proc()中自动发布指标的间隔
+             * @param interval 间隔，0表示不自动发布
+             * @note 在proc()开始、清理引用缓存之前发布
+             */
+            void set_metrics_interval(std::chrono::milliseconds interval);
+
+            /**
+             * @brief 获取最近一次发布的指标快照，不加锁
+             * @note 可以在其他线程调用，但同时只能有一个线程读取
+             */
+            const lua_engine_metrics &read_metrics();
+
+            /**
+             * @brief 把最近一次发布的指标按Prometheus文本格式写入文件
+             * @note 和read_metrics()的线程限制相同
+             * @param file_path 文件路径
+             * @param engine_name 输出为engine标签
+             * @return 0或错误码
+             */
+            int write_metrics_file(const std::string &file_path, const std::string &engine_name);
+
             void add_ext_lib(lua_CFunction regfunc);
 
             static void add_ext_lib(lua_State *L, lua_CFunction regfunc);
@@ -74,6 +235,66 @@ namespace script {
 
             static void add_lua_loader(lua_State *L, lua_CFunction func);
 
+            /**
+             * @brief 开启字节码磁盘缓存，run_file和require都会优先加载缓存的字节码
+             * @param cache_dir 缓存目录
+             * @return 0或错误码
+             */
+            int enable_bytecode_cache(const std::string &cache_dir);
+
+            inline const lua_bytecode_cache::ptr_t &get_bytecode_cache() const { return bytecode_cache_; }
+
+            /**
+             * @brief 开启代码片段编译缓存，run_code执行相同代码时不再重新编译
+             * @param max_entries 最大缓存数量
+             * @return 0或错误码
+             */
+            int enable_code_cache(size_t max_entries);
+
+            inline const lua_code_cache::ptr_t &get_code_cache() const { return code_cache_; }
+
+            /**
+             * @brief 开启模块归档，require会优先从归档中加载模块
+             * @param archive_path 由lua_module_archive::build生成的归档文件
+             * @return 0或错误码
+             */
+            int enable_module_archive(const std::string &archive_path);
+
+            inline const lua_module_archive::ptr_t &get_module_archive() const { return module_archive_; }
+
+            /**
+             * @brief 开启模块路径解析缓存，替换标准的lua文件加载器
+             * @note 必须在init后调用
+             * @return 0或错误码
+             */
+            int enable_module_resolver();
+
+            inline const lua_module_resolver::ptr_t &get_module_resolver() const { return module_resolver_; }
+
+            /**
+             * @brief 开启增量热更新，记录require的依赖关系并监控模块文件
+             * @note 必须在init后、加载业务模块前调用
+             * @return 0或错误码
+             */
+            int enable_reload_mgr();
+
+            inline const lua_reload_mgr::ptr_t &get_reload_mgr() const { return reload_mgr_; }
+
+            /**
+             * @brief 保存当前全局环境的快照，通常在初始化脚本执行完后调用
+             * @param out 输出快照数据
+             * @return 0或错误码
+             */
+            int save_snapshot(std::string &out);
+
+            /**
+             * @brief 从快照恢复全局环境，用于跳过初始化脚本的执行
+             * @note 必须在init和native绑定完成后调用，恢复后不需要再执行初始化脚本
+             * @param data 由save_snapshot生成的快照数据
+             * @return 0或错误码
+             */
+            int restore_snapshot(const std::string &data);
+
             bool run_code(const char *codes);
 
             static bool run_code(lua_State *L, const char *codes);
@@ -82,8 +303,84 @@ namespace script {
 
             static bool run_file(lua_State *L, const char *file_path);
 
+            /**
+             * @brief 获取协程调度器，第一次调用时创建
+             * @note 协程调度器存在时，proc()会恢复已完成异步操作的协程
+             */
+            const lua_coroutine_mgr::ptr_t &get_coroutine_mgr();
+
+            /**
+             * @brief 在复用的协程中调用lua函数，函数可以通过native的await挂起
+             * @param path 函数路径
+             * @return 0或错误码
+             */
+            template <typename... TParams>
+            int spawn(const std::string &path, TParams &&... params) {
+                const lua_coroutine_mgr::ptr_t &mgr = get_coroutine_mgr();
+                if (!mgr) {
+                    return -1;
+                }
+
+                lua_auto_stats autoLuaStat(*this, path);
+                fn::load_item(state_, path);
+                if (!lua_isfunction(state_, -1)) {
+                    WLOGERROR("var in lua stack %s is not a function.", path.c_str());
+                    lua_pop(state_, 1);
+                    return -1;
+                }
+
+                int param_num = detail::wraper_bat_cmd::wraper_bat_count(state_, std::forward_as_tuple(params...),
+                                                                         typename detail::build_args_index<TParams...>::index_seq_type());
+                return mgr->spawn(param_num);
+            }
+
+            /**
+             * @brief 获取批量事件队列，第一次调用时创建
+             * @note 事件队列存在时，proc()会派发队列中的事件
+             */
+            const lua_event_queue::ptr_t &get_event_queue();
+
+            /**
+             * @brief 把全局事件压入批量事件队列，在drain_events()或proc()中派发
+             * @note 效果等同于utils.event.global:trigger(bind_name, ...)，但多个事件只进入一次lua
+             * @param bind_name 事件名
+             */
+            template <typename... TParams>
+            void push_event(const std::string &bind_name, TParams &&... params) {
+                const lua_event_queue::ptr_t &queue = get_event_queue();
+                if (queue) {
+                    queue->push(bind_name, std::forward<TParams>(params)...);
+                }
+            }
+
+            /**
+             * @brief 派发批量事件队列中的所有事件
+             * @return 派发的事件数
+             */
+            size_t drain_events();
+
+            /**
+             * @brief 获取固定步长的tick调度器，第一次调用时创建，并在lua中注册全局表tick_scheduler
+             */
+            const lua_tick_scheduler::ptr_t &get_tick_scheduler();
+
+            /**
+             * @brief 按固定步长推进一帧
+             * @note 累积的时间每满一个固定步长调用一次update_global_timer，一帧最多执行max_steps步，
+             *       之后按帧预算触发tick调度器中到期的定时器
+             * @param delta 帧间隔(秒)
+             * @return 这一帧执行的固定步数
+             * @see lua_tick_scheduler
+             */
+            uint32_t tick(float delta);
+
             lua_State *get_lua_state();
 
+            /**
+             * @brief 获取绑定上下文，init后有效
+             */
+            inline const lua_binding_context::ptr_t &get_binding_context() const { return binding_context_; }
+
             static bool load_item(lua_State *L, const std::string &path, bool auto_create_table = false);
 
             static bool load_item(lua_State *L, const std::string &path, int table_index, bool auto_create_table = false);
@@ -100,6 +397,10 @@ namespace script {
 
             bool remove_item(const std::string &path, int table_index);
 
+            bool load_item(const lua_item_path &path, bool auto_create_table = false);
+
+            bool remove_item(const lua_item_path &path);
+
             /**
              * Loads event trigger.
              * lua栈将会添加三个元素，分别是utils.event.trigger, utils.event.global 和 bind_name
@@ -138,11 +439,72 @@ namespace script {
 
             int get_pcall_hmsg();
 
+            /**
+             * @brief 限制保护调用出错时生成traceback的频率，防止大量报错时占满CPU
+             * @param rate 每秒允许生成的traceback数，0表示不限制
+             * @param burst 允许突发生成的traceback数
+             * @see fn::set_pcall_traceback_limit
+             */
+            void set_traceback_rate_limit(uint32_t rate, uint32_t burst);
+
             void update_global_timer(float delta);
             void add_lua_stat_time(float delta);
 
+            /**
+             * @brief 记录一次调用耗时
+             * @param entry 入口
+             * @param duration 耗时
+             * @param call_target 调用目标，不为空时同时记录到目标的直方图
+             */
+            void add_lua_stat_time(lua_stats_entry entry, std::chrono::nanoseconds duration, const std::string *call_target = NULL);
+
             std::pair<float, float> get_and_reset_lua_stats();
 
+            /**
+             * @brief 获取入口的耗时直方图
+             */
+            const lua_latency_histogram &get_entry_stats(lua_stats_entry entry) const;
+
+            /**
+             * @brief 获取auto_call各调用目标的耗时直方图
+             */
+            inline const std::unordered_map<std::string, lua_latency_histogram> &get_call_stats() const { return call_stats_; }
+
+            /**
+             * @brief 重置所有耗时直方图
+             */
+            void reset_latency_stats();
+
+            static const char *get_stats_entry_name(lua_stats_entry entry);
+
+            /**
+             * @brief 调用lua函数并按函数路径统计耗时
+             * @see script::lua::auto_call
+             */
+            template <typename... TParams>
+            int auto_call(const std::string &path, TParams &&... params) {
+                lua_auto_stats  autoLuaStat(*this, path);
+                lua_auto_budget autoBudget(*this);
+                return ::script::lua::auto_call(state_, path, std::forward<TParams>(params)...);
+            }
+
+            /**
+             * @brief 按预编译的路径调用lua函数并按函数路径统计耗时
+             * @see script::lua::auto_call
+             */
+            template <typename... TParams>
+            int auto_call(const lua_item_path &path, TParams &&... params) {
+                lua_auto_stats  autoLuaStat(*this, path.get_path());
+                lua_auto_budget autoBudget(*this);
+                return ::script::lua::auto_call(state_, path, std::forward<TParams>(params)...);
+            }
+
+        private:
+            static void instruction_budget_hook(lua_State *L, lua_Debug *ar);
+            static int  gc_sentinel_gc(lua_State *L);
+            static void create_gc_sentinel(lua_State *L);
+            static lua_engine *get_registry_engine(lua_State *L);
+
         private:
             struct lua_stats {
                 float lua_time;
@@ -151,9 +513,35 @@ namespace script {
 
 
             lua_State *                                  state_;
+            lua_engine_alloc::ptr_t                      alloc_;
+            lua_binding_context::ptr_t                   binding_context_;
+            lua_bytecode_cache::ptr_t                    bytecode_cache_;
+            lua_code_cache::ptr_t                        code_cache_;
+            lua_coroutine_mgr::ptr_t                     coroutine_mgr_;
+            lua_event_queue::ptr_t                       event_queue_;
+            lua_tick_scheduler::ptr_t                    tick_scheduler_;
+            lua_module_archive::ptr_t                    module_archive_;
+            lua_module_resolver::ptr_t                   module_resolver_;
+            lua_reload_mgr::ptr_t                        reload_mgr_;
             std::list<std::function<void(lua_State *)> > on_inited_;
-
-            lua_stats lua_update_stats_;
+            lua_item_path                                update_timer_path_;
+
+            lua_stats                                              lua_update_stats_;
+            lua_latency_histogram                                  entry_stats_[LSE_MAX];
+            std::unordered_map<std::string, lua_latency_histogram> call_stats_;
+
+            bool                                                   manual_gc_;
+            int                                                    gc_step_size_;
+            lua_gc_step_stats                                      last_gc_stats_;
+            size_t                                                 instruction_budget_;
+            bool                                                   instruction_budget_active_; // 是否有预算调用正在执行
+            size_t                                                 instruction_breach_count_;
+            uint64_t                                               gc_cycle_count_;
+
+            lua_triple_buffer<lua_engine_metrics>                  metrics_buffer_;
+            uint64_t                                               metrics_sequence_;
+            std::chrono::milliseconds                              metrics_interval_;
+            std::chrono::steady_clock::time_point                  metrics_next_publish_;
         };
     } // namespace lua
 } // namespace script
@@ -0,0 +1,179 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "lua_engine_alloc.h"
+
+namespace script {
+    namespace lua {
+        lua_engine_alloc::lua_engine_alloc() : memory_limit_(0) { memset(&stats_, 0, sizeof(stats_)); }
+
+        lua_engine_alloc::~lua_engine_alloc() {}
+
+        void *lua_engine_alloc::lua_alloc_fn(void *ud, void *ptr, size_t osize, size_t nsize) {
+            lua_engine_alloc *self = reinterpret_cast<lua_engine_alloc *>(ud);
+            // ptr为NULL时osize是对象类型，不是大小
+            size_t old_size = (NULL == ptr) ? 0 : osize;
+
+            if (0 == nsize) {
+                if (NULL != ptr) {
+                    self->reallocate(ptr, osize, 0);
+                    self->stats_.used_bytes -= old_size;
+                    --self->stats_.used_blocks;
+                    ++self->stats_.free_count;
+                }
+                return NULL;
+            }
+
+            // 只限制增长，缩小内存块不允许失败
+            if (0 != self->memory_limit_ && nsize > old_size && self->stats_.used_bytes - old_size + nsize > self->memory_limit_) {
+                ++self->stats_.limit_breach_count;
+                return NULL;
+            }
+
+            void *ret = self->reallocate(ptr, osize, nsize);
+            if (NULL == ret) {
+                ++self->stats_.failed_count;
+                return NULL;
+            }
+
+            self->stats_.used_bytes = self->stats_.used_bytes - old_size + nsize;
+            if (NULL == ptr) {
+                ++self->stats_.used_blocks;
+                ++self->stats_.alloc_count;
+            }
+
+            if (self->stats_.used_bytes > self->stats_.peak_bytes) {
+                self->stats_.peak_bytes = self->stats_.used_bytes;
+            }
+            return ret;
+        }
+
+        void *lua_engine_default_alloc::reallocate(void *ptr, size_t, size_t nsize) {
+            if (0 == nsize) {
+                free(ptr);
+                return NULL;
+            }
+
+            return realloc(ptr, nsize);
+        }
+
+        lua_engine_alloc::ptr_t lua_engine_default_alloc::create() { return std::make_shared<lua_engine_default_alloc>(); }
+
+        lua_engine_pool_alloc::lua_engine_pool_alloc() : chunk_cur_(NULL), chunk_end_(NULL) {
+            for (int i = 0; i < LEVEL_COUNT; ++i) {
+                free_lists_[i] = NULL;
+            }
+            memset(&pool_stats_, 0, sizeof(pool_stats_));
+        }
+
+        lua_engine_pool_alloc::~lua_engine_pool_alloc() {
+            for (size_t i = 0; i < chunks_.size(); ++i) {
+                free(chunks_[i]);
+            }
+            chunks_.clear();
+        }
+
+        void *lua_engine_pool_alloc::reallocate(void *ptr, size_t osize, size_t nsize) {
+            size_t old_size = (NULL == ptr) ? 0 : osize;
+            bool   old_pooled = NULL != ptr && old_size <= MAX_POOL_SIZE;
+            bool   new_pooled = 0 != nsize && nsize <= MAX_POOL_SIZE;
+
+            // 释放
+            if (0 == nsize) {
+                if (old_pooled) {
+                    pool_free(ptr, get_level(old_size));
+                } else {
+                    free(ptr);
+                }
+                return NULL;
+            }
+
+            // 都走realloc
+            if (!new_pooled && (NULL == ptr || !old_pooled)) {
+                ++pool_stats_.fallback_count;
+                return realloc(ptr, nsize);
+            }
+
+            // 同一级别内直接复用
+            if (old_pooled && new_pooled && get_level(old_size) == get_level(nsize)) {
+                return ptr;
+            }
+
+            void *ret;
+            if (new_pooled) {
+                ret = pool_alloc(get_level(nsize));
+            } else {
+                ++pool_stats_.fallback_count;
+                ret = malloc(nsize);
+            }
+
+            if (NULL == ret) {
+                // lua 5.1-5.3要求缩小内存块时不能失败，直接使用原内存块
+                // 原内存块比分级的块大，之后按新的大小释放时放入对应级别的空闲链表，由内存池接管并在析构时释放
+                if (NULL != ptr && nsize <= old_size) {
+                    if (!old_pooled) {
+                        chunks_.push_back(reinterpret_cast<char *>(ptr));
+                    }
+                    return ptr;
+                }
+
+                // 失败时lua要求原内存块保持不变
+                return NULL;
+            }
+
+            if (NULL != ptr) {
+                memcpy(ret, ptr, old_size < nsize ? old_size : nsize);
+                if (old_pooled) {
+                    pool_free(ptr, get_level(old_size));
+                } else {
+                    free(ptr);
+                }
+            }
+
+            return ret;
+        }
+
+        lua_engine_alloc::ptr_t lua_engine_pool_alloc::create() { return std::make_shared<lua_engine_pool_alloc>(); }
+
+        void *lua_engine_pool_alloc::pool_alloc(size_t level) {
+            ++pool_stats_.pooled_count;
+
+            free_node *node = free_lists_[level];
+            if (NULL != node) {
+                free_lists_[level] = node->next;
+                --pool_stats_.free_blocks[level];
+                return node;
+            }
+
+            size_t block_size = (level + 1) * ALIGN_SIZE;
+            if (chunk_cur_ + block_size > chunk_end_) {
+                // 剩余的零碎空间(一定是ALIGN_SIZE的整数倍且小于block_size)放回空闲链表
+                if (NULL != chunk_cur_ && chunk_cur_ + ALIGN_SIZE <= chunk_end_) {
+                    pool_free(chunk_cur_, get_level(static_cast<size_t>(chunk_end_ - chunk_cur_)));
+                }
+
+                char *chunk = reinterpret_cast<char *>(malloc(CHUNK_SIZE));
+                if (NULL == chunk) {
+                    --pool_stats_.pooled_count;
+                    return NULL;
+                }
+
+                chunks_.push_back(chunk);
+                ++pool_stats_.chunk_count;
+                chunk_cur_ = chunk;
+                chunk_end_ = chunk + CHUNK_SIZE;
+            }
+
+            void *ret = chunk_cur_;
+            chunk_cur_ += block_size;
+            return ret;
+        }
+
+        void lua_engine_pool_alloc::pool_free(void *ptr, size_t level) {
+            free_node *node    = reinterpret_cast<free_node *>(ptr);
+            node->next         = free_lists_[level];
+            free_lists_[level] = node;
+            ++pool_stats_.free_blocks[level];
+        }
+    } // namespace lua
+} // namespace script
@@ -0,0 +1,138 @@
+#ifndef SCRIPT_LUA_LUAENGINEALLOC
+#define SCRIPT_LUA_LUAENGINEALLOC
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include "lua.h"
+}
+
+#include <config/compiler_features.h>
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * lua虚拟机内存分配策略
+         * @note 每个lua_engine独占一个分配器，lua_State不是线程安全的，所以分配器也不加锁
+         * @note LuaJIT(64位)不允许自定义分配器，这时候lua_engine::create会失败
+         */
+        class lua_engine_alloc : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_engine_alloc> ptr_t;
+
+            struct stats_t {
+                size_t used_bytes;         // 当前lua使用的字节数
+                size_t used_blocks;        // 当前lua使用的内存块数
+                size_t peak_bytes;         // lua使用的字节数峰值
+                size_t alloc_count;        // 累计分配次数
+                size_t free_count;         // 累计释放次数
+                size_t failed_count;       // 累计分配失败次数
+                size_t limit_breach_count; // 超过内存上限被拒绝的次数
+            };
+
+        protected:
+            lua_engine_alloc();
+
+        public:
+            virtual ~lua_engine_alloc();
+
+            /**
+             * @brief 和lua_Alloc语义一致的分配接口
+             * @param ptr 原内存块，可能为NULL
+             * @param osize 原内存块大小，ptr为NULL时是lua对象类型，不要使用
+             * @param nsize 新内存块大小，为0时表示释放
+             * @return 新内存块，释放或失败时返回NULL
+             */
+            virtual void *reallocate(void *ptr, size_t osize, size_t nsize) = 0;
+
+            /**
+             * @brief 传给lua_newstate的分配函数，ud为lua_engine_alloc指针
+             */
+            static void *lua_alloc_fn(void *ud, void *ptr, size_t osize, size_t nsize);
+
+            inline const stats_t &get_stats() const { return stats_; }
+
+            /**
+             * @brief 设置内存上限，超过上限的分配会失败
+             * @note lua 5.2及以上版本分配失败时会先执行一次完整的GC再重试，仍然失败时抛出内存错误
+             * @note lua 5.3及以上版本即使GC已停止(手动GC模式)也会执行紧急GC；lua 5.1和GC已停止的lua 5.2直接抛出内存错误
+             * @param bytes 上限字节数，0表示不限制
+             */
+            inline void set_memory_limit(size_t bytes) { memory_limit_ = bytes; }
+
+            inline size_t get_memory_limit() const { return memory_limit_; }
+
+        private:
+            stats_t stats_;
+            size_t  memory_limit_;
+        };
+
+        /**
+         * 默认分配器，使用realloc/free，仅增加统计
+         */
+        class lua_engine_default_alloc : public lua_engine_alloc {
+        public:
+            virtual void *reallocate(void *ptr, size_t osize, size_t nsize) UTIL_CONFIG_OVERRIDE;
+
+            static ptr_t create();
+        };
+
+        /**
+         * 分级内存池分配器
+         * 小于等于 MAX_POOL_SIZE 的内存块按 ALIGN_SIZE 对齐分级，从按 CHUNK_SIZE 批量申请的内存块中切分，释放后放回对应的空闲链表
+         * 大内存块直接使用realloc/free
+         * @note 切分出去的内存块在分配器销毁前不会归还给系统
+         */
+        class lua_engine_pool_alloc : public lua_engine_alloc {
+        public:
+            enum {
+                ALIGN_SIZE    = 16,
+                MAX_POOL_SIZE = 256,
+                LEVEL_COUNT   = MAX_POOL_SIZE / ALIGN_SIZE,
+                CHUNK_SIZE    = 64 * 1024,
+            };
+
+            struct pool_stats_t {
+                size_t chunk_count;                 // 已申请的内存块数
+                size_t free_blocks[LEVEL_COUNT];    // 各级空闲链表中的内存块数
+                size_t pooled_count;                // 从内存池分配的次数
+                size_t fallback_count;              // 超过MAX_POOL_SIZE走realloc的次数
+            };
+
+        public:
+            lua_engine_pool_alloc();
+            virtual ~lua_engine_pool_alloc();
+
+            virtual void *reallocate(void *ptr, size_t osize, size_t nsize) UTIL_CONFIG_OVERRIDE;
+
+            inline const pool_stats_t &get_pool_stats() const { return pool_stats_; }
+
+            static ptr_t create();
+
+        private:
+            struct free_node {
+                free_node *next;
+            };
+
+            static inline size_t get_level(size_t sz) { return (sz + ALIGN_SIZE - 1) / ALIGN_SIZE - 1; }
+
+            void *pool_alloc(size_t level);
+            void  pool_free(void *ptr, size_t level);
+
+        private:
+            free_node *         free_lists_[LEVEL_COUNT];
+            char *              chunk_cur_;
+            char *              chunk_end_;
+            std::vector<char *> chunks_; // 分配的大块和缩小失败时接管的内存块，析构时释放
+            pool_stats_t        pool_stats_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
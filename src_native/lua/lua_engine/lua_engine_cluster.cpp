@@ -0,0 +1,228 @@
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "lua_engine_cluster.h"
+#include "lua_serialize.h"
+
+namespace script {
+    namespace lua {
+        lua_engine_cluster::lua_engine_cluster(constructor_helper &helper)
+            : tick_interval_(std::chrono::milliseconds(1)), cpu_affinity_(false), running_(false) {
+            workers_.reserve(helper.thread_count);
+            for (size_t i = 0; i < helper.thread_count; ++i) {
+                std::unique_ptr<worker_node> worker(new worker_node());
+                worker->index = i;
+                workers_.push_back(std::move(worker));
+            }
+        }
+
+        lua_engine_cluster::~lua_engine_cluster() {
+            stop();
+
+            // 先销毁lua_engine，再销毁邮箱
+            for (size_t i = 0; i < engines_.size(); ++i) {
+                engines_[i]->engine.reset();
+            }
+        }
+
+        lua_engine_cluster::ptr_t lua_engine_cluster::create(size_t thread_count, size_t engine_count, creator_fn_t creator) {
+            if (0 == thread_count || 0 == engine_count || !creator) {
+                return ptr_t();
+            }
+
+            constructor_helper helper;
+            helper.thread_count = thread_count;
+            ptr_t ret           = std::make_shared<lua_engine_cluster>(helper);
+            if (!ret) {
+                return ret;
+            }
+
+            ret->engines_.reserve(engine_count);
+            for (size_t i = 0; i < engine_count; ++i) {
+                std::unique_ptr<engine_node> node(new engine_node());
+                node->id     = static_cast<uint32_t>(i);
+                node->engine = creator(node->id);
+                if (!node->engine || NULL == node->engine->get_lua_state()) {
+                    WLOGERROR("lua_engine_cluster create lua_engine %u failed", node->id);
+                    return ptr_t();
+                }
+
+                openlib(node->engine->get_lua_state(), ret.get(), node->id);
+                ret->workers_[i % thread_count]->engines.push_back(node.get());
+                ret->engines_.push_back(std::move(node));
+            }
+
+            return ret;
+        }
+
+        void lua_engine_cluster::set_tick(tick_fn_t fn, std::chrono::microseconds interval) {
+            tick_fn_       = fn;
+            tick_interval_ = interval;
+        }
+
+        int lua_engine_cluster::start() {
+            bool expect = false;
+            if (!running_.compare_exchange_strong(expect, true, std::memory_order_acq_rel)) {
+                return 0;
+            }
+
+            for (size_t i = 0; i < workers_.size(); ++i) {
+                worker_node *worker = workers_[i].get();
+                worker->thread.reset(new std::thread(std::bind(&lua_engine_cluster::worker_main, this, worker)));
+            }
+
+            return 0;
+        }
+
+        void lua_engine_cluster::stop() {
+            running_.store(false, std::memory_order_release);
+
+            for (size_t i = 0; i < workers_.size(); ++i) {
+                if (workers_[i]->thread && workers_[i]->thread->joinable()) {
+                    workers_[i]->thread->join();
+                }
+                workers_[i]->thread.reset();
+            }
+        }
+
+        lua_engine::ptr_t lua_engine_cluster::get_engine(uint32_t engine_id) const {
+            if (engine_id >= engines_.size()) {
+                return lua_engine::ptr_t();
+            }
+
+            return engines_[engine_id]->engine;
+        }
+
+        bool lua_engine_cluster::send(uint32_t to, uint32_t from, std::string data) {
+            if (to >= engines_.size()) {
+                return false;
+            }
+
+            message_t msg;
+            msg.from = from;
+            msg.data.swap(data);
+            engines_[to]->mailbox.push(std::move(msg));
+            return true;
+        }
+
+        bool lua_engine_cluster::post(uint32_t to, task_fn_t fn) {
+            if (to >= engines_.size() || !fn) {
+                return false;
+            }
+
+            engines_[to]->tasks.push(std::move(fn));
+            return true;
+        }
+
+        bool lua_engine_cluster::recv(uint32_t engine_id, message_t &out) {
+            if (engine_id >= engines_.size()) {
+                return false;
+            }
+
+            return engines_[engine_id]->mailbox.pop(out);
+        }
+
+        void lua_engine_cluster::worker_main(worker_node *worker) {
+#if defined(__linux__)
+            if (cpu_affinity_) {
+                unsigned int cpu_count = std::thread::hardware_concurrency();
+                if (cpu_count > 0) {
+                    cpu_set_t cpu_set;
+                    CPU_ZERO(&cpu_set);
+                    CPU_SET(static_cast<int>(worker->index % cpu_count), &cpu_set);
+                    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+                }
+            }
+#endif
+
+            while (running_.load(std::memory_order_acquire)) {
+                for (size_t i = 0; i < worker->engines.size(); ++i) {
+                    engine_node *node = worker->engines[i];
+
+                    task_fn_t task;
+                    while (node->tasks.pop(task)) {
+                        task(*node->engine);
+                    }
+
+                    if (tick_fn_) {
+                        tick_fn_(*node->engine, node->id);
+                    } else {
+                        node->engine->proc();
+                    }
+                }
+
+                if (tick_interval_.count() > 0) {
+                    std::this_thread::sleep_for(tick_interval_);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        void lua_engine_cluster::openlib(lua_State *L, lua_engine_cluster *self, uint32_t engine_id) {
+            int top = lua_gettop(L);
+
+            luaL_Reg lib_funcs[] = {{"send", lua_send}, {"recv", lua_recv}, {"self", lua_self}, {"size", lua_size}, {NULL, NULL}};
+
+            lua_createtable(L, 0, 4);
+            for (luaL_Reg *reg = lib_funcs; NULL != reg->name; ++reg) {
+                lua_pushlightuserdata(L, self);
+                lua_pushinteger(L, static_cast<lua_Integer>(engine_id));
+                lua_pushcclosure(L, reg->func, 2);
+                lua_setfield(L, -2, reg->name);
+            }
+            lua_setglobal(L, "cluster");
+
+            lua_settop(L, top);
+        }
+
+        // cluster.send(engine_id, msg)
+        int lua_engine_cluster::lua_send(lua_State *L) {
+            lua_engine_cluster *self = reinterpret_cast<lua_engine_cluster *>(lua_touserdata(L, lua_upvalueindex(1)));
+            uint32_t            from = static_cast<uint32_t>(lua_tointeger(L, lua_upvalueindex(2)));
+            lua_Integer         to   = luaL_checkinteger(L, 1);
+
+            std::string data;
+            if (NULL == self || to < 0 || !fn::serialize_value(L, 2, data)) {
+                lua_pushboolean(L, 0);
+                return 1;
+            }
+
+            lua_pushboolean(L, self->send(static_cast<uint32_t>(to), from, std::move(data)) ? 1 : 0);
+            return 1;
+        }
+
+        // msg, from = cluster.recv()
+        int lua_engine_cluster::lua_recv(lua_State *L) {
+            lua_engine_cluster *self = reinterpret_cast<lua_engine_cluster *>(lua_touserdata(L, lua_upvalueindex(1)));
+            uint32_t            id   = static_cast<uint32_t>(lua_tointeger(L, lua_upvalueindex(2)));
+
+            message_t msg;
+            if (NULL == self || !self->recv(id, msg)) {
+                lua_pushnil(L);
+                return 1;
+            }
+
+            fn::deserialize_value(L, msg.data.data(), msg.data.size());
+            lua_pushinteger(L, static_cast<lua_Integer>(msg.from));
+            return 2;
+        }
+
+        // cluster.self()
+        int lua_engine_cluster::lua_self(lua_State *L) {
+            lua_pushvalue(L, lua_upvalueindex(2));
+            return 1;
+        }
+
+        // cluster.size()
+        int lua_engine_cluster::lua_size(lua_State *L) {
+            lua_engine_cluster *self = reinterpret_cast<lua_engine_cluster *>(lua_touserdata(L, lua_upvalueindex(1)));
+            lua_pushinteger(L, NULL == self ? 0 : static_cast<lua_Integer>(self->get_engine_count()));
+            return 1;
+        }
+    } // namespace lua
+} // namespace script
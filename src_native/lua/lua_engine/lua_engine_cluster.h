@@ -0,0 +1,140 @@
+#ifndef SCRIPT_LUA_LUAENGINECLUSTER
+#define SCRIPT_LUA_LUAENGINECLUSTER
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <design_pattern/noncopyable.h>
+
+#include "lua_engine.h"
+#include "lua_mpsc_queue.h"
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 多线程lua_engine集群
+         * 每个工作线程独占若干个lua_engine，每个lua_engine有一个无锁MPSC邮箱，可以在任意线程投递序列化的消息或闭包
+         * lua中通过 cluster.send(engine_id, msg) 发送消息，cluster.recv() 接收消息
+         * @note lua_engine在create时于调用线程创建和初始化，start后只在所属的工作线程中运行
+         */
+        class lua_engine_cluster : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_engine_cluster>           ptr_t;
+            typedef std::function<lua_engine::ptr_t(uint32_t)>    creator_fn_t; // 参数为engine_id，需要完成init()
+            typedef std::function<void(lua_engine &, uint32_t)>   tick_fn_t;    // 工作线程每次循环对每个lua_engine调用
+            typedef std::function<void(lua_engine &)>             task_fn_t;    // 投递到lua_engine所在线程执行的闭包
+
+            struct message_t {
+                uint32_t    from;
+                std::string data;
+            };
+
+        private:
+            struct engine_node {
+                uint32_t                  id;
+                lua_engine::ptr_t         engine;
+                lua_mpsc_queue<message_t> mailbox;
+                lua_mpsc_queue<task_fn_t> tasks;
+            };
+
+            struct worker_node {
+                size_t                       index;
+                std::vector<engine_node *>   engines;
+                std::unique_ptr<std::thread> thread;
+            };
+
+            struct constructor_helper {
+                size_t thread_count;
+            };
+
+        public:
+            lua_engine_cluster(constructor_helper &helper);
+            ~lua_engine_cluster();
+
+            /**
+             * @brief 创建集群
+             * @param thread_count 工作线程数
+             * @param engine_count lua_engine总数，按engine_id % thread_count分配到工作线程
+             * @param creator 创建函数
+             * @return 失败返回空指针
+             */
+            static ptr_t create(size_t thread_count, size_t engine_count, creator_fn_t creator);
+
+            /**
+             * @brief 设置工作线程的循环函数，默认只执行lua_engine::proc()
+             * @note 必须在start前调用
+             */
+            void set_tick(tick_fn_t fn, std::chrono::microseconds interval);
+
+            /**
+             * @brief 设置是否把工作线程绑定到CPU核心(仅linux)
+             * @note 必须在start前调用
+             */
+            inline void set_cpu_affinity(bool v) { cpu_affinity_ = v; }
+
+            int start();
+
+            void stop();
+
+            inline bool is_running() const { return running_.load(std::memory_order_acquire); }
+
+            inline size_t get_engine_count() const { return engines_.size(); }
+
+            inline size_t get_thread_count() const { return workers_.size(); }
+
+            /**
+             * @brief 获取lua_engine，只能在所属的工作线程或集群未启动时使用
+             */
+            lua_engine::ptr_t get_engine(uint32_t engine_id) const;
+
+            /**
+             * @brief 发送已序列化的消息，任意线程
+             * @return 目标不存在时返回false
+             */
+            bool send(uint32_t to, uint32_t from, std::string data);
+
+            /**
+             * @brief 投递闭包到目标lua_engine所在线程执行，任意线程
+             * @return 目标不存在时返回false
+             */
+            bool post(uint32_t to, task_fn_t fn);
+
+            /**
+             * @brief 接收消息，只能在目标lua_engine所在线程调用
+             * @return 没有消息时返回false
+             */
+            bool recv(uint32_t engine_id, message_t &out);
+
+        private:
+            void worker_main(worker_node *worker);
+
+            static void openlib(lua_State *L, lua_engine_cluster *self, uint32_t engine_id);
+
+            static int lua_send(lua_State *L);
+            static int lua_recv(lua_State *L);
+            static int lua_self(lua_State *L);
+            static int lua_size(lua_State *L);
+
+        private:
+            std::vector<std::unique_ptr<engine_node> > engines_;
+            std::vector<std::unique_ptr<worker_node> > workers_;
+
+            tick_fn_t                 tick_fn_;
+            std::chrono::microseconds tick_interval_;
+            bool                      cpu_affinity_;
+            std::atomic<bool>         running_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
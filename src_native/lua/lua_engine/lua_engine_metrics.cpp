@@ -0,0 +1,179 @@
+#include <cstdio>
+#include <cstring>
+
+#include <common/string_oprs.h>
+#include <log/log_wrapper.h>
+
+#include "lua_binding_utils.h"
+#include "lua_engine_metrics.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            static void lua_metrics_append_label(std::string &out, const char *key, const std::string &value) {
+                out += key;
+                out += "=\"";
+                for (size_t i = 0; i < value.size(); ++i) {
+                    switch (value[i]) {
+                    case '\\':
+                        out += "\\\\";
+                        break;
+                    case '"':
+                        out += "\\\"";
+                        break;
+                    case '\n':
+                        out += "\\n";
+                        break;
+                    default:
+                        out += value[i];
+                        break;
+                    }
+                }
+                out += '"';
+            }
+
+            static void lua_metrics_append_header(std::string &out, const char *name, const char *type, const char *help) {
+                out += "# HELP ";
+                out += name;
+                out += ' ';
+                out += help;
+                out += "\n# TYPE ";
+                out += name;
+                out += ' ';
+                out += type;
+                out += '\n';
+            }
+
+            static void lua_metrics_append_value(std::string &out, const char *name, const std::string &labels, double value) {
+                char buf[64];
+                UTIL_STRFUNC_SNPRINTF(buf, sizeof(buf), "%.17g", value);
+
+                out += name;
+                out += '{';
+                out += labels;
+                out += "} ";
+                out += buf;
+                out += '\n';
+            }
+
+            static double lua_metrics_seconds(std::chrono::nanoseconds ns) { return static_cast<double>(ns.count()) / 1000000000.0; }
+        } // namespace detail
+
+        namespace fn {
+            void format_prometheus_metrics(const lua_engine_metrics &metrics, const std::string &engine_name, std::string &out) {
+                std::string engine_label;
+                detail::lua_metrics_append_label(engine_label, "engine", engine_name);
+
+                detail::lua_metrics_append_header(out, "lua_engine_heap_bytes", "gauge", "Lua heap size reported by LUA_GCCOUNT.");
+                detail::lua_metrics_append_value(out, "lua_engine_heap_bytes", engine_label, static_cast<double>(metrics.heap_bytes));
+
+                detail::lua_metrics_append_header(out, "lua_engine_peak_heap_bytes", "gauge", "Peak bytes recorded by the engine allocator.");
+                detail::lua_metrics_append_value(out, "lua_engine_peak_heap_bytes", engine_label, static_cast<double>(metrics.peak_heap_bytes));
+
+                detail::lua_metrics_append_header(out, "lua_engine_gc_cycles_total", "counter", "Completed Lua GC cycles.");
+                detail::lua_metrics_append_value(out, "lua_engine_gc_cycles_total", engine_label, static_cast<double>(metrics.gc_cycle_count));
+
+                detail::lua_metrics_append_header(out, "lua_engine_pcall_errors_total", "counter", "Protected calls that raised an error.");
+                detail::lua_metrics_append_value(out, "lua_engine_pcall_errors_total", engine_label, static_cast<double>(metrics.pcall_error_count));
+
+                detail::lua_metrics_append_header(out, "lua_engine_traceback_suppressed_total", "counter",
+                                                  "Protected call errors whose traceback was dropped by the rate limiter.");
+                detail::lua_metrics_append_value(out, "lua_engine_traceback_suppressed_total", engine_label,
+                                                 static_cast<double>(metrics.traceback_suppressed_count));
+
+                detail::lua_metrics_append_header(out, "lua_engine_instruction_breaches_total", "counter", "Calls aborted by the instruction budget.");
+                detail::lua_metrics_append_value(out, "lua_engine_instruction_breaches_total", engine_label,
+                                                 static_cast<double>(metrics.instruction_breach_count));
+
+                detail::lua_metrics_append_header(out, "lua_engine_memory_breaches_total", "counter", "Allocations refused by the memory limit.");
+                detail::lua_metrics_append_value(out, "lua_engine_memory_breaches_total", engine_label,
+                                                 static_cast<double>(metrics.memory_breach_count));
+
+                if (!metrics.classes.empty()) {
+                    detail::lua_metrics_append_header(out, "lua_engine_live_objects", "gauge", "Live Lua userdata of bound native classes in this engine.");
+                    for (size_t i = 0; i < metrics.classes.size(); ++i) {
+                        std::string labels = engine_label + ",";
+                        detail::lua_metrics_append_label(labels, "class", metrics.classes[i].class_name);
+                        detail::lua_metrics_append_value(out, "lua_engine_live_objects", labels,
+                                                         static_cast<double>(metrics.classes[i].live_objects));
+                    }
+
+                    detail::lua_metrics_append_header(out, "lua_engine_ref_cache_size", "gauge", "Native objects held by the ref cache of this engine.");
+                    for (size_t i = 0; i < metrics.classes.size(); ++i) {
+                        std::string labels = engine_label + ",";
+                        detail::lua_metrics_append_label(labels, "class", metrics.classes[i].class_name);
+                        detail::lua_metrics_append_value(out, "lua_engine_ref_cache_size", labels,
+                                                         static_cast<double>(metrics.classes[i].ref_cache_size));
+                    }
+
+                    detail::lua_metrics_append_header(out, "lua_engine_ref_cache_peak", "gauge", "Peak size of the ref cache between two proc calls since the last publish from proc.");
+                    for (size_t i = 0; i < metrics.classes.size(); ++i) {
+                        std::string labels = engine_label + ",";
+                        detail::lua_metrics_append_label(labels, "class", metrics.classes[i].class_name);
+                        detail::lua_metrics_append_value(out, "lua_engine_ref_cache_peak", labels,
+                                                         static_cast<double>(metrics.classes[i].ref_cache_peak));
+                    }
+                }
+
+                if (!metrics.entries.empty()) {
+                    detail::lua_metrics_append_header(out, "lua_engine_entry_latency_seconds", "summary", "Latency of calls into Lua by entry point.");
+                    for (size_t i = 0; i < metrics.entries.size(); ++i) {
+                        const lua_entry_metrics &entry = metrics.entries[i];
+                        std::string              labels = engine_label + ",";
+                        detail::lua_metrics_append_label(labels, "entry", NULL == entry.name ? "" : entry.name);
+
+                        detail::lua_metrics_append_value(out, "lua_engine_entry_latency_seconds", labels + ",quantile=\"0.5\"",
+                                                         detail::lua_metrics_seconds(entry.summary.p50));
+                        detail::lua_metrics_append_value(out, "lua_engine_entry_latency_seconds", labels + ",quantile=\"0.99\"",
+                                                         detail::lua_metrics_seconds(entry.summary.p99));
+                        detail::lua_metrics_append_value(out, "lua_engine_entry_latency_seconds_sum", labels,
+                                                         detail::lua_metrics_seconds(entry.summary.total));
+                        detail::lua_metrics_append_value(out, "lua_engine_entry_latency_seconds_count", labels,
+                                                         static_cast<double>(entry.summary.count));
+                    }
+
+                    detail::lua_metrics_append_header(out, "lua_engine_entry_latency_max_seconds", "gauge", "Max latency of calls into Lua by entry point.");
+                    for (size_t i = 0; i < metrics.entries.size(); ++i) {
+                        const lua_entry_metrics &entry = metrics.entries[i];
+                        std::string              labels = engine_label + ",";
+                        detail::lua_metrics_append_label(labels, "entry", NULL == entry.name ? "" : entry.name);
+                        detail::lua_metrics_append_value(out, "lua_engine_entry_latency_max_seconds", labels,
+                                                         detail::lua_metrics_seconds(entry.summary.max));
+                    }
+                }
+            }
+
+            int write_prometheus_metrics(const lua_engine_metrics &metrics, const std::string &engine_name, const std::string &file_path) {
+                std::string content;
+                format_prometheus_metrics(metrics, engine_name, content);
+
+                // 先写临时文件再重命名，避免收集器读到写了一半的文件
+                std::string tmp_path = make_temp_file_path(file_path);
+                FILE *      f        = fopen(tmp_path.c_str(), "wb");
+                if (NULL == f) {
+                    WLOGERROR("open metrics file %s failed", tmp_path.c_str());
+                    return -1;
+                }
+
+                size_t written = fwrite(content.data(), 1, content.size(), f);
+                fclose(f);
+                if (written != content.size()) {
+                    WLOGERROR("write metrics file %s failed", tmp_path.c_str());
+                    remove(tmp_path.c_str());
+                    return -1;
+                }
+
+#ifdef _WIN32
+                remove(file_path.c_str());
+#endif
+                if (0 != rename(tmp_path.c_str(), file_path.c_str())) {
+                    WLOGERROR("rename metrics file %s to %s failed", tmp_path.c_str(), file_path.c_str());
+                    remove(tmp_path.c_str());
+                    return -1;
+                }
+
+                return 0;
+            }
+        } // namespace fn
+    }     // namespace lua
+} // namespace script
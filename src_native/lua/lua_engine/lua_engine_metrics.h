@@ -0,0 +1,103 @@
+#ifndef SCRIPT_LUA_LUAENGINEMETRICS
+#define SCRIPT_LUA_LUAENGINEMETRICS
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "lua_latency_histogram.h"
+
+namespace script {
+    namespace lua {
+
+        /** 绑定类的指标 */
+        struct lua_class_metrics {
+            std::string class_name;
+            int64_t     live_objects;   // 当前lua_State中存活的lua userdata数
+            size_t      ref_cache_size; // 当前lua_State的引用缓存大小
+            size_t      ref_cache_peak; // 当前lua_State的引用缓存从上一次自动发布开始，在两次proc()之间的最大值
+        };
+
+        /** 入口耗时指标 */
+        struct lua_entry_metrics {
+            const char *                       name;
+            lua_latency_histogram::summary_t summary;
+        };
+
+        /** lua_engine的指标快照 */
+        struct lua_engine_metrics {
+            uint64_t                       sequence;                   // 发布序号，0表示还没有发布过
+            int64_t                        timestamp_ms;               // 发布时间(unix时间戳，毫秒)
+            size_t                         heap_bytes;                 // LUA_GCCOUNT报告的堆大小
+            size_t                         peak_heap_bytes;            // 分配器记录的峰值，没有自定义分配器时为0
+            uint64_t                       gc_cycle_count;             // 完成的GC周期数
+            uint64_t                       pcall_error_count;          // 使用get_pcall_hmsg的保护调用出错次数
+            uint64_t                       traceback_suppressed_count; // 被限流没有生成traceback的出错次数
+            size_t                         instruction_breach_count;
+            size_t                         memory_breach_count;
+            std::vector<lua_class_metrics> classes;
+            std::vector<lua_entry_metrics> entries;
+
+            lua_engine_metrics()
+                : sequence(0), timestamp_ms(0), heap_bytes(0), peak_heap_bytes(0), gc_cycle_count(0), pcall_error_count(0),
+                  traceback_suppressed_count(0), instruction_breach_count(0), memory_breach_count(0) {}
+        };
+
+        /**
+         * 单生产者单消费者的三缓冲区
+         * 写线程在back()上填充数据后publish()，读线程read()总是拿到最近一次发布的完整数据，双方都不加锁
+         * @note 同时只能有一个写线程和一个读线程
+         */
+        template <typename T>
+        class lua_triple_buffer {
+        private:
+            enum { DIRTY_FLAG = 0x4, INDEX_MASK = 0x3 };
+
+        public:
+            lua_triple_buffer() : middle_(1), back_(0), front_(2) {}
+
+            /** 写线程使用 */
+            inline T &back() { return slots_[back_]; }
+
+            /** 写线程使用，发布back()中的数据 */
+            inline void publish() { back_ = middle_.exchange(back_ | DIRTY_FLAG, std::memory_order_acq_rel) & INDEX_MASK; }
+
+            /** 读线程使用，获取最近一次发布的数据 */
+            const T &read() {
+                if (middle_.load(std::memory_order_relaxed) & DIRTY_FLAG) {
+                    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+                }
+
+                return slots_[front_];
+            }
+
+        private:
+            T                     slots_[3];
+            std::atomic<uint32_t> middle_;
+            uint32_t              back_;
+            uint32_t              front_;
+        };
+
+        namespace fn {
+            /**
+             * @brief 把指标按Prometheus文本格式输出
+             * @param metrics 指标快照
+             * @param engine_name 输出为engine标签
+             * @param out 输出，数据会追加到末尾
+             */
+            void format_prometheus_metrics(const lua_engine_metrics &metrics, const std::string &engine_name, std::string &out);
+
+            /**
+             * @brief 把指标按Prometheus文本格式写入文件(先写临时文件再重命名，供node_exporter的textfile收集器读取)
+             * @return 0或错误码
+             */
+            int write_prometheus_metrics(const lua_engine_metrics &metrics, const std::string &engine_name, const std::string &file_path);
+        } // namespace fn
+    }     // namespace lua
+} // namespace script
+
+#endif
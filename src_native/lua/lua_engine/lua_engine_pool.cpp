@@ -0,0 +1,194 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "lua_engine_pool.h"
+
+namespace script {
+    namespace lua {
+        lua_engine_pool::lua_engine_pool(constructor_helper &helper)
+            : prewarm_count_(helper.prewarm_count), creator_(helper.creator), reset_(helper.reset), refill_running_(false) {
+            memset(&stats_, 0, sizeof(stats_));
+            engines_.reserve(prewarm_count_);
+        }
+
+        lua_engine_pool::~lua_engine_pool() {
+            stop_background_refill();
+
+            std::lock_guard<std::mutex> guard(lock_);
+            engines_.clear();
+        }
+
+        lua_engine_pool::ptr_t lua_engine_pool::create(size_t prewarm_count, creator_fn_t creator, reset_fn_t reset) {
+            if (!creator) {
+                return ptr_t();
+            }
+
+            constructor_helper helper;
+            helper.prewarm_count = prewarm_count;
+            helper.creator       = creator;
+            helper.reset         = reset;
+
+            ptr_t ret = std::make_shared<lua_engine_pool>(helper);
+            if (!ret) {
+                return ret;
+            }
+
+            // 第一个lua_engine在调用线程创建，初始化所有绑定类型的管理器单例
+            if (ret->prewarm_count_ > 0) {
+                lua_engine::ptr_t first = ret->create_engine();
+                if (!first) {
+                    return ptr_t();
+                }
+
+                std::lock_guard<std::mutex> guard(ret->lock_);
+                ret->engines_.push_back(first);
+            }
+
+            return ret;
+        }
+
+        lua_engine::ptr_t lua_engine_pool::acquire() {
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                ++stats_.acquire_count;
+                if (!engines_.empty()) {
+                    lua_engine::ptr_t ret = engines_.back();
+                    engines_.pop_back();
+                    refill_cv_.notify_one();
+                    // 后台线程创建的lua_engine交给调用线程
+                    if (ret->get_binding_context()) {
+                        ret->get_binding_context()->set_owner_thread();
+                    }
+                    return ret;
+                }
+
+                ++stats_.miss_count;
+                refill_cv_.notify_one();
+            }
+
+            return create_engine();
+        }
+
+        void lua_engine_pool::release(lua_engine::ptr_t engine) {
+            if (!engine) {
+                return;
+            }
+
+            bool reusable = reset_ && reset_(*engine);
+            if (reusable) {
+                // 清理C++对象的引用缓存，防止复用后长时间持有对象
+                engine->proc();
+            }
+
+            std::lock_guard<std::mutex> guard(lock_);
+            if (reusable && engines_.size() < prewarm_count_) {
+                ++stats_.reused_count;
+                engines_.push_back(engine);
+                return;
+            }
+
+            ++stats_.discarded_count;
+            refill_cv_.notify_one();
+            // engine在这里释放，lua_close在调用release的线程执行
+        }
+
+        int lua_engine_pool::refill() { return refill(false); }
+
+        int lua_engine_pool::refill(bool background) {
+            int ret = 0;
+            while (true) {
+                {
+                    std::lock_guard<std::mutex> guard(lock_);
+                    // 创建lua_engine比较慢，后台线程每创建一个都检查是否已经停止，避免stop_background_refill()等待补满
+                    if (engines_.size() >= prewarm_count_ || (background && !refill_running_)) {
+                        break;
+                    }
+                }
+
+                lua_engine::ptr_t engine = create_engine();
+                if (!engine) {
+                    return -1;
+                }
+
+                std::lock_guard<std::mutex> guard(lock_);
+                if (engines_.size() >= prewarm_count_) {
+                    break;
+                }
+                engines_.push_back(engine);
+                ++ret;
+            }
+
+            return ret;
+        }
+
+        int lua_engine_pool::start_background_refill() {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (refill_thread_) {
+                return 0;
+            }
+
+            refill_running_ = true;
+            refill_thread_.reset(new std::thread(std::bind(&lua_engine_pool::background_refill_main, this)));
+            return 0;
+        }
+
+        void lua_engine_pool::stop_background_refill() {
+            std::unique_ptr<std::thread> thd;
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                refill_running_ = false;
+                thd.swap(refill_thread_);
+                refill_cv_.notify_all();
+            }
+
+            if (thd && thd->joinable()) {
+                thd->join();
+            }
+        }
+
+        size_t lua_engine_pool::size() const {
+            std::lock_guard<std::mutex> guard(lock_);
+            return engines_.size();
+        }
+
+        lua_engine_pool::stats_t lua_engine_pool::get_stats() const {
+            std::lock_guard<std::mutex> guard(lock_);
+            return stats_;
+        }
+
+        lua_engine::ptr_t lua_engine_pool::create_engine() {
+            lua_engine::ptr_t ret = creator_();
+            if (!ret) {
+                WLOGERROR("lua_engine_pool create lua_engine failed");
+                return ret;
+            }
+
+            std::lock_guard<std::mutex> guard(lock_);
+            ++stats_.created_count;
+            return ret;
+        }
+
+        void lua_engine_pool::background_refill_main() {
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> guard(lock_);
+                    while (refill_running_ && engines_.size() >= prewarm_count_) {
+                        refill_cv_.wait(guard);
+                    }
+
+                    if (!refill_running_) {
+                        break;
+                    }
+                }
+
+                if (refill(true) < 0) {
+                    // 创建失败时等待下一次通知，避免空转
+                    std::unique_lock<std::mutex> guard(lock_);
+                    if (refill_running_) {
+                        refill_cv_.wait(guard);
+                    }
+                }
+            }
+        }
+    } // namespace lua
+} // namespace script
@@ -0,0 +1,122 @@
+#ifndef SCRIPT_LUA_LUAENGINEPOOL
+#define SCRIPT_LUA_LUAENGINEPOOL
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <design_pattern/noncopyable.h>
+
+#include "lua_engine.h"
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 预热的lua_engine池
+         * 池内保持若干个已经执行完init()、绑定注册和启动脚本的lua_engine，acquire时直接取出
+         * release时调用reset函数，返回true则放回池中复用，否则丢弃并由后台线程补充新的lua_engine
+         * @note lua_engine取出后只能被一个线程使用，池本身是线程安全的
+         * @note 第一个lua_engine会在create时同步创建，以保证所有LUA_BIND_OBJECT的类型管理器在后台线程启动前已经初始化
+         */
+        class lua_engine_pool : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_engine_pool>             ptr_t;
+            typedef std::function<lua_engine::ptr_t()>           creator_fn_t; // 创建并初始化lua_engine
+            typedef std::function<bool(lua_engine &)>            reset_fn_t;   // 重置lua_engine，返回false表示不可复用
+
+            struct stats_t {
+                size_t created_count;   // 累计创建的lua_engine个数
+                size_t acquire_count;   // 累计取出次数
+                size_t miss_count;      // 取出时池为空，在调用线程同步创建的次数
+                size_t reused_count;    // 重置后放回池中的次数
+                size_t discarded_count; // 丢弃的次数
+            };
+
+        private:
+            struct constructor_helper {
+                size_t       prewarm_count;
+                creator_fn_t creator;
+                reset_fn_t   reset;
+            };
+
+        public:
+            lua_engine_pool(constructor_helper &helper);
+            ~lua_engine_pool();
+
+            /**
+             * @brief 创建lua_engine池
+             * @param prewarm_count 池内保持的lua_engine个数
+             * @param creator 创建函数，需要完成init()和启动脚本
+             * @param reset 重置函数，为空时release的lua_engine都会被丢弃
+             * @return 失败返回空指针
+             */
+            static ptr_t create(size_t prewarm_count, creator_fn_t creator, reset_fn_t reset = reset_fn_t());
+
+            /**
+             * @brief 取出一个已初始化的lua_engine，池为空时同步创建
+             * @return 失败返回空指针
+             */
+            lua_engine::ptr_t acquire();
+
+            /**
+             * @brief 归还lua_engine
+             */
+            void release(lua_engine::ptr_t engine);
+
+            /**
+             * @brief 在调用线程补充lua_engine直到达到预热数量
+             * @return 新创建的个数，失败返回-1
+             */
+            int refill();
+
+            /**
+             * @brief 启动后台补充线程
+             * @return 0或错误码
+             */
+            int start_background_refill();
+
+            /**
+             * @brief 停止后台补充线程，正在创建的lua_engine完成后就退出，不会等到补满
+             */
+            void stop_background_refill();
+
+            size_t size() const;
+
+            inline size_t get_prewarm_count() const { return prewarm_count_; }
+
+            stats_t get_stats() const;
+
+        private:
+            lua_engine::ptr_t create_engine();
+
+            /**
+             * @param background 后台线程调用，每创建一个lua_engine检查一次是否已经停止
+             */
+            int refill(bool background);
+
+            void background_refill_main();
+
+        private:
+            size_t       prewarm_count_;
+            creator_fn_t creator_;
+            reset_fn_t   reset_;
+
+            mutable std::mutex             lock_;
+            std::condition_variable        refill_cv_;
+            std::vector<lua_engine::ptr_t> engines_;
+            stats_t                        stats_;
+
+            bool                         refill_running_;
+            std::unique_ptr<std::thread> refill_thread_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
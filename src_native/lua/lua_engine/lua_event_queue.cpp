@@ -0,0 +1,248 @@
+#include <cstdlib>
+#include <cstring>
+
+#include <log/log_wrapper.h>
+
+#include "../lua_module/lua_adaptor.h"
+#include "lua_binding_utils.h"
+#include "lua_event_queue.h"
+
+namespace script {
+    namespace lua {
+        lua_event_queue::lua_event_queue(constructor_helper &helper) : state_(helper.L), dispatch_pos_(0), in_dispatch_(false), dispatcher_missing_(false) {
+            memset(&stats_, 0, sizeof(stats_));
+        }
+
+        lua_event_queue::~lua_event_queue() {}
+
+        lua_event_queue::ptr_t lua_event_queue::create(lua_State *L) {
+            if (NULL == L) {
+                return ptr_t();
+            }
+
+            constructor_helper helper;
+            helper.L = L;
+            return std::make_shared<lua_event_queue>(helper);
+        }
+
+        void lua_event_queue::begin_event(const char *bind_name, size_t len) {
+            event_t e;
+            e.name_offset = pending_.strings.size();
+            e.name_length = len;
+            e.arg_begin   = pending_.args.size();
+            e.arg_count   = 0;
+            pending_.strings.append(bind_name, len);
+            pending_.events.push_back(e);
+        }
+
+        void lua_event_queue::push_arg() { append_arg(EAT_NIL); }
+
+        void lua_event_queue::push_arg(bool v) {
+            arg_t &arg  = append_arg(EAT_BOOLEAN);
+            arg.value.b = v;
+        }
+
+        void lua_event_queue::push_arg(const char *v) {
+            if (NULL == v) {
+                push_arg();
+                return;
+            }
+
+            push_arg(v, strlen(v));
+        }
+
+        void lua_event_queue::push_arg(const char *v, size_t len) {
+            // 先追加字符串，append_arg返回的引用在追加参数前一直有效
+            size_t offset = pending_.strings.size();
+            pending_.strings.append(v, len);
+
+            arg_t &arg         = append_arg(EAT_STRING);
+            arg.value.s.offset = offset;
+            arg.value.s.length = len;
+        }
+
+        void lua_event_queue::push_arg(const std::string &v) { push_arg(v.data(), v.size()); }
+
+        size_t lua_event_queue::drain() {
+            if (in_dispatch_ || pending_.events.empty() || NULL == state_) {
+                return 0;
+            }
+
+            // 交换缓冲区，派发过程中压入的事件进入下一批
+            dispatching_.events.clear();
+            dispatching_.args.clear();
+            dispatching_.strings.clear();
+            dispatching_.events.swap(pending_.events);
+            dispatching_.args.swap(pending_.args);
+            dispatching_.strings.swap(pending_.strings);
+
+            size_t batch_size = dispatching_.events.size();
+            ++stats_.drain_count;
+            if (batch_size > stats_.max_batch_size) {
+                stats_.max_batch_size = batch_size;
+            }
+
+            lua_State *L        = state_;
+            int        top      = lua_gettop(L);
+            bool       reported = dispatcher_missing_;
+            size_t     dropped  = 0;
+            in_dispatch_        = true;
+            dispatch_pos_       = 0;
+            dispatcher_missing_ = false;
+
+            // 正常情况下只有一次lua_pcall，监听器出错时从下一个事件重新进入
+            while (!dispatcher_missing_ && dispatch_pos_ < batch_size) {
+                int hmsg = fn::get_pcall_hmsg(L);
+                lua_pushlightuserdata(L, this);
+                lua_pushcclosure(L, lua_dispatch, 1);
+                if (0 != lua_pcall(L, 0, 0, hmsg)) {
+                    const event_t *e = NULL;
+                    if (0 == dispatch_pos_) {
+                        // 查找派发器时出错(比如元方法报错)，整批事件都不能派发
+                        e             = &dispatching_.events.front();
+                        dropped       = batch_size;
+                        dispatch_pos_ = batch_size;
+                        stats_.error_count += batch_size;
+                    } else {
+                        e = &dispatching_.events[dispatch_pos_ - 1];
+                        ++stats_.error_count;
+                    }
+
+                    const char *event_name = dispatching_.strings.data() + e->name_offset;
+                    size_t      name_len   = e->name_length;
+                    const char *err_msg    = lua_tostring(L, -1);
+                    WLOGERROR("[Lua]: dispatch event %.*s failed.\n%s", static_cast<int>(name_len), event_name,
+                              NULL == err_msg ? "unknown error" : err_msg);
+                }
+                lua_settop(L, top);
+            }
+
+            in_dispatch_ = false;
+            if (dispatcher_missing_) {
+                // 一个事件都没有派发，整批放回队列，持续缺失时只输出一次日志
+                if (!reported) {
+                    const event_t &e = dispatching_.events.front();
+                    WLOGERROR("[Lua]: utils.event.global.trigger is not available, %llu events are kept in queue, first event: %.*s",
+                              static_cast<unsigned long long>(batch_size), static_cast<int>(e.name_length), dispatching_.strings.data() + e.name_offset);
+                }
+
+                requeue_dispatching();
+                return 0;
+            }
+
+            stats_.event_count += batch_size - dropped;
+            return batch_size - dropped;
+        }
+
+        void lua_event_queue::requeue_dispatching() {
+            // 查找派发器的过程中可能压入了新的事件，追加到被放回的事件之后
+            size_t string_base = dispatching_.strings.size();
+            size_t arg_base    = dispatching_.args.size();
+            dispatching_.strings.append(pending_.strings);
+            for (size_t i = 0; i < pending_.args.size(); ++i) {
+                dispatching_.args.push_back(pending_.args[i]);
+                if (EAT_STRING == pending_.args[i].type) {
+                    dispatching_.args.back().value.s.offset += string_base;
+                }
+            }
+            for (size_t i = 0; i < pending_.events.size(); ++i) {
+                dispatching_.events.push_back(pending_.events[i]);
+                dispatching_.events.back().name_offset += string_base;
+                dispatching_.events.back().arg_begin += arg_base;
+            }
+
+            pending_.events.swap(dispatching_.events);
+            pending_.args.swap(dispatching_.args);
+            pending_.strings.swap(dispatching_.strings);
+            dispatching_.events.clear();
+            dispatching_.args.clear();
+            dispatching_.strings.clear();
+        }
+
+        void lua_event_queue::clear() {
+            pending_.events.clear();
+            pending_.args.clear();
+            pending_.strings.clear();
+        }
+
+        lua_event_queue::arg_t &lua_event_queue::append_arg(arg_type t) {
+            if (pending_.events.empty()) {
+                // 没有调用begin_event时追加到空事件名的事件
+                begin_event("", 0);
+            }
+
+            ++pending_.events.back().arg_count;
+            pending_.args.push_back(arg_t());
+            arg_t &ret = pending_.args.back();
+            ret.type   = t;
+            return ret;
+        }
+
+        void lua_event_queue::push_lua_arg(lua_State *L, const batch_t &batch, const arg_t &arg) const {
+            switch (arg.type) {
+            case EAT_BOOLEAN:
+                lua_pushboolean(L, arg.value.b ? 1 : 0);
+                break;
+            case EAT_INTEGER:
+                lua_pushinteger(L, static_cast<lua_Integer>(arg.value.i));
+                break;
+            case EAT_NUMBER:
+                lua_pushnumber(L, static_cast<lua_Number>(arg.value.d));
+                break;
+            case EAT_STRING:
+                lua_pushlstring(L, batch.strings.data() + arg.value.s.offset, arg.value.s.length);
+                break;
+            default:
+                lua_pushnil(L);
+                break;
+            }
+        }
+
+        int lua_event_queue::lua_dispatch(lua_State *L) {
+            lua_event_queue *self = reinterpret_cast<lua_event_queue *>(lua_touserdata(L, lua_upvalueindex(1)));
+            const batch_t &  batch = self->dispatching_;
+
+            // 每批只查找一次utils.event.global和trigger
+            lua_getglobal(L, "utils");
+            if (lua_istable(L, -1)) {
+                lua_getfield(L, -1, "event");
+                lua_remove(L, -2);
+            }
+            if (lua_istable(L, -1)) {
+                lua_getfield(L, -1, "global");
+                lua_remove(L, -2);
+            }
+            if (!lua_istable(L, -1)) {
+                self->dispatcher_missing_ = true;
+                return 0;
+            }
+            int global_index = lua_gettop(L);
+
+            lua_getfield(L, global_index, "trigger");
+            if (!lua_isfunction(L, -1)) {
+                self->dispatcher_missing_ = true;
+                return 0;
+            }
+            int trigger_index = lua_gettop(L);
+
+            luaL_checkstack(L, 3, "lua event queue");
+            while (self->dispatch_pos_ < batch.events.size()) {
+                const event_t &e = batch.events[self->dispatch_pos_];
+                // 先移动下标，出错后从下一个事件继续
+                ++self->dispatch_pos_;
+
+                luaL_checkstack(L, static_cast<int>(e.arg_count) + 3, "lua event queue");
+                lua_pushvalue(L, trigger_index);
+                lua_pushvalue(L, global_index);
+                lua_pushlstring(L, batch.strings.data() + e.name_offset, e.name_length);
+                for (size_t i = 0; i < e.arg_count; ++i) {
+                    self->push_lua_arg(L, batch, batch.args[e.arg_begin + i]);
+                }
+
+                lua_call(L, static_cast<int>(e.arg_count) + 2, 0);
+            }
+
+            return 0;
+        }
+    } // namespace lua
+} // namespace script
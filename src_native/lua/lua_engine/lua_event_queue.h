@@ -0,0 +1,167 @@
+#ifndef SCRIPT_LUA_LUAEVENTQUEUE
+#define SCRIPT_LUA_LUAEVENTQUEUE
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include "lauxlib.h"
+#include "lua.h"
+}
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 批量事件队列
+         * native代码把事件压入队列，drain()时只进入一次lua(一次lua_pcall)，
+         * 在同一个保护调用内依次调用utils.event.global:trigger(bind_name, ...)派发所有事件
+         * 某个事件的监听器出错时记录日志，并从下一个事件继续派发
+         * utils.event.global.trigger不存在(比如utils.event还没有加载)时，整批事件保留在队列中，下一次drain()时再派发
+         * @note 参数只支持nil、boolean、整数、浮点数和字符串，字符串会被复制
+         * @note 非线程安全，只能在lua_engine所在的线程使用
+         */
+        class lua_event_queue : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_event_queue> ptr_t;
+
+            struct stats_t {
+                size_t drain_count;    // drain()次数(不包含空队列)
+                size_t event_count;    // 派发的事件数
+                size_t error_count;    // 出错的事件数
+                size_t max_batch_size; // 单次派发的最大事件数
+            };
+
+        private:
+            struct constructor_helper {
+                lua_State *L;
+            };
+
+            enum arg_type {
+                EAT_NIL = 0,
+                EAT_BOOLEAN,
+                EAT_INTEGER,
+                EAT_NUMBER,
+                EAT_STRING,
+            };
+
+            struct arg_t {
+                arg_type type;
+                union {
+                    bool    b;
+                    int64_t i;
+                    double  d;
+                    struct {
+                        size_t offset;
+                        size_t length;
+                    } s;
+                } value;
+            };
+
+            struct event_t {
+                size_t name_offset;
+                size_t name_length;
+                size_t arg_begin;
+                size_t arg_count;
+            };
+
+            struct batch_t {
+                std::vector<event_t> events;
+                std::vector<arg_t>   args;
+                std::string          strings; // 事件名和字符串参数
+            };
+
+        public:
+            lua_event_queue(constructor_helper &helper);
+            ~lua_event_queue();
+
+            static ptr_t create(lua_State *L);
+
+            /**
+             * @brief 压入一个事件
+             * @param bind_name 事件名
+             * @param params 事件参数
+             */
+            template <typename... TParams>
+            void push(const std::string &bind_name, TParams &&... params) {
+                begin_event(bind_name.data(), bind_name.size());
+                push_args(std::forward<TParams>(params)...);
+            }
+
+            /**
+             * @brief 开始压入一个事件，之后调用push_arg追加参数
+             */
+            void begin_event(const char *bind_name, size_t len);
+
+            void push_arg();
+            void push_arg(bool v);
+            void push_arg(const char *v);
+            void push_arg(const char *v, size_t len);
+            void push_arg(const std::string &v);
+
+            template <typename T>
+            typename std::enable_if<std::is_integral<T>::value>::type push_arg(T v) {
+                arg_t &arg  = append_arg(EAT_INTEGER);
+                arg.value.i = static_cast<int64_t>(v);
+            }
+
+            template <typename T>
+            typename std::enable_if<std::is_floating_point<T>::value>::type push_arg(T v) {
+                arg_t &arg  = append_arg(EAT_NUMBER);
+                arg.value.d = static_cast<double>(v);
+            }
+
+            /**
+             * @brief 派发队列中的所有事件
+             * @note 派发过程中压入的事件会在下一次drain()中派发
+             * @note 没有utils.event.global.trigger时不派发，事件保留在队列中
+             * @return 派发的事件数
+             */
+            size_t drain();
+
+            inline size_t size() const { return pending_.events.size(); }
+
+            inline bool empty() const { return pending_.events.empty(); }
+
+            void clear();
+
+            inline const stats_t &get_stats() const { return stats_; }
+
+        private:
+            inline void push_args() {}
+
+            template <typename TArg, typename... TParams>
+            void push_args(TArg &&arg, TParams &&... params) {
+                push_arg(std::forward<TArg>(arg));
+                push_args(std::forward<TParams>(params)...);
+            }
+
+            arg_t &append_arg(arg_type t);
+            void   requeue_dispatching();
+            void   push_lua_arg(lua_State *L, const batch_t &batch, const arg_t &arg) const;
+
+            static int lua_dispatch(lua_State *L);
+
+        private:
+            lua_State *state_;
+            batch_t    pending_;
+            batch_t    dispatching_;
+            size_t     dispatch_pos_; // 正在派发的事件下标
+            bool       in_dispatch_;
+            bool       dispatcher_missing_; // 没有找到utils.event.global.trigger
+            stats_t    stats_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
@@ -0,0 +1,113 @@
+#include <mutex>
+#include <unordered_map>
+
+extern "C" {
+#include "lauxlib.h"
+}
+
+#include "lua_binding_context.h"
+#include "lua_interned_key.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            struct lua_interned_key_registry {
+                std::mutex                              lock;
+                std::unordered_map<std::string, size_t> ids;
+            };
+
+            // 函数内静态变量，保证在其他编译单元的静态lua_interned_key构造前初始化
+            static lua_interned_key_registry &lua_get_interned_key_registry() {
+                static lua_interned_key_registry ret;
+                return ret;
+            }
+
+            static inline int lua_interned_key_abs_index(lua_State *L, int index) {
+                if (index < 0 && index > LUA_REGISTRYINDEX) {
+                    return lua_gettop(L) + index + 1;
+                }
+
+                return index;
+            }
+        } // namespace detail
+
+        lua_interned_key::lua_interned_key(const char *key) : key_(NULL == key ? "" : key), id_(intern(key_)) {}
+
+        lua_interned_key::lua_interned_key(const char *key, size_t len) : key_(key, len), id_(intern(key_)) {}
+
+        lua_interned_key::lua_interned_key(const std::string &key) : key_(key), id_(intern(key_)) {}
+
+        size_t lua_interned_key::size() {
+            detail::lua_interned_key_registry &reg = detail::lua_get_interned_key_registry();
+            std::lock_guard<std::mutex>        guard(reg.lock);
+            return reg.ids.size();
+        }
+
+        const lua_interned_key &lua_interned_key::get_builtin(builtin_key key) {
+            static lua_interned_key builtin_keys[BK_MAX] = {
+                lua_interned_key("__type"),
+                lua_interned_key("__index"),
+                lua_interned_key("__classname"),
+            };
+
+            if (key < 0 || key >= BK_MAX) {
+                return builtin_keys[BK_TYPE];
+            }
+
+            return builtin_keys[key];
+        }
+
+        size_t lua_interned_key::intern(const std::string &key) {
+            detail::lua_interned_key_registry &reg = detail::lua_get_interned_key_registry();
+            std::lock_guard<std::mutex>        guard(reg.lock);
+
+            std::unordered_map<std::string, size_t>::iterator iter = reg.ids.find(key);
+            if (iter != reg.ids.end()) {
+                return iter->second;
+            }
+
+            size_t ret   = reg.ids.size();
+            reg.ids[key] = ret;
+            return ret;
+        }
+
+        namespace fn {
+            void push_key(lua_State *L, const lua_interned_key &key) { push_key(L, lua_binding_context::get(L), key); }
+
+            void push_key(lua_State *L, lua_binding_context *ctx, const lua_interned_key &key) {
+                if (NULL == ctx) {
+                    lua_pushlstring(L, key.get_key().data(), key.get_key().size());
+                    return;
+                }
+
+                ctx->push_key(L, key);
+            }
+
+            void get_field(lua_State *L, int index, const lua_interned_key &key) {
+                index = detail::lua_interned_key_abs_index(L, index);
+                push_key(L, key);
+                lua_gettable(L, index);
+            }
+
+            void set_field(lua_State *L, int index, const lua_interned_key &key) {
+                index = detail::lua_interned_key_abs_index(L, index);
+                push_key(L, key);
+                lua_insert(L, -2);
+                lua_settable(L, index);
+            }
+
+            void rawget_field(lua_State *L, int index, const lua_interned_key &key) {
+                index = detail::lua_interned_key_abs_index(L, index);
+                push_key(L, key);
+                lua_rawget(L, index);
+            }
+
+            void rawset_field(lua_State *L, int index, const lua_interned_key &key) {
+                index = detail::lua_interned_key_abs_index(L, index);
+                push_key(L, key);
+                lua_insert(L, -2);
+                lua_rawset(L, index);
+            }
+        } // namespace fn
+    }     // namespace lua
+} // namespace script
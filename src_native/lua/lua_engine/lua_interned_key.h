@@ -0,0 +1,102 @@
+#ifndef SCRIPT_LUA_LUAINTERNEDKEY
+#define SCRIPT_LUA_LUAINTERNEDKEY
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+extern "C" {
+#include "lua.h"
+}
+
+namespace script {
+    namespace lua {
+
+        class lua_binding_context;
+
+        /**
+         * 驻留的字符串键
+         * 相同内容的键在进程内共享同一个编号，每个lua_State第一次使用时把字符串保存为registry引用，
+         * 之后只需要一次lua_rawgeti就能入栈，不再重新计算hash
+         * 通常定义为静态变量:
+         * @code
+         *     static script::lua::lua_interned_key key_x("x");
+         *     script::lua::fn::push_key(L, key_x);
+         * @endcode
+         * @note 没有绑定lua_binding_context的lua_State(不是由lua_engine创建的)会退化为lua_pushlstring
+         */
+        class lua_interned_key {
+        public:
+            /** 绑定层常用的键 */
+            enum builtin_key {
+                BK_TYPE = 0,  // __type
+                BK_INDEX,     // __index
+                BK_CLASSNAME, // __classname
+                BK_MAX,
+            };
+
+        public:
+            explicit lua_interned_key(const char *key);
+            lua_interned_key(const char *key, size_t len);
+            explicit lua_interned_key(const std::string &key);
+
+            inline size_t get_id() const { return id_; }
+
+            inline const std::string &get_key() const { return key_; }
+
+            /**
+             * @brief 获取已经注册的键数量
+             */
+            static size_t size();
+
+            /**
+             * @brief 获取绑定层常用的键
+             */
+            static const lua_interned_key &get_builtin(builtin_key key);
+
+        private:
+            static size_t intern(const std::string &key);
+
+        private:
+            std::string key_;
+            size_t      id_;
+        };
+
+        namespace fn {
+            /**
+             * @brief 把驻留的键入栈
+             * @note 每次调用都要从registry中查找lua_binding_context，比lua_pushliteral更慢，连续入栈多个键时使用带ctx的版本
+             */
+            void push_key(lua_State *L, const lua_interned_key &key);
+
+            /**
+             * @brief 把驻留的键入栈，批量转换时可以预先获取lua_binding_context
+             * @param ctx L所属的绑定上下文，可以为空
+             */
+            void push_key(lua_State *L, lua_binding_context *ctx, const lua_interned_key &key);
+
+            /**
+             * @brief 等同于lua_getfield(L, index, key)
+             */
+            void get_field(lua_State *L, int index, const lua_interned_key &key);
+
+            /**
+             * @brief 等同于lua_setfield(L, index, key)，值在栈顶
+             */
+            void set_field(lua_State *L, int index, const lua_interned_key &key);
+
+            /**
+             * @brief 不触发元方法的get_field
+             */
+            void rawget_field(lua_State *L, int index, const lua_interned_key &key);
+
+            /**
+             * @brief 不触发元方法的set_field，值在栈顶
+             */
+            void rawset_field(lua_State *L, int index, const lua_interned_key &key);
+        } // namespace fn
+    }     // namespace lua
+} // namespace script
+
+#endif
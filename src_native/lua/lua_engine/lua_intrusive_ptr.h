@@ -0,0 +1,133 @@
+#ifndef SCRIPT_LUA_LUAINTRUSIVEPTR
+#define SCRIPT_LUA_LUAINTRUSIVEPTR
+
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 侵入式引用计数的智能指针
+         * 通过ADL查找intrusive_ptr_add_ref(T *)和intrusive_ptr_release(T *)，和boost::intrusive_ptr的约定一致
+         * 已经实现了这两个函数的类型可以直接使用，否则可以继承lua_intrusive_object
+         */
+        template <typename T>
+        class lua_intrusive_ptr {
+        public:
+            typedef T element_type;
+
+            lua_intrusive_ptr() : px_(NULL) {}
+
+            lua_intrusive_ptr(T *p, bool add_ref = true) : px_(p) {
+                if (NULL != px_ && add_ref) {
+                    intrusive_ptr_add_ref(px_);
+                }
+            }
+
+            lua_intrusive_ptr(const lua_intrusive_ptr &other) : px_(other.px_) {
+                if (NULL != px_) {
+                    intrusive_ptr_add_ref(px_);
+                }
+            }
+
+            template <typename U>
+            lua_intrusive_ptr(const lua_intrusive_ptr<U> &other) : px_(other.get()) {
+                if (NULL != px_) {
+                    intrusive_ptr_add_ref(px_);
+                }
+            }
+
+            lua_intrusive_ptr(lua_intrusive_ptr &&other) : px_(other.px_) { other.px_ = NULL; }
+
+            ~lua_intrusive_ptr() {
+                if (NULL != px_) {
+                    intrusive_ptr_release(px_);
+                }
+            }
+
+            lua_intrusive_ptr &operator=(const lua_intrusive_ptr &other) {
+                lua_intrusive_ptr(other).swap(*this);
+                return *this;
+            }
+
+            lua_intrusive_ptr &operator=(lua_intrusive_ptr &&other) {
+                lua_intrusive_ptr(static_cast<lua_intrusive_ptr &&>(other)).swap(*this);
+                return *this;
+            }
+
+            void reset() { lua_intrusive_ptr().swap(*this); }
+
+            void reset(T *p) { lua_intrusive_ptr(p).swap(*this); }
+
+            /**
+             * @brief 放弃所有权但不减少引用计数
+             */
+            T *detach() {
+                T *ret = px_;
+                px_    = NULL;
+                return ret;
+            }
+
+            inline T *get() const { return px_; }
+
+            inline T &operator*() const { return *px_; }
+
+            inline T *operator->() const { return px_; }
+
+            inline explicit operator bool() const { return NULL != px_; }
+
+            inline void swap(lua_intrusive_ptr &other) {
+                T *tmp    = px_;
+                px_       = other.px_;
+                other.px_ = tmp;
+            }
+
+        private:
+            T *px_;
+        };
+
+        template <typename T, typename U>
+        inline bool operator==(const lua_intrusive_ptr<T> &l, const lua_intrusive_ptr<U> &r) {
+            return l.get() == r.get();
+        }
+
+        template <typename T, typename U>
+        inline bool operator!=(const lua_intrusive_ptr<T> &l, const lua_intrusive_ptr<U> &r) {
+            return l.get() != r.get();
+        }
+
+        /**
+         * 非原子的侵入式引用计数基类，只能在单线程中使用
+         * @code
+         *     class my_entity : public script::lua::lua_intrusive_object<my_entity> { ... };
+         * @endcode
+         */
+        template <typename T>
+        class lua_intrusive_object : public ::util::design_pattern::noncopyable {
+        public:
+            inline uint32_t get_ref_count() const { return ref_count_; }
+
+            friend inline void intrusive_ptr_add_ref(const lua_intrusive_object *p) { ++p->ref_count_; }
+
+            friend inline void intrusive_ptr_release(const lua_intrusive_object *p) {
+                if (0 == --p->ref_count_) {
+                    delete static_cast<const T *>(p);
+                }
+            }
+
+        protected:
+            lua_intrusive_object() : ref_count_(0) {}
+            ~lua_intrusive_object() {}
+
+        private:
+            mutable uint32_t ref_count_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
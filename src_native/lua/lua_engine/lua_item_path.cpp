@@ -0,0 +1,205 @@
+#include <log/log_wrapper.h>
+
+#include "../lua_module/lua_adaptor.h"
+#include "lua_binding_context.h"
+#include "lua_item_path.h"
+
+namespace script {
+    namespace lua {
+        lua_item_path::lua_item_path() : cache_value_(false), state_id_(0), value_ref_(LUA_NOREF), value_generation_(0) {}
+
+        lua_item_path::lua_item_path(const std::string &path, bool cache_value)
+            : cache_value_(false), state_id_(0), value_ref_(LUA_NOREF), value_generation_(0) {
+            assign(path, cache_value);
+        }
+
+        // lua_State可能已经关闭，这里不再访问
+        lua_item_path::~lua_item_path() {}
+
+        void lua_item_path::assign(const std::string &path, bool cache_value) {
+            path_        = path;
+            cache_value_ = cache_value;
+            segments_.clear();
+            segment_refs_.clear();
+            state_id_         = 0;
+            value_ref_        = LUA_NOREF;
+            value_generation_ = 0;
+
+            // 和fn::load_item的拆分规则保持一致
+            const char *s = path_.c_str(), *e = path_.c_str();
+            while (e && *e) {
+                if ('.' == *e) {
+                    segments_.push_back(std::string(s, e));
+                    s = e + 1;
+                }
+
+                ++e;
+            }
+            if (s < e) segments_.push_back(std::string(s, e));
+        }
+
+        bool lua_item_path::load(lua_State *L, bool auto_create_table) const {
+            lua_binding_context *ctx = cache_value_ ? get_bound_context(L) : NULL;
+            if (NULL != ctx && LUA_NOREF != value_ref_ && value_generation_ == ctx->get_item_path_generation()) {
+                lua_rawgeti(L, LUA_REGISTRYINDEX, value_ref_);
+                return true;
+            }
+
+#ifdef LUA_RIDX_GLOBALS
+            lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+            bool res = load(L, -1, auto_create_table);
+            lua_remove(L, -2);
+#else
+            bool res = load(L, LUA_GLOBALSINDEX, auto_create_table);
+#endif
+
+            if (res && NULL != ctx) {
+                if (LUA_NOREF != value_ref_) {
+                    luaL_unref(L, LUA_REGISTRYINDEX, value_ref_);
+                }
+
+                lua_pushvalue(L, -1);
+                value_ref_        = luaL_ref(L, LUA_REGISTRYINDEX);
+                value_generation_ = ctx->get_item_path_generation();
+            }
+
+            return res;
+        }
+
+        bool lua_item_path::load(lua_State *L, int table_index, bool auto_create_table) const {
+            return walk(L, table_index, segments_.size(), auto_create_table);
+        }
+
+        bool lua_item_path::remove(lua_State *L) const {
+#ifdef LUA_RIDX_GLOBALS
+            lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+            bool res = remove(L, -1);
+            lua_pop(L, 1);
+            return res;
+#else
+            return remove(L, LUA_GLOBALSINDEX);
+#endif
+        }
+
+        bool lua_item_path::remove(lua_State *L, int table_index) const {
+            if (segments_.empty()) {
+                return true;
+            }
+
+            invalidate(L);
+
+            int top = lua_gettop(L);
+            if (!walk(L, table_index, segments_.size() - 1, false)) {
+                lua_settop(L, top);
+                return true;
+            }
+
+            push_segment(L, segments_.size() - 1, is_bound(L));
+            lua_pushnil(L);
+            lua_settable(L, -3);
+            lua_settop(L, top);
+            return true;
+        }
+
+        void lua_item_path::release(lua_State *L) {
+            if (NULL == L || !is_bound(L)) {
+                return;
+            }
+
+            for (size_t i = 0; i < segment_refs_.size(); ++i) {
+                luaL_unref(L, LUA_REGISTRYINDEX, segment_refs_[i]);
+            }
+            segment_refs_.clear();
+
+            if (LUA_NOREF != value_ref_) {
+                luaL_unref(L, LUA_REGISTRYINDEX, value_ref_);
+                value_ref_ = LUA_NOREF;
+            }
+
+            state_id_ = 0;
+        }
+
+        void lua_item_path::invalidate(lua_State *L) {
+            lua_binding_context *ctx = lua_binding_context::get(L);
+            if (NULL != ctx) {
+                ctx->invalidate_item_paths();
+            }
+        }
+
+        void lua_item_path::openlib(lua_State *L) {
+            lua_getglobal(L, "package");
+            if (!lua_istable(L, -1)) {
+                lua_pop(L, 1);
+                return;
+            }
+
+            lua_pushcfunction(L, lua_invalidate);
+            lua_setfield(L, -2, "item_path_invalidate");
+            lua_pop(L, 1);
+        }
+
+        // package.item_path_invalidate()
+        int lua_item_path::lua_invalidate(lua_State *L) {
+            invalidate(L);
+            return 0;
+        }
+
+        lua_binding_context *lua_item_path::get_bound_context(lua_State *L) const {
+            // 同一个lua_State的所有协程共享lua_binding_context
+            // 不使用registry的地址，lua_State关闭后新的lua_State可能分配到相同的地址
+            lua_binding_context *ctx = lua_binding_context::get(L);
+            if (NULL == ctx) {
+                return NULL;
+            }
+
+            if (0 == state_id_) {
+                bind(L, ctx->get_state_id());
+            }
+
+            return state_id_ == ctx->get_state_id() ? ctx : NULL;
+        }
+
+        void lua_item_path::bind(lua_State *L, uint64_t state_id) const {
+            state_id_ = state_id;
+            segment_refs_.resize(segments_.size(), LUA_NOREF);
+            for (size_t i = 0; i < segments_.size(); ++i) {
+                lua_pushlstring(L, segments_[i].data(), segments_[i].size());
+                segment_refs_[i] = luaL_ref(L, LUA_REGISTRYINDEX);
+            }
+        }
+
+        void lua_item_path::push_segment(lua_State *L, size_t index, bool bound) const {
+            if (bound) {
+                lua_rawgeti(L, LUA_REGISTRYINDEX, segment_refs_[index]);
+            } else {
+                lua_pushlstring(L, segments_[index].data(), segments_[index].size());
+            }
+        }
+
+        bool lua_item_path::walk(lua_State *L, int table_index, size_t count, bool auto_create_table) const {
+            bool res   = true;
+            bool bound = is_bound(L);
+
+            lua_pushvalue(L, table_index);
+            for (size_t i = 0; res && i < count; ++i) {
+                push_segment(L, i, bound);
+                lua_gettable(L, -2);
+                if (lua_isnil(L, -1)) {
+                    if (auto_create_table) {
+                        lua_pop(L, 1);
+                        lua_newtable(L);
+                        push_segment(L, i, bound);
+                        lua_pushvalue(L, -2);
+                        lua_settable(L, -4);
+                    } else {
+                        res = false;
+                    }
+                }
+
+                lua_remove(L, -2);
+            }
+
+            return res && !lua_isnil(L, -1);
+        }
+    } // namespace lua
+} // namespace script
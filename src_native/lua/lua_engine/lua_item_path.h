@@ -0,0 +1,124 @@
+#ifndef SCRIPT_LUA_LUAITEMPATH
+#define SCRIPT_LUA_LUAITEMPATH
+
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "lauxlib.h"
+#include "lua.h"
+}
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        class lua_binding_context;
+
+        /**
+         * 预编译的对象路径
+         * 构造时把a.b.c形式的路径拆分好，第一次在lua_State中使用时把每一段保存为registry中的字符串引用，
+         * 之后的load/remove不再拆分字符串和分配内存
+         * 开启cache_value后，从_G加载的结果也会保存在registry中，invalidate(L)后失效，失效只影响L所在的lua_State
+         * (热更新、恢复快照和utils.loader的clear会自动调用，lua中直接给全局对象赋值后需要调用package.item_path_invalidate())
+         * @note 只会在第一次使用的lua_State(及其协程)中缓存引用，其他lua_State中使用时按拆分好的路径查找
+         * @note 按lua_binding_context的编号识别lua_State，没有绑定上下文(不是由lua_engine创建)的lua_State不缓存引用
+         * @note 析构时不会访问lua_State，如果lua_State比本对象存活的更久，可以调用release释放registry中的引用
+         * @note 非线程安全
+         */
+        class lua_item_path : public ::util::design_pattern::noncopyable {
+        public:
+            lua_item_path();
+            explicit lua_item_path(const std::string &path, bool cache_value = false);
+            ~lua_item_path();
+
+            /**
+             * @brief 重新设置路径，会丢弃已经缓存的引用
+             * @note 为了不访问lua_State，旧的引用不会从registry中释放，需要的话先调用release
+             */
+            void assign(const std::string &path, bool cache_value = false);
+
+            inline const std::string &get_path() const { return path_; }
+
+            inline const std::vector<std::string> &get_segments() const { return segments_; }
+
+            inline bool is_cache_value() const { return cache_value_; }
+
+            /**
+             * @brief load _G.path and push it into stack
+             * @param L lua State
+             * @param auto_create_table create table if not exists
+             * @note this API always push a value into stack, push nil if failed
+             * @return true if success
+             */
+            bool load(lua_State *L, bool auto_create_table = false) const;
+
+            /**
+             * @brief load path from table and push it into stack
+             * @param L lua State
+             * @param table_index stack index of table to load
+             * @param auto_create_table create table if not exists
+             * @note this API always push a value into stack, push nil if failed
+             * @note 不使用cache_value的缓存
+             * @return true if success
+             */
+            bool load(lua_State *L, int table_index, bool auto_create_table = false) const;
+
+            /**
+             * @brief remove _G.path
+             * @note 会调用invalidate(L)
+             */
+            bool remove(lua_State *L) const;
+
+            /**
+             * @brief remove path from table
+             * @note 会调用invalidate(L)
+             */
+            bool remove(lua_State *L, int table_index) const;
+
+            /**
+             * @brief 释放在registry中的引用
+             * @param L 第一次使用时的lua_State
+             */
+            void release(lua_State *L);
+
+            /**
+             * @brief 使L所在的lua_State中所有lua_item_path缓存的值失效，重新定义了全局对象后需要调用
+             * @note 失效的版本号记录在lua_binding_context中，其他lua_State的缓存不受影响
+             */
+            static void invalidate(lua_State *L);
+
+            /**
+             * @brief 注册package.item_path_invalidate
+             */
+            static void openlib(lua_State *L);
+
+        private:
+            static int lua_invalidate(lua_State *L);
+
+
+            inline bool is_bound(lua_State *L) const { return NULL != get_bound_context(L); }
+            lua_binding_context *get_bound_context(lua_State *L) const;
+            void bind(lua_State *L, uint64_t state_id) const;
+            void push_segment(lua_State *L, size_t index, bool bound) const;
+            bool walk(lua_State *L, int table_index, size_t count, bool auto_create_table) const;
+
+        private:
+            std::string              path_;
+            std::vector<std::string> segments_;
+            bool                     cache_value_;
+
+            mutable uint64_t         state_id_; // 缓存引用的lua_State的编号，0表示未绑定
+            mutable std::vector<int> segment_refs_;
+            mutable int              value_ref_;
+            mutable uint64_t         value_generation_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
@@ -0,0 +1,75 @@
+#include <cstring>
+
+#include "lua_latency_histogram.h"
+
+namespace script {
+    namespace lua {
+        lua_latency_histogram::lua_latency_histogram() { reset(); }
+
+        void lua_latency_histogram::record(std::chrono::nanoseconds duration) {
+            uint64_t ns = duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0;
+
+            ++buckets_[bucket_index(ns)];
+            ++count_;
+            total_ += ns;
+            if (ns > max_) {
+                max_ = ns;
+            }
+        }
+
+        void lua_latency_histogram::reset() {
+            memset(buckets_, 0, sizeof(buckets_));
+            count_ = 0;
+            total_ = 0;
+            max_   = 0;
+        }
+
+        std::chrono::nanoseconds lua_latency_histogram::percentile(double percent) const {
+            if (0 == count_) {
+                return std::chrono::nanoseconds::zero();
+            }
+
+            if (percent < 0.0) {
+                percent = 0.0;
+            } else if (percent > 100.0) {
+                percent = 100.0;
+            }
+
+            uint64_t rank = static_cast<uint64_t>(static_cast<double>(count_) * percent / 100.0 + 0.5);
+            if (rank < 1) {
+                rank = 1;
+            }
+
+            uint64_t accumulate = 0;
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                accumulate += buckets_[i];
+                if (accumulate >= rank) {
+                    uint64_t upper = 0 == i ? 0 : ((i >= 63) ? max_ : ((static_cast<uint64_t>(1) << i) - 1));
+                    return std::chrono::nanoseconds(upper < max_ ? upper : max_);
+                }
+            }
+
+            return std::chrono::nanoseconds(max_);
+        }
+
+        lua_latency_histogram::summary_t lua_latency_histogram::get_summary() const {
+            summary_t ret;
+            ret.count = count_;
+            ret.total = std::chrono::nanoseconds(total_);
+            ret.p50   = percentile(50.0);
+            ret.p99   = percentile(99.0);
+            ret.max   = std::chrono::nanoseconds(max_);
+            return ret;
+        }
+
+        size_t lua_latency_histogram::bucket_index(uint64_t ns) {
+            size_t ret = 0;
+            while (ns > 0 && ret < BUCKET_COUNT - 1) {
+                ns >>= 1;
+                ++ret;
+            }
+
+            return ret;
+        }
+    } // namespace lua
+} // namespace script
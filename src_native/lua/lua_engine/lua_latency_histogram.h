@@ -0,0 +1,64 @@
+#ifndef SCRIPT_LUA_LUALATENCYHISTOGRAM
+#define SCRIPT_LUA_LUALATENCYHISTOGRAM
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <stdint.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 耗时直方图
+         * 以纳秒为单位，按2的幂分桶(第i个桶记录[2^(i-1), 2^i)的耗时)，记录和查询都是O(1)
+         * 百分位数返回所在桶的上界，精度为2倍以内
+         */
+        class lua_latency_histogram {
+        public:
+            enum { BUCKET_COUNT = 64 };
+
+            struct summary_t {
+                uint64_t                 count;
+                std::chrono::nanoseconds total;
+                std::chrono::nanoseconds p50;
+                std::chrono::nanoseconds p99;
+                std::chrono::nanoseconds max;
+            };
+
+        public:
+            lua_latency_histogram();
+
+            void record(std::chrono::nanoseconds duration);
+
+            void reset();
+
+            inline uint64_t get_count() const { return count_; }
+
+            inline std::chrono::nanoseconds get_total() const { return std::chrono::nanoseconds(total_); }
+
+            inline std::chrono::nanoseconds get_max() const { return std::chrono::nanoseconds(max_); }
+
+            /**
+             * @brief 获取百分位数
+             * @param percent 百分比，取值范围[0, 100]
+             * @return 没有数据时返回0
+             */
+            std::chrono::nanoseconds percentile(double percent) const;
+
+            summary_t get_summary() const;
+
+        private:
+            static size_t bucket_index(uint64_t ns);
+
+        private:
+            uint64_t buckets_[BUCKET_COUNT];
+            uint64_t count_;
+            uint64_t total_;
+            uint64_t max_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include <common/file_system.h>
+#include <log/log_wrapper.h>
+
+#include "../lua_module/lua_adaptor.h"
+#include "lua_binding_utils.h"
+#include "lua_module_archive.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            static char lua_module_archive_registry_key = 0;
+
+            static const uint32_t LUA_MODULE_ARCHIVE_VERSION = 1;
+
+            struct lua_module_archive_header {
+                char     magic[4];
+                uint32_t version;
+                uint32_t entry_count;
+                uint32_t reserved;
+            };
+
+            struct lua_module_archive_index {
+                uint32_t name_offset;
+                uint32_t name_length;
+                uint32_t data_offset;
+                uint32_t data_length;
+                uint32_t path_offset;
+                uint32_t path_length;
+            };
+
+            struct lua_module_archive_source {
+                std::string module_name;
+                std::string file_path;
+                std::string relative_path; // 相对源码目录的路径，统一用/分隔
+                size_t      data_index;
+            };
+
+            static bool lua_module_archive_less(const lua_module_archive_source &l, const lua_module_archive_source &r) {
+                return l.module_name < r.module_name;
+            }
+
+            static int lua_module_archive_writer(lua_State *, const void *p, size_t sz, void *ud) {
+                reinterpret_cast<std::string *>(ud)->append(reinterpret_cast<const char *>(p), sz);
+                return 0;
+            }
+
+            static int lua_module_archive_compare(const char *l, size_t llen, const char *r, size_t rlen) {
+                int ret = memcmp(l, r, llen < rlen ? llen : rlen);
+                if (0 != ret) {
+                    return ret;
+                }
+
+                return llen < rlen ? -1 : (llen > rlen ? 1 : 0);
+            }
+
+            static void lua_module_archive_scan(const std::string &dir, const std::string &prefix, const std::string &relative_dir,
+                                                std::vector<lua_module_archive_source> &out) {
+#ifdef _WIN32
+                WIN32_FIND_DATAA find_data;
+                std::string      pattern = dir + "\\*";
+                HANDLE           h       = FindFirstFileA(pattern.c_str(), &find_data);
+                if (INVALID_HANDLE_VALUE == h) {
+                    return;
+                }
+
+                do {
+                    std::string name = find_data.cFileName;
+                    bool        is_dir = 0 != (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+                DIR *d = opendir(dir.c_str());
+                if (NULL == d) {
+                    return;
+                }
+
+                struct dirent *ent;
+                while (NULL != (ent = readdir(d))) {
+                    std::string name = ent->d_name;
+                    struct stat st;
+                    if (0 != stat((dir + "/" + name).c_str(), &st)) {
+                        continue;
+                    }
+                    bool is_dir = S_ISDIR(st.st_mode);
+#endif
+                    if (name.empty() || '.' == name[0]) {
+                        continue;
+                    }
+
+                    std::string full_path = dir;
+                    full_path += util::file_system::DIRECTORY_SEPARATOR;
+                    full_path += name;
+
+                    if (is_dir) {
+                        lua_module_archive_scan(full_path, prefix + name + ".", relative_dir + name + "/", out);
+                        continue;
+                    }
+
+                    if (name.size() <= 4 || 0 != name.compare(name.size() - 4, 4, ".lua")) {
+                        continue;
+                    }
+
+                    lua_module_archive_source src;
+                    src.module_name = prefix + name.substr(0, name.size() - 4);
+                    src.file_path     = full_path;
+                    src.relative_path = relative_dir + name;
+                    src.data_index    = 0;
+                    out.push_back(src);
+#ifdef _WIN32
+                } while (FindNextFileA(h, &find_data));
+                FindClose(h);
+#else
+                }
+                closedir(d);
+#endif
+            }
+        } // namespace detail
+
+        lua_module_archive::lua_module_archive(constructor_helper &helper)
+            : archive_path_(helper.archive_path), data_(NULL), data_size_(0), entry_count_(0) {
+            memset(&stats_, 0, sizeof(stats_));
+#ifdef _WIN32
+            file_handle_    = NULL;
+            mapping_handle_ = NULL;
+#endif
+        }
+
+        lua_module_archive::~lua_module_archive() { unmap_file(); }
+
+        lua_module_archive::ptr_t lua_module_archive::open(const std::string &archive_path) {
+            constructor_helper helper;
+            helper.archive_path = archive_path;
+            ptr_t ret           = std::make_shared<lua_module_archive>(helper);
+            if (!ret || !ret->map_file()) {
+                return ptr_t();
+            }
+
+            return ret;
+        }
+
+        bool lua_module_archive::find(const char *module_name, const char *&data, size_t &sz) const {
+            entry_t entry;
+            if (!find(module_name, entry)) {
+                return false;
+            }
+
+            data = entry.data;
+            sz   = entry.data_size;
+            return true;
+        }
+
+        bool lua_module_archive::find(const char *module_name, entry_t &out) const {
+            if (NULL == data_ || NULL == module_name) {
+                return false;
+            }
+
+            const detail::lua_module_archive_index *index =
+                reinterpret_cast<const detail::lua_module_archive_index *>(data_ + sizeof(detail::lua_module_archive_header));
+            size_t name_len = strlen(module_name);
+
+            // 索引按模块名排序，二分查找
+            uint32_t left = 0, right = entry_count_;
+            while (left < right) {
+                uint32_t mid = left + (right - left) / 2;
+                int      res = detail::lua_module_archive_compare(data_ + index[mid].name_offset, index[mid].name_length, module_name, name_len);
+                if (0 == res) {
+                    out.data             = data_ + index[mid].data_offset;
+                    out.data_size        = index[mid].data_length;
+                    out.source_path      = data_ + index[mid].path_offset;
+                    out.source_path_size = index[mid].path_length;
+                    return true;
+                } else if (res < 0) {
+                    left = mid + 1;
+                } else {
+                    right = mid;
+                }
+            }
+
+            return false;
+        }
+
+        int lua_module_archive::load(lua_State *L, const char *module_name) {
+            entry_t entry;
+            if (!find(module_name, entry)) {
+                ++stats_.miss_count;
+                lua_pushfstring(L, "module '%s' not found in archive %s", module_name, archive_path_.c_str());
+                return LUA_ERRFILE;
+            }
+
+            ++stats_.hit_count;
+            return load(L, entry);
+        }
+
+        int lua_module_archive::load(lua_State *L, const entry_t &entry) {
+            std::string chunk_name;
+            chunk_name.reserve(entry.source_path_size + 1);
+            chunk_name += '@';
+            chunk_name.append(entry.source_path, entry.source_path_size);
+            return luaL_loadbuffer(L, entry.data, entry.data_size, chunk_name.c_str());
+        }
+
+        int lua_module_archive::build(const std::string &src_dir, const std::string &archive_path, lua_State *compiler) {
+            std::vector<detail::lua_module_archive_source> sources;
+            detail::lua_module_archive_scan(src_dir, std::string(), std::string(), sources);
+
+            // 读取并编译
+            std::vector<std::string> datas;
+            datas.reserve(sources.size());
+            for (size_t i = 0; i < sources.size(); ++i) {
+                sources[i].data_index = datas.size();
+                datas.push_back(std::string());
+                if (!util::file_system::get_file_content(datas.back(), sources[i].file_path.c_str(), true)) {
+                    WLOGERROR("build lua module archive failed, read %s failed", sources[i].file_path.c_str());
+                    return -1;
+                }
+
+                if (NULL == compiler) {
+                    continue;
+                }
+
+                // 字节码中保存的是编译时的chunk name，和加载源码时保持一致
+                std::string chunk_name = std::string("@") + sources[i].relative_path;
+                if (LUA_OK != luaL_loadbuffer(compiler, datas.back().data(), datas.back().size(), chunk_name.c_str())) {
+                    WLOGERROR("build lua module archive failed, compile %s failed: %s", sources[i].file_path.c_str(), lua_tostring(compiler, -1));
+                    lua_pop(compiler, 1);
+                    return -1;
+                }
+
+                std::string bytecode;
+#if LUA_VERSION_NUM >= 503
+                int dump_res = lua_dump(compiler, detail::lua_module_archive_writer, &bytecode, 0);
+#else
+                int dump_res = lua_dump(compiler, detail::lua_module_archive_writer, &bytecode);
+#endif
+                lua_pop(compiler, 1);
+                if (0 != dump_res) {
+                    WLOGERROR("build lua module archive failed, dump %s failed", sources[i].file_path.c_str());
+                    return -1;
+                }
+                datas.back().swap(bytecode);
+            }
+
+            // a.init 同时注册为 a
+            size_t source_count = sources.size();
+            for (size_t i = 0; i < source_count; ++i) {
+                const std::string &name = sources[i].module_name;
+                if (name.size() > 5 && 0 == name.compare(name.size() - 5, 5, ".init")) {
+                    detail::lua_module_archive_source alias = sources[i];
+                    alias.module_name                       = name.substr(0, name.size() - 5);
+                    sources.push_back(alias);
+                }
+            }
+
+            std::sort(sources.begin(), sources.end(), detail::lua_module_archive_less);
+            for (size_t i = 1; i < sources.size(); ++i) {
+                if (sources[i].module_name == sources[i - 1].module_name) {
+                    WLOGERROR("build lua module archive failed, module %s is duplicated (%s and %s)", sources[i].module_name.c_str(),
+                              sources[i - 1].file_path.c_str(), sources[i].file_path.c_str());
+                    return -1;
+                }
+            }
+
+            // 布局: 文件头 | 索引 | 模块名 | 源文件路径 | 模块数据
+            detail::lua_module_archive_header header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, "LMAR", 4);
+            header.version     = detail::LUA_MODULE_ARCHIVE_VERSION;
+            header.entry_count = static_cast<uint32_t>(sources.size());
+
+            std::vector<detail::lua_module_archive_index> indexes;
+            indexes.resize(sources.size());
+
+            size_t offset = sizeof(header) + sizeof(detail::lua_module_archive_index) * sources.size();
+            for (size_t i = 0; i < sources.size(); ++i) {
+                indexes[i].name_offset = static_cast<uint32_t>(offset);
+                indexes[i].name_length = static_cast<uint32_t>(sources[i].module_name.size());
+                offset += sources[i].module_name.size();
+            }
+            for (size_t i = 0; i < sources.size(); ++i) {
+                indexes[i].path_offset = static_cast<uint32_t>(offset);
+                indexes[i].path_length = static_cast<uint32_t>(sources[i].relative_path.size());
+                offset += sources[i].relative_path.size();
+            }
+
+            // 别名和原模块共享数据
+            std::vector<size_t> data_offsets;
+            data_offsets.resize(datas.size());
+            for (size_t i = 0; i < datas.size(); ++i) {
+                data_offsets[i] = offset;
+                offset += datas[i].size();
+            }
+
+            if (offset > static_cast<size_t>(0xFFFFFFFFU)) {
+                WLOGERROR("build lua module archive failed, archive too large");
+                return -1;
+            }
+
+            for (size_t i = 0; i < sources.size(); ++i) {
+                indexes[i].data_offset = static_cast<uint32_t>(data_offsets[sources[i].data_index]);
+                indexes[i].data_length = static_cast<uint32_t>(datas[sources[i].data_index].size());
+            }
+
+            std::string tmp_path = fn::make_temp_file_path(archive_path);
+            FILE *      f        = fopen(tmp_path.c_str(), "wb");
+            if (NULL == f) {
+                WLOGERROR("build lua module archive failed, open %s failed", tmp_path.c_str());
+                return -1;
+            }
+
+            bool write_ok = 1 == fwrite(&header, sizeof(header), 1, f);
+            if (write_ok && !indexes.empty()) {
+                write_ok = indexes.size() == fwrite(&indexes[0], sizeof(detail::lua_module_archive_index), indexes.size(), f);
+            }
+            for (size_t i = 0; write_ok && i < sources.size(); ++i) {
+                write_ok = sources[i].module_name.size() == fwrite(sources[i].module_name.data(), 1, sources[i].module_name.size(), f);
+            }
+            for (size_t i = 0; write_ok && i < sources.size(); ++i) {
+                write_ok =
+                    sources[i].relative_path.size() == fwrite(sources[i].relative_path.data(), 1, sources[i].relative_path.size(), f);
+            }
+            for (size_t i = 0; write_ok && i < datas.size(); ++i) {
+                write_ok = datas[i].size() == fwrite(datas[i].data(), 1, datas[i].size(), f);
+            }
+            fclose(f);
+
+            if (write_ok) {
+#ifdef _WIN32
+                remove(archive_path.c_str());
+#endif
+                write_ok = 0 == rename(tmp_path.c_str(), archive_path.c_str());
+            }
+
+            if (!write_ok) {
+                remove(tmp_path.c_str());
+                WLOGERROR("build lua module archive failed, write %s failed", archive_path.c_str());
+                return -1;
+            }
+
+            return 0;
+        }
+
+        void lua_module_archive::bind(lua_State *L, lua_module_archive *archive) {
+            lua_pushlightuserdata(L, &detail::lua_module_archive_registry_key);
+            if (NULL == archive) {
+                lua_pushnil(L);
+            } else {
+                lua_pushlightuserdata(L, archive);
+            }
+            lua_rawset(L, LUA_REGISTRYINDEX);
+        }
+
+        lua_module_archive *lua_module_archive::get(lua_State *L) {
+            lua_pushlightuserdata(L, &detail::lua_module_archive_registry_key);
+            lua_rawget(L, LUA_REGISTRYINDEX);
+            lua_module_archive *ret = reinterpret_cast<lua_module_archive *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+            return ret;
+        }
+
+        int lua_module_archive::lua_searcher(lua_State *L) {
+            const char *        module_name = luaL_checkstring(L, 1);
+            lua_module_archive *archive     = get(L);
+
+            entry_t entry;
+            if (NULL == archive || !archive->find(module_name, entry)) {
+                if (NULL != archive) {
+                    ++archive->stats_.miss_count;
+                }
+                lua_pushfstring(L, "\n\tno module '%s' in module archive", module_name);
+                return 1;
+            }
+
+            ++archive->stats_.hit_count;
+            if (LUA_OK != archive->load(L, entry)) {
+                return luaL_error(L, "error loading module '%s' from archive '%s':\n\t%s", module_name, archive->archive_path_.c_str(),
+                                  lua_tostring(L, -1));
+            }
+
+            lua_pushlstring(L, archive->archive_path_.c_str(), archive->archive_path_.size());
+            return 2;
+        }
+
+        bool lua_module_archive::map_file() {
+            size_t file_size = 0;
+#ifdef _WIN32
+            HANDLE file = CreateFileA(archive_path_.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (INVALID_HANDLE_VALUE == file) {
+                WLOGERROR("open lua module archive %s failed", archive_path_.c_str());
+                return false;
+            }
+
+            LARGE_INTEGER li;
+            if (!GetFileSizeEx(file, &li) || li.QuadPart <= 0) {
+                CloseHandle(file);
+                WLOGERROR("lua module archive %s is empty", archive_path_.c_str());
+                return false;
+            }
+            file_size = static_cast<size_t>(li.QuadPart);
+
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (NULL == mapping) {
+                CloseHandle(file);
+                WLOGERROR("map lua module archive %s failed", archive_path_.c_str());
+                return false;
+            }
+
+            void *addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (NULL == addr) {
+                CloseHandle(mapping);
+                CloseHandle(file);
+                WLOGERROR("map lua module archive %s failed", archive_path_.c_str());
+                return false;
+            }
+
+            file_handle_    = file;
+            mapping_handle_ = mapping;
+#else
+            int fd = ::open(archive_path_.c_str(), O_RDONLY);
+            if (fd < 0) {
+                WLOGERROR("open lua module archive %s failed", archive_path_.c_str());
+                return false;
+            }
+
+            struct stat st;
+            if (0 != fstat(fd, &st) || st.st_size <= 0) {
+                ::close(fd);
+                WLOGERROR("lua module archive %s is empty", archive_path_.c_str());
+                return false;
+            }
+            file_size = static_cast<size_t>(st.st_size);
+
+            void *addr = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            // 映射建立后不再需要文件描述符
+            ::close(fd);
+            if (MAP_FAILED == addr) {
+                WLOGERROR("map lua module archive %s failed", archive_path_.c_str());
+                return false;
+            }
+#endif
+
+            data_      = reinterpret_cast<const char *>(addr);
+            data_size_ = file_size;
+
+            // 校验文件头和索引
+            const detail::lua_module_archive_header *header = reinterpret_cast<const detail::lua_module_archive_header *>(data_);
+            if (data_size_ < sizeof(detail::lua_module_archive_header) || 0 != memcmp(header->magic, "LMAR", 4) ||
+                detail::LUA_MODULE_ARCHIVE_VERSION != header->version ||
+                (data_size_ - sizeof(detail::lua_module_archive_header)) / sizeof(detail::lua_module_archive_index) < header->entry_count) {
+                WLOGERROR("lua module archive %s is invalid", archive_path_.c_str());
+                unmap_file();
+                return false;
+            }
+
+            const detail::lua_module_archive_index *index =
+                reinterpret_cast<const detail::lua_module_archive_index *>(data_ + sizeof(detail::lua_module_archive_header));
+            for (uint32_t i = 0; i < header->entry_count; ++i) {
+                if (static_cast<size_t>(index[i].name_offset) + index[i].name_length > data_size_ ||
+                    static_cast<size_t>(index[i].data_offset) + index[i].data_length > data_size_ ||
+                    static_cast<size_t>(index[i].path_offset) + index[i].path_length > data_size_) {
+                    WLOGERROR("lua module archive %s is corrupted", archive_path_.c_str());
+                    unmap_file();
+                    return false;
+                }
+            }
+
+            entry_count_ = header->entry_count;
+            return true;
+        }
+
+        void lua_module_archive::unmap_file() {
+            if (NULL == data_) {
+                return;
+            }
+
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+            CloseHandle(reinterpret_cast<HANDLE>(mapping_handle_));
+            CloseHandle(reinterpret_cast<HANDLE>(file_handle_));
+            mapping_handle_ = NULL;
+            file_handle_    = NULL;
+#else
+            munmap(const_cast<char *>(data_), data_size_);
+#endif
+            data_        = NULL;
+            data_size_   = 0;
+            entry_count_ = 0;
+        }
+    } // namespace lua
+} // namespace script
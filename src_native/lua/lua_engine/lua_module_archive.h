@@ -0,0 +1,141 @@
+#ifndef SCRIPT_LUA_LUAMODULEARCHIVE
+#define SCRIPT_LUA_LUAMODULEARCHIVE
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+extern "C" {
+#include "lauxlib.h"
+#include "lua.h"
+}
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 打包的lua模块归档文件
+         * 文件格式: 文件头 + 按模块名排序的索引 + 模块名、源文件相对路径和模块内容(源码或字节码)
+         * 打开时把整个文件映射到内存，加载模块时直接用luaL_loadbuffer读取映射的数据，不再访问文件系统
+         * @note 通过bind绑定到lua_State并用lua_engine::add_lua_loader添加lua_searcher后，require会优先从归档中加载
+         */
+        class lua_module_archive : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_module_archive> ptr_t;
+
+            struct stats_t {
+                size_t hit_count;  // 从归档中加载的次数
+                size_t miss_count; // 归档中没有对应模块的次数
+            };
+
+            struct entry_t {
+                const char *data;        // 模块数据(指向映射内存)
+                size_t      data_size;   // 模块数据长度
+                const char *source_path; // 打包时源文件相对于源码目录的路径，用作chunk name(指向映射内存，不以0结尾)
+                size_t      source_path_size;
+            };
+
+        private:
+            struct constructor_helper {
+                std::string archive_path;
+            };
+
+        public:
+            lua_module_archive(constructor_helper &helper);
+            ~lua_module_archive();
+
+            /**
+             * @brief 打开并映射归档文件
+             * @param archive_path 归档文件路径
+             * @return 失败返回空指针
+             */
+            static ptr_t open(const std::string &archive_path);
+
+            /**
+             * @brief 查找模块
+             * @param module_name 模块名，如 logic.player
+             * @param data 输出模块数据(指向映射内存)
+             * @param sz 输出模块数据长度
+             * @return 找到返回true
+             */
+            bool find(const char *module_name, const char *&data, size_t &sz) const;
+
+            /**
+             * @brief 查找模块
+             * @param module_name 模块名，如 logic.player
+             * @param out 输出模块数据和源文件路径
+             * @return 找到返回true
+             * @note 不计入命中统计
+             */
+            bool find(const char *module_name, entry_t &out) const;
+
+            /**
+             * @brief 加载模块
+             * @note 和luaL_loadbuffer一致，成功时把函数入栈，失败时把错误信息入栈
+             * @return lua错误码，模块不存在时返回LUA_ERRFILE
+             */
+            int load(lua_State *L, const char *module_name);
+
+            /**
+             * @brief 加载已经用find找到的模块，不再重复查找，也不计入命中统计
+             * @note chunk name为 @源文件相对路径，报错和traceback中显示的是打包前的文件
+             * @return lua错误码
+             */
+            int load(lua_State *L, const entry_t &entry);
+
+            inline const std::string &get_archive_path() const { return archive_path_; }
+
+            inline size_t size() const { return entry_count_; }
+
+            inline const stats_t &get_stats() const { return stats_; }
+
+            /**
+             * @brief 把目录下的所有.lua文件打包成归档
+             * @param src_dir 源码目录，相对路径转换为模块名(a/b/c.lua => a.b.c，a/init.lua同时注册为a)
+             * @param archive_path 输出的归档文件路径
+             * @param compiler 不为空时用这个lua_State编译并保存字节码，否则保存源码
+             * @return 0或错误码
+             */
+            static int build(const std::string &src_dir, const std::string &archive_path, lua_State *compiler = NULL);
+
+            /**
+             * @brief 绑定到lua_State，archive为NULL时解除绑定
+             * @note 调用者需要保证archive的生命周期长于lua_State
+             */
+            static void bind(lua_State *L, lua_module_archive *archive);
+
+            /**
+             * @brief 获取lua_State绑定的归档
+             * @return 未绑定时返回NULL
+             */
+            static lua_module_archive *get(lua_State *L);
+
+            /**
+             * @brief package.loaders/package.searchers 中使用的加载器，通过lua_engine::add_lua_loader添加
+             */
+            static int lua_searcher(lua_State *L);
+
+        private:
+            bool map_file();
+            void unmap_file();
+
+        private:
+            std::string archive_path_;
+            const char *data_;
+            size_t      data_size_;
+            uint32_t    entry_count_;
+            stats_t     stats_;
+#ifdef _WIN32
+            void *file_handle_;
+            void *mapping_handle_;
+#endif
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
@@ -0,0 +1,308 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <log/log_wrapper.h>
+
+#include "../lua_module/lua_adaptor.h"
+#include "lua_bytecode_cache.h"
+#include "lua_module_resolver.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            static char lua_module_resolver_registry_key     = 0;
+            static char lua_module_resolver_std_searcher_key = 0;
+
+            // 和lua的searchpath一致，只接受能打开的普通文件，目录和没有读权限的文件不缓存
+            static bool lua_module_resolver_readable(const std::string &file_path) {
+                struct stat st;
+                if (0 != stat(file_path.c_str(), &st) || S_IFREG != (st.st_mode & S_IFMT)) {
+                    return false;
+                }
+
+                FILE *f = fopen(file_path.c_str(), "r");
+                if (NULL == f) {
+                    return false;
+                }
+                fclose(f);
+                return true;
+            }
+
+            static bool lua_module_resolver_get_searchers(lua_State *L) {
+                lua_getglobal(L, "package");
+                if (!lua_istable(L, -1)) {
+                    lua_pop(L, 1);
+                    return false;
+                }
+
+                lua_getfield(L, -1, "loaders");
+                if (lua_isnil(L, -1)) {
+                    lua_pop(L, 1);
+                    lua_getfield(L, -1, "searchers");
+                }
+
+                if (!lua_istable(L, -1)) {
+                    lua_pop(L, 2);
+                    return false;
+                }
+
+                // L: package, searchers
+                return true;
+            }
+        } // namespace detail
+
+        lua_module_resolver::lua_module_resolver(constructor_helper &) { memset(&stats_, 0, sizeof(stats_)); }
+
+        lua_module_resolver::~lua_module_resolver() {}
+
+        lua_module_resolver::ptr_t lua_module_resolver::create() {
+            constructor_helper helper;
+            return std::make_shared<lua_module_resolver>(helper);
+        }
+
+        bool lua_module_resolver::resolve(lua_State *L, const char *module_name, std::string &out) {
+            if (NULL == module_name) {
+                return false;
+            }
+
+            lua_getglobal(L, "package");
+            if (!lua_istable(L, -1)) {
+                lua_pop(L, 1);
+                return false;
+            }
+
+            lua_getfield(L, -1, "path");
+            size_t      templates_len = 0;
+            const char *templates     = lua_tolstring(L, -1, &templates_len);
+            if (NULL == templates) {
+                lua_pop(L, 2);
+                return false;
+            }
+
+            // package.path变化后缓存全部失效
+            if (package_path_.size() != templates_len || 0 != memcmp(package_path_.data(), templates, templates_len)) {
+                if (!cache_.empty()) {
+                    flush(false);
+                }
+                package_path_.assign(templates, templates_len);
+            }
+
+            bool                  ret;
+            cache_map_t::iterator iter = cache_.find(module_name);
+            if (iter != cache_.end()) {
+                if (iter->second.empty()) {
+                    ++stats_.negative_hit_count;
+                    ret = false;
+                } else {
+                    ++stats_.hit_count;
+                    out = iter->second;
+                    ret = true;
+                }
+            } else {
+                ++stats_.miss_count;
+                ret = search_path(templates, module_name, out);
+                cache_[module_name] = ret ? out : std::string();
+            }
+
+            lua_pop(L, 2);
+            return ret;
+        }
+
+        void lua_module_resolver::flush(bool negative_only) {
+            ++stats_.flush_count;
+            if (!negative_only) {
+                cache_.clear();
+                return;
+            }
+
+            for (cache_map_t::iterator iter = cache_.begin(); iter != cache_.end();) {
+                if (iter->second.empty()) {
+                    iter = cache_.erase(iter);
+                } else {
+                    ++iter;
+                }
+            }
+        }
+
+        void lua_module_resolver::erase(const char *module_name) {
+            if (NULL != module_name) {
+                cache_.erase(module_name);
+            }
+        }
+
+        void lua_module_resolver::bind(lua_State *L, lua_module_resolver *resolver) {
+            lua_pushlightuserdata(L, &detail::lua_module_resolver_registry_key);
+            if (NULL == resolver) {
+                lua_pushnil(L);
+            } else {
+                lua_pushlightuserdata(L, resolver);
+            }
+            lua_rawset(L, LUA_REGISTRYINDEX);
+        }
+
+        lua_module_resolver *lua_module_resolver::get(lua_State *L) {
+            lua_pushlightuserdata(L, &detail::lua_module_resolver_registry_key);
+            lua_rawget(L, LUA_REGISTRYINDEX);
+            lua_module_resolver *ret = reinterpret_cast<lua_module_resolver *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+            return ret;
+        }
+
+        void lua_module_resolver::save_std_searcher(lua_State *L) {
+            if (!detail::lua_module_resolver_get_searchers(L)) {
+                return;
+            }
+
+            // luaL_openlibs后第2个加载器是标准的lua文件加载器
+            lua_pushlightuserdata(L, &detail::lua_module_resolver_std_searcher_key);
+            lua_rawgeti(L, -2, 2);
+            lua_rawset(L, LUA_REGISTRYINDEX);
+            lua_pop(L, 2);
+        }
+
+        int lua_module_resolver::install(lua_State *L) {
+            if (!detail::lua_module_resolver_get_searchers(L)) {
+                return -1;
+            }
+
+            // L: package, searchers
+            lua_pushlightuserdata(L, &detail::lua_module_resolver_std_searcher_key);
+            lua_rawget(L, LUA_REGISTRYINDEX); /* L: package, searchers, std_searcher */
+            if (lua_isnil(L, -1)) {
+                lua_pop(L, 3);
+                WLOGERROR("install lua module resolver failed, standard searcher not found");
+                return -1;
+            }
+
+            int std_index = 0;
+            LUA_GET_TABLE_LEN(int len, L, -2);
+            for (int i = 1; i <= len && 0 == std_index; ++i) {
+                lua_rawgeti(L, -2, i);
+                if (lua_rawequal(L, -1, -2)) {
+                    std_index = i;
+                }
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1); /* L: package, searchers */
+
+            if (0 == std_index) {
+                lua_pop(L, 2);
+                WLOGERROR("install lua module resolver failed, standard searcher was removed");
+                return -1;
+            }
+
+            lua_pushcfunction(L, lua_searcher);
+            lua_rawseti(L, -2, std_index);
+            lua_pop(L, 1); /* L: package */
+
+            lua_pushcfunction(L, lua_flush);
+            lua_setfield(L, -2, "resolver_flush");
+            lua_pop(L, 1);
+            return 0;
+        }
+
+        bool lua_module_resolver::find_module_file(lua_State *L, const char *module_name, std::string &out) {
+            lua_module_resolver *resolver = get(L);
+            if (NULL != resolver) {
+                return resolver->resolve(L, module_name, out);
+            }
+
+            lua_getglobal(L, "package");
+            if (!lua_istable(L, -1)) {
+                lua_pop(L, 1);
+                return false;
+            }
+
+            lua_getfield(L, -1, "path");
+            bool ret = search_path(lua_tostring(L, -1), module_name, out);
+            lua_pop(L, 2);
+            return ret;
+        }
+
+        bool lua_module_resolver::search_path(const char *templates, const char *module_name, std::string &out) {
+            if (NULL == templates || NULL == module_name) {
+                return false;
+            }
+
+            std::string name = module_name;
+            for (size_t i = 0; i < name.size(); ++i) {
+                if ('.' == name[i]) {
+                    name[i] = '/';
+                }
+            }
+
+            bool        ret = false;
+            const char *s = templates, *e = templates;
+            while (!ret) {
+                if ('\0' == *e || ';' == *e) {
+                    if (s < e) {
+                        out.clear();
+                        for (const char *c = s; c < e; ++c) {
+                            if ('?' == *c) {
+                                out += name;
+                            } else {
+                                out += *c;
+                            }
+                        }
+
+                        ret = detail::lua_module_resolver_readable(out);
+                    }
+
+                    if ('\0' == *e) {
+                        break;
+                    }
+                    s = e + 1;
+                }
+                ++e;
+            }
+
+            return ret;
+        }
+
+        int lua_module_resolver::lua_searcher(lua_State *L) {
+            const char *module_name = luaL_checkstring(L, 1);
+
+            std::string file_path;
+            if (!find_module_file(L, module_name, file_path)) {
+                lua_pushfstring(L, "\n\tno file for module '%s' in package.path (cached)", module_name);
+                return 1;
+            }
+
+            int res = lua_bytecode_cache::load_file(L, file_path.c_str());
+
+            // 缓存的文件已经被删除或移动，重新探测一次
+            lua_module_resolver *resolver = get(L);
+            if (LUA_ERRFILE == res && NULL != resolver) {
+                lua_pop(L, 1);
+                resolver->erase(module_name);
+                if (!find_module_file(L, module_name, file_path)) {
+                    lua_pushfstring(L, "\n\tno file for module '%s' in package.path (cached)", module_name);
+                    return 1;
+                }
+
+                res = lua_bytecode_cache::load_file(L, file_path.c_str());
+            }
+
+            if (LUA_OK != res) {
+                return luaL_error(L, "error loading module '%s' from file '%s':\n\t%s", module_name, file_path.c_str(),
+                                  lua_tostring(L, -1));
+            }
+
+            lua_pushlstring(L, file_path.c_str(), file_path.size());
+            return 2;
+        }
+
+        // package.resolver_flush([negative_only])
+        int lua_module_resolver::lua_flush(lua_State *L) {
+            lua_module_resolver *resolver = get(L);
+            if (NULL != resolver) {
+                resolver->flush(lua_toboolean(L, 1) ? true : false);
+            }
+
+            return 0;
+        }
+    } // namespace lua
+} // namespace script
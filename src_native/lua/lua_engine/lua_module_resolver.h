@@ -0,0 +1,128 @@
+#ifndef SCRIPT_LUA_LUAMODULERESOLVER
+#define SCRIPT_LUA_LUAMODULERESOLVER
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+extern "C" {
+#include "lauxlib.h"
+#include "lua.h"
+}
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 模块路径解析缓存
+         * 缓存 模块名 => package.path中找到的文件，找不到的模块也会缓存，可选的require不会重复探测文件系统
+         * package.path变化时自动清空，也可以调用flush或在lua中调用package.resolver_flush([negative_only])清空
+         * @note 通过install替换标准的lua文件加载器后，require和lua_bytecode_cache都会使用缓存
+         * @note 只处理package.path，package.cpath仍然由标准加载器处理
+         */
+        class lua_module_resolver : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_module_resolver> ptr_t;
+
+            struct stats_t {
+                size_t hit_count;          // 命中缓存的次数
+                size_t negative_hit_count; // 命中"找不到"缓存的次数
+                size_t miss_count;         // 探测文件系统的次数
+                size_t flush_count;        // 清空缓存的次数
+            };
+
+        private:
+            struct constructor_helper {};
+
+            typedef std::unordered_map<std::string, std::string> cache_map_t; // 值为空表示找不到
+
+        public:
+            lua_module_resolver(constructor_helper &helper);
+            ~lua_module_resolver();
+
+            static ptr_t create();
+
+            /**
+             * @brief 解析模块文件路径
+             * @param L lua State，用于读取package.path
+             * @param module_name 模块名
+             * @param out 输出找到的文件路径
+             * @return 找到返回true
+             */
+            bool resolve(lua_State *L, const char *module_name, std::string &out);
+
+            /**
+             * @brief 清空缓存
+             * @param negative_only 为true时只清空"找不到"的缓存
+             */
+            void flush(bool negative_only = false);
+
+            /**
+             * @brief 移除单个模块的缓存
+             */
+            void erase(const char *module_name);
+
+            inline size_t size() const { return cache_.size(); }
+
+            inline const stats_t &get_stats() const { return stats_; }
+
+            /**
+             * @brief 绑定到lua_State，resolver为NULL时解除绑定
+             * @note 调用者需要保证resolver的生命周期长于lua_State
+             */
+            static void bind(lua_State *L, lua_module_resolver *resolver);
+
+            /**
+             * @brief 获取lua_State绑定的解析缓存
+             * @return 未绑定时返回NULL
+             */
+            static lua_module_resolver *get(lua_State *L);
+
+            /**
+             * @brief 记录标准的lua文件加载器，需要在luaL_openlibs后、添加其他加载器前调用
+             */
+            static void save_std_searcher(lua_State *L);
+
+            /**
+             * @brief 用lua_searcher替换标准的lua文件加载器，并注册package.resolver_flush
+             * @return 0或错误码
+             */
+            static int install(lua_State *L);
+
+            /**
+             * @brief 按package.path查找模块文件，lua_State绑定了解析缓存时使用缓存
+             * @return 找到返回true
+             */
+            static bool find_module_file(lua_State *L, const char *module_name, std::string &out);
+
+            /**
+             * @brief 在路径模板中查找模块文件
+             * @param templates 路径模板，如 ./?.lua;./?.luac
+             * @param module_name 模块名
+             * @param out 输出找到的文件路径
+             * @return 找到返回true
+             */
+            static bool search_path(const char *templates, const char *module_name, std::string &out);
+
+            /**
+             * @brief package.loaders/package.searchers 中使用的加载器
+             */
+            static int lua_searcher(lua_State *L);
+
+        private:
+            static int lua_flush(lua_State *L);
+
+        private:
+            std::string package_path_;
+            cache_map_t cache_;
+            stats_t     stats_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef SCRIPT_LUA_LUAMPSCQUEUE
+#define SCRIPT_LUA_LUAMPSCQUEUE
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 无锁多生产者单消费者队列(Vyukov MPSC)
+         * push可以在任意线程调用，pop只能在唯一的消费者线程调用
+         *
+         * @tparam  T   元素类型
+         */
+        template <typename T>
+        class lua_mpsc_queue : public ::util::design_pattern::noncopyable {
+        public:
+            typedef T value_type;
+
+        private:
+            struct node {
+                std::atomic<node *> next;
+                value_type          value;
+
+                node() : next(NULL) {}
+                explicit node(value_type &&v) : next(NULL), value(std::move(v)) {}
+            };
+
+        public:
+            lua_mpsc_queue() : head_(new node()), tail_(NULL), size_(0) { tail_ = head_.load(std::memory_order_relaxed); }
+
+            ~lua_mpsc_queue() {
+                value_type ignore;
+                while (pop(ignore)) {
+                }
+
+                delete tail_;
+            }
+
+            /**
+             * @brief 入队，任意线程
+             */
+            void push(value_type v) {
+                node *n    = new node(std::move(v));
+                node *prev = head_.exchange(n, std::memory_order_acq_rel);
+                prev->next.store(n, std::memory_order_release);
+                size_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief 出队，仅消费者线程
+             * @return 队列为空(或生产者正在入队)时返回false
+             */
+            bool pop(value_type &out) {
+                node *tail = tail_;
+                node *next = tail->next.load(std::memory_order_acquire);
+                if (NULL == next) {
+                    return false;
+                }
+
+                out   = std::move(next->value);
+                tail_ = next;
+                delete tail;
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            /**
+             * @brief 近似的元素个数
+             */
+            inline size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+            inline bool empty() const { return NULL == tail_->next.load(std::memory_order_acquire); }
+
+        private:
+            std::atomic<node *> head_;
+            node *              tail_;
+            std::atomic<size_t> size_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
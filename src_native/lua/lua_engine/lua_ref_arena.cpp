@@ -0,0 +1,71 @@
+#include "lua_ref_arena.h"
+
+namespace script {
+    namespace lua {
+        lua_ref_arena::lua_ref_arena() : tail_(0), size_(0) {}
+
+        lua_ref_arena::~lua_ref_arena() {
+            // 析构对象时可能再次push()，直到没有新的引用为止
+            while (!used_.empty()) {
+                release();
+            }
+            shrink();
+        }
+
+        void lua_ref_arena::push(const std::shared_ptr<void> &ptr) {
+            if (used_.empty() || tail_ >= CHUNK_SIZE) {
+                chunk_t *chunk;
+                if (free_.empty()) {
+                    chunk = new chunk_t();
+                } else {
+                    chunk = free_.back();
+                    free_.pop_back();
+                }
+
+                used_.push_back(chunk);
+                tail_ = 0;
+            }
+
+            used_.back()->slots[tail_++] = ptr;
+            ++size_;
+        }
+
+        size_t lua_ref_arena::release() {
+            if (0 == size_) {
+                return 0;
+            }
+
+            // 析构对象时可能再次调用push()或release()，先取出待释放的块
+            size_t                 ret  = size_;
+            size_t                 tail = tail_;
+            std::vector<chunk_t *> releasing;
+            releasing.swap(used_);
+            tail_ = 0;
+            size_ = 0;
+
+            for (size_t i = 0; i < releasing.size(); ++i) {
+                size_t   n     = i + 1 == releasing.size() ? tail : static_cast<size_t>(CHUNK_SIZE);
+                chunk_t *chunk = releasing[i];
+                for (size_t j = 0; j < n; ++j) {
+                    chunk->slots[j].reset();
+                }
+                free_.push_back(chunk);
+            }
+
+            // 没有重入时复用数组的内存
+            if (used_.empty()) {
+                releasing.clear();
+                used_.swap(releasing);
+            }
+
+            return ret;
+        }
+
+        void lua_ref_arena::shrink() {
+            for (size_t i = 0; i < free_.size(); ++i) {
+                delete free_[i];
+            }
+            free_.clear();
+        }
+    } // namespace lua
+} // namespace script
@@ -0,0 +1,66 @@
+#ifndef SCRIPT_LUA_LUAREFARENA
+#define SCRIPT_LUA_LUAREFARENA
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 分块的引用缓存
+         * 对象按顺序写入固定大小的块，release()一次性释放所有引用，块放回空闲列表复用
+         * 稳定运行后push()不再分配内存，也不会因为扩容移动已有的元素
+         * @note 非线程安全
+         */
+        class lua_ref_arena : public ::util::design_pattern::noncopyable {
+        public:
+            enum { CHUNK_SIZE = 256 };
+
+        private:
+            struct chunk_t {
+                std::shared_ptr<void> slots[CHUNK_SIZE];
+            };
+
+        public:
+            lua_ref_arena();
+            ~lua_ref_arena();
+
+            void push(const std::shared_ptr<void> &ptr);
+
+            /**
+             * @brief 释放所有引用
+             * @note 释放过程中push()的引用保留到下一次release()
+             * @return 释放的引用数
+             */
+            size_t release();
+
+            /**
+             * @brief 释放空闲的块
+             */
+            void shrink();
+
+            inline size_t size() const { return size_; }
+
+            inline bool empty() const { return 0 == size_; }
+
+            /**
+             * @brief 获取已分配的块数(包含空闲的块)
+             */
+            inline size_t get_chunk_count() const { return used_.size() + free_.size(); }
+
+        private:
+            std::vector<chunk_t *> used_; // 最后一个块是当前写入的块
+            std::vector<chunk_t *> free_;
+            size_t                 tail_; // 当前块已写入的数量
+            size_t                 size_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
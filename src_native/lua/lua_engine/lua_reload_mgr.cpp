@@ -0,0 +1,399 @@
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <log/log_wrapper.h>
+
+#include "../lua_module/lua_adaptor.h"
+#include "lua_binding_utils.h"
+#include "lua_item_path.h"
+#include "lua_module_resolver.h"
+#include "lua_reload_mgr.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            static char lua_reload_mgr_registry_key = 0;
+
+            static time_t lua_reload_mgr_mtime(const std::string &file_path) {
+                struct stat st;
+                if (0 != stat(file_path.c_str(), &st)) {
+                    return 0;
+                }
+
+                return st.st_mtime;
+            }
+        } // namespace detail
+
+        lua_reload_mgr::lua_reload_mgr(constructor_helper &helper) : state_(helper.L), inotify_fd_(-1) {
+#if defined(__linux__)
+            inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (inotify_fd_ < 0) {
+                WLOGERROR("inotify_init1 failed, errno: %d, lua reload manager will check file modification time", errno);
+            }
+#endif
+        }
+
+        lua_reload_mgr::~lua_reload_mgr() {
+#if defined(__linux__)
+            if (inotify_fd_ >= 0) {
+                close(inotify_fd_);
+                inotify_fd_ = -1;
+            }
+#endif
+        }
+
+        lua_reload_mgr::ptr_t lua_reload_mgr::create(lua_State *L) {
+            if (NULL == L) {
+                return ptr_t();
+            }
+
+            constructor_helper helper;
+            helper.L = L;
+            return std::make_shared<lua_reload_mgr>(helper);
+        }
+
+        int lua_reload_mgr::install() {
+            lua_State *L = state_;
+
+            lua_getglobal(L, "require");
+            if (!lua_isfunction(L, -1)) {
+                lua_pop(L, 1);
+                WLOGERROR("install lua reload manager failed, require not found");
+                return -1;
+            }
+
+            lua_getglobal(L, "package");
+            if (!lua_istable(L, -1)) {
+                lua_pop(L, 2);
+                WLOGERROR("install lua reload manager failed, package not found");
+                return -1;
+            }
+
+            lua_pushlightuserdata(L, &detail::lua_reload_mgr_registry_key);
+            lua_pushlightuserdata(L, this);
+            lua_rawset(L, LUA_REGISTRYINDEX);
+
+            lua_pushcfunction(L, lua_reload_changed);
+            lua_setfield(L, -2, "reload_changed");
+            lua_pop(L, 1); /* L: require */
+
+            // 原始的require作为upvalue
+            lua_pushcclosure(L, lua_require, 1);
+            lua_setglobal(L, "require");
+            return 0;
+        }
+
+        size_t lua_reload_mgr::check_changes() {
+            size_t ret = 0;
+
+#if defined(__linux__)
+            if (inotify_fd_ >= 0) {
+                char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+                while (true) {
+                    ssize_t len = read(inotify_fd_, buffer, sizeof(buffer));
+                    if (len <= 0) {
+                        break;
+                    }
+
+                    for (char *ptr = buffer; ptr < buffer + len;) {
+                        const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+                        ptr += sizeof(struct inotify_event) + event->len;
+
+                        std::unordered_map<int, std::string>::iterator dir_iter = watch_dirs_.find(event->wd);
+                        if (0 == event->len || dir_iter == watch_dirs_.end()) {
+                            continue;
+                        }
+
+                        std::string file_path = dir_iter->second;
+                        file_path += '/';
+                        file_path += event->name;
+
+                        std::unordered_map<std::string, std::string>::iterator file_iter = file_modules_.find(file_path);
+                        if (file_iter != file_modules_.end() && changed_.insert(file_iter->second).second) {
+                            ++ret;
+                        }
+                    }
+                }
+
+                return ret;
+            }
+#endif
+
+            for (module_map_t::iterator iter = modules_.begin(); iter != modules_.end(); ++iter) {
+                if (iter->second.file_path.empty()) {
+                    continue;
+                }
+
+                time_t mtime = detail::lua_reload_mgr_mtime(iter->second.file_path);
+                if (0 != mtime && mtime != iter->second.mtime) {
+                    iter->second.mtime = mtime;
+                    if (changed_.insert(iter->first).second) {
+                        ++ret;
+                    }
+                }
+            }
+
+            return ret;
+        }
+
+        void lua_reload_mgr::mark_changed(const std::string &module_name) { changed_.insert(module_name); }
+
+        size_t lua_reload_mgr::reload(std::vector<reload_result> *results) { return reload_modules(state_, results); }
+
+        size_t lua_reload_mgr::reload_modules(lua_State *L, std::vector<reload_result> *results) {
+            if (changed_.empty()) {
+                return 0;
+            }
+
+            // 修改过的模块和所有直接或间接依赖它们的模块
+            std::set<std::string>    targets;
+            std::vector<std::string> pending(changed_.begin(), changed_.end());
+            while (!pending.empty()) {
+                std::string name = pending.back();
+                pending.pop_back();
+                if (!targets.insert(name).second) {
+                    continue;
+                }
+
+                module_map_t::const_iterator iter = modules_.find(name);
+                if (iter != modules_.end()) {
+                    pending.insert(pending.end(), iter->second.dependents.begin(), iter->second.dependents.end());
+                }
+            }
+            changed_.clear();
+
+            // 重新加载后模块导出的函数会变化
+            lua_item_path::invalidate(L);
+
+            // 依赖的模块先加载
+            std::set<std::string>    visited;
+            std::vector<std::string> order;
+            for (std::set<std::string>::const_iterator iter = targets.begin(); iter != targets.end(); ++iter) {
+                collect_reload_order(*iter, targets, visited, order);
+            }
+
+            int top = lua_gettop(L);
+            for (size_t i = 0; i < order.size(); ++i) {
+                lua_getglobal(L, "package");
+                if (lua_istable(L, -1)) {
+                    lua_getfield(L, -1, "loaded");
+                    if (lua_istable(L, -1)) {
+                        lua_pushnil(L);
+                        lua_setfield(L, -2, order[i].c_str());
+                    }
+                }
+                lua_settop(L, top);
+            }
+
+            for (size_t i = 0; i < order.size(); ++i) {
+                // 已经被前面模块的require加载过了
+                lua_getglobal(L, "package");
+                lua_getfield(L, -1, "loaded");
+                lua_getfield(L, -1, order[i].c_str());
+                bool loaded = !lua_isnil(L, -1);
+                lua_settop(L, top);
+
+                std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+                bool                                  success = true;
+                std::string                           error;
+                if (!loaded) {
+                    int hmsg = fn::get_pcall_hmsg(L);
+                    lua_getglobal(L, "require");
+                    lua_pushlstring(L, order[i].c_str(), order[i].size());
+                    if (0 != lua_pcall(L, 1, 0, hmsg)) {
+                        success = false;
+                        error   = lua_tostring(L, -1) ? lua_tostring(L, -1) : "unknown error";
+                        WLOGERROR("[Lua]: reload module %s failed\n%s", order[i].c_str(), error.c_str());
+                    }
+                    lua_settop(L, top);
+                }
+
+                if (NULL != results) {
+                    reload_result res;
+                    res.name    = order[i];
+                    res.cost    = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+                    res.success = success;
+                    res.error.swap(error);
+                    results->push_back(res);
+                }
+            }
+
+            return order.size();
+        }
+
+        const lua_reload_mgr::module_info *lua_reload_mgr::get_module(const std::string &module_name) const {
+            module_map_t::const_iterator iter = modules_.find(module_name);
+            if (iter == modules_.end()) {
+                return NULL;
+            }
+
+            return &iter->second;
+        }
+
+        lua_reload_mgr *lua_reload_mgr::get(lua_State *L) {
+            lua_pushlightuserdata(L, &detail::lua_reload_mgr_registry_key);
+            lua_rawget(L, LUA_REGISTRYINDEX);
+            lua_reload_mgr *ret = reinterpret_cast<lua_reload_mgr *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+            return ret;
+        }
+
+        void lua_reload_mgr::on_module_loaded(const std::string &name, const std::string &parent) {
+            module_info &info = modules_[name];
+            info.name         = name;
+
+            if (!parent.empty() && parent != name) {
+                info.dependents.insert(parent);
+
+                module_info &parent_info = modules_[parent];
+                parent_info.name         = parent;
+                parent_info.dependencies.insert(name);
+            }
+        }
+
+        void lua_reload_mgr::watch_file(const std::string &file_path) {
+            std::string::size_type pos = file_path.find_last_of("/\\");
+            std::string            dir = std::string::npos == pos ? std::string(".") : file_path.substr(0, pos);
+            if (!watched_dirs_.insert(dir).second) {
+                return;
+            }
+
+#if defined(__linux__)
+            if (inotify_fd_ >= 0) {
+                int wd = inotify_add_watch(inotify_fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+                if (wd < 0) {
+                    WLOGERROR("inotify_add_watch %s failed, errno: %d", dir.c_str(), errno);
+                    return;
+                }
+
+                watch_dirs_[wd] = dir;
+            }
+#endif
+        }
+
+        void lua_reload_mgr::collect_reload_order(const std::string &name, const std::set<std::string> &targets, std::set<std::string> &visited,
+                                                  std::vector<std::string> &order) const {
+            if (!visited.insert(name).second) {
+                return;
+            }
+
+            module_map_t::const_iterator iter = modules_.find(name);
+            if (iter != modules_.end()) {
+                for (std::set<std::string>::const_iterator dep = iter->second.dependencies.begin(); dep != iter->second.dependencies.end();
+                     ++dep) {
+                    if (targets.end() != targets.find(*dep)) {
+                        collect_reload_order(*dep, targets, visited, order);
+                    }
+                }
+            }
+
+            order.push_back(name);
+        }
+
+        int lua_reload_mgr::lua_require(lua_State *L) {
+            const char *    name = luaL_checkstring(L, 1);
+            lua_reload_mgr *self = get(L);
+            int             top  = lua_gettop(L);
+
+            bool fresh = false;
+            lua_getglobal(L, "package");
+            if (lua_istable(L, -1)) {
+                lua_getfield(L, -1, "loaded");
+                if (lua_istable(L, -1)) {
+                    lua_getfield(L, -1, name);
+                    fresh = lua_isnil(L, -1);
+                }
+            }
+            lua_settop(L, top);
+
+            std::string module_name = name;
+            std::string parent;
+            if (NULL != self) {
+                if (!self->loading_.empty()) {
+                    parent = self->loading_.back();
+                }
+
+                if (fresh) {
+                    // 重新加载时依赖关系重新记录
+                    module_map_t::iterator iter = self->modules_.find(module_name);
+                    if (iter != self->modules_.end()) {
+                        for (std::set<std::string>::const_iterator dep = iter->second.dependencies.begin();
+                             dep != iter->second.dependencies.end(); ++dep) {
+                            module_map_t::iterator dep_iter = self->modules_.find(*dep);
+                            if (dep_iter != self->modules_.end()) {
+                                dep_iter->second.dependents.erase(module_name);
+                            }
+                        }
+                        iter->second.dependencies.clear();
+                    }
+
+                    self->loading_.push_back(module_name);
+                }
+            }
+
+            lua_pushvalue(L, lua_upvalueindex(1));
+            lua_pushvalue(L, 1);
+            int res = lua_pcall(L, 1, LUA_MULTRET, 0);
+
+            // 管理器可能在加载过程中被重新绑定，重新获取
+            self = get(L);
+            if (NULL != self && fresh && !self->loading_.empty() && self->loading_.back() == module_name) {
+                self->loading_.pop_back();
+            }
+
+            // 原样抛出错误对象，非字符串的错误也不会丢失
+            if (0 != res) {
+                return lua_error(L);
+            }
+
+            if (NULL != self) {
+                self->on_module_loaded(module_name, parent);
+
+                module_info &info = self->modules_[module_name];
+                if (fresh && info.file_path.empty() && lua_module_resolver::find_module_file(L, name, info.file_path)) {
+                    self->file_modules_[info.file_path] = module_name;
+                    self->watch_file(info.file_path);
+                }
+
+                if (fresh && !info.file_path.empty()) {
+                    info.mtime = detail::lua_reload_mgr_mtime(info.file_path);
+                }
+            }
+
+            return lua_gettop(L) - top;
+        }
+
+        // package.reload_changed() => { [module_name] = cost_ms }
+        int lua_reload_mgr::lua_reload_changed(lua_State *L) {
+            lua_reload_mgr *self = get(L);
+            if (NULL == self) {
+                lua_pushnil(L);
+                return 1;
+            }
+
+            std::vector<reload_result> results;
+            self->check_changes();
+            self->reload_modules(L, &results);
+
+            lua_createtable(L, 0, static_cast<int>(results.size()));
+            for (size_t i = 0; i < results.size(); ++i) {
+                if (results[i].success) {
+                    lua_pushnumber(L, static_cast<lua_Number>(results[i].cost.count()) / 1000000.0);
+                } else {
+                    lua_pushboolean(L, 0);
+                }
+                lua_setfield(L, -2, results[i].name.c_str());
+            }
+
+            return 1;
+        }
+    } // namespace lua
+} // namespace script
@@ -0,0 +1,129 @@
+#ifndef SCRIPT_LUA_LUARELOADMGR
+#define SCRIPT_LUA_LUARELOADMGR
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include "lauxlib.h"
+#include "lua.h"
+}
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 增量热更新管理器
+         * 包装全局的require记录模块依赖关系和模块文件，监控模块文件所在的目录(linux下使用inotify，其他平台检查修改时间)，
+         * 热更新时只重新加载修改过的模块和依赖它们的模块
+         * @note lua中可以调用package.reload_changed()执行热更新，返回 { 模块名 = 耗时(毫秒) }
+         */
+        class lua_reload_mgr : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_reload_mgr> ptr_t;
+
+            struct module_info {
+                std::string           name;
+                std::string           file_path;  // 为空表示不是lua文件模块(比如C模块或preload)
+                time_t                mtime;
+                std::set<std::string> dependencies; // 本模块require的模块
+                std::set<std::string> dependents;   // require本模块的模块
+            };
+
+            struct reload_result {
+                std::string              name;
+                std::chrono::nanoseconds cost;
+                bool                     success;
+                std::string              error;
+            };
+
+        private:
+            struct constructor_helper {
+                lua_State *L;
+            };
+
+            typedef std::unordered_map<std::string, module_info> module_map_t;
+
+        public:
+            lua_reload_mgr(constructor_helper &helper);
+            ~lua_reload_mgr();
+
+            static ptr_t create(lua_State *L);
+
+            /**
+             * @brief 包装全局的require并注册package.reload_changed
+             * @note 只有install之后require的模块才会被记录
+             * @return 0或错误码
+             */
+            int install();
+
+            /**
+             * @brief 检查文件修改
+             * @return 新发现的修改过的模块数
+             */
+            size_t check_changes();
+
+            /**
+             * @brief 手动标记模块已修改
+             */
+            void mark_changed(const std::string &module_name);
+
+            inline const std::set<std::string> &get_changed_modules() const { return changed_; }
+
+            /**
+             * @brief 重新加载修改过的模块和依赖它们的模块，依赖的模块先加载
+             * @param results 输出每个模块的加载结果，可以为空
+             * @return 重新加载的模块数，失败的模块也计算在内
+             */
+            size_t reload(std::vector<reload_result> *results = NULL);
+
+            /**
+             * @brief 获取模块信息
+             * @return 没有记录时返回NULL
+             */
+            const module_info *get_module(const std::string &module_name) const;
+
+            inline size_t size() const { return modules_.size(); }
+
+            inline bool is_inotify_enabled() const { return inotify_fd_ >= 0; }
+
+            /**
+             * @brief 获取lua_State绑定的热更新管理器
+             * @return 未绑定时返回NULL
+             */
+            static lua_reload_mgr *get(lua_State *L);
+
+        private:
+            size_t reload_modules(lua_State *L, std::vector<reload_result> *results);
+            void   on_module_loaded(const std::string &name, const std::string &parent);
+            void   watch_file(const std::string &file_path);
+            void   collect_reload_order(const std::string &name, const std::set<std::string> &targets, std::set<std::string> &visited,
+                                      std::vector<std::string> &order) const;
+
+            static int lua_require(lua_State *L);
+            static int lua_reload_changed(lua_State *L);
+
+        private:
+            lua_State *                                  state_;
+            module_map_t                                 modules_;
+            std::vector<std::string>                     loading_; // 正在加载的模块栈
+            std::set<std::string>                        changed_;
+            std::unordered_map<std::string, std::string> file_modules_; // 文件路径 => 模块名
+            int                                          inotify_fd_;
+            std::unordered_map<int, std::string>         watch_dirs_; // inotify watch => 目录
+            std::set<std::string>                        watched_dirs_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif
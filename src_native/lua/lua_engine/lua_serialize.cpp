@@ -0,0 +1,199 @@
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+extern "C" {
+#include "lauxlib.h"
+#include "lua.h"
+}
+
+#include <log/log_wrapper.h>
+
+#include "../lua_module/lua_adaptor.h"
+#include "lua_serialize.h"
+
+namespace script {
+    namespace lua {
+        namespace detail {
+            enum lua_serialize_tag {
+                LST_NIL       = 'n',
+                LST_FALSE     = 'f',
+                LST_TRUE      = 't',
+                LST_INTEGER   = 'i',
+                LST_NUMBER    = 'd',
+                LST_STRING    = 's',
+                LST_TABLE     = 'T',
+                LST_TABLE_END = 'e',
+            };
+
+            static const int LUA_SERIALIZE_MAX_DEPTH = 64;
+
+            static bool lua_serialize_value(lua_State *L, int index, std::string &out, int depth) {
+                if (depth > LUA_SERIALIZE_MAX_DEPTH) {
+                    WLOGERROR("serialize lua value failed, table too deep or has a cycle");
+                    return false;
+                }
+
+                switch (lua_type(L, index)) {
+                case LUA_TNIL:
+                case LUA_TNONE:
+                    out.push_back(static_cast<char>(LST_NIL));
+                    return true;
+                case LUA_TBOOLEAN:
+                    out.push_back(static_cast<char>(lua_toboolean(L, index) ? LST_TRUE : LST_FALSE));
+                    return true;
+                case LUA_TNUMBER: {
+#if LUA_VERSION_NUM >= 503
+                    if (lua_isinteger(L, index)) {
+                        lua_Integer v = lua_tointeger(L, index);
+                        out.push_back(static_cast<char>(LST_INTEGER));
+                        out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+                        return true;
+                    }
+#endif
+                    lua_Number v = lua_tonumber(L, index);
+                    out.push_back(static_cast<char>(LST_NUMBER));
+                    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+                    return true;
+                }
+                case LUA_TSTRING: {
+                    size_t      len = 0;
+                    const char *s   = lua_tolstring(L, index, &len);
+                    uint32_t    l32 = static_cast<uint32_t>(len);
+                    out.push_back(static_cast<char>(LST_STRING));
+                    out.append(reinterpret_cast<const char *>(&l32), sizeof(l32));
+                    out.append(s, len);
+                    return true;
+                }
+                case LUA_TTABLE: {
+                    if (index < 0) {
+                        index = lua_gettop(L) + 1 + index;
+                    }
+
+                    luaL_checkstack(L, 3, "serialize lua table");
+                    out.push_back(static_cast<char>(LST_TABLE));
+                    lua_pushnil(L);
+                    while (lua_next(L, index) != 0) {
+                        if (!lua_serialize_value(L, -2, out, depth + 1) || !lua_serialize_value(L, -1, out, depth + 1)) {
+                            lua_pop(L, 2);
+                            return false;
+                        }
+                        lua_pop(L, 1);
+                    }
+                    out.push_back(static_cast<char>(LST_TABLE_END));
+                    return true;
+                }
+                default:
+                    WLOGERROR("serialize lua value failed, type %s is not supported", luaL_typename(L, index));
+                    return false;
+                }
+            }
+
+            static bool lua_deserialize_value(lua_State *L, const char *&data, const char *end, int depth) {
+                if (data >= end || depth > LUA_SERIALIZE_MAX_DEPTH) {
+                    return false;
+                }
+
+                char tag = *data++;
+                switch (tag) {
+                case LST_NIL:
+                    lua_pushnil(L);
+                    return true;
+                case LST_FALSE:
+                    lua_pushboolean(L, 0);
+                    return true;
+                case LST_TRUE:
+                    lua_pushboolean(L, 1);
+                    return true;
+                case LST_INTEGER: {
+                    lua_Integer v;
+                    if (end - data < static_cast<ptrdiff_t>(sizeof(v))) {
+                        return false;
+                    }
+                    memcpy(&v, data, sizeof(v));
+                    data += sizeof(v);
+                    lua_pushinteger(L, v);
+                    return true;
+                }
+                case LST_NUMBER: {
+                    lua_Number v;
+                    if (end - data < static_cast<ptrdiff_t>(sizeof(v))) {
+                        return false;
+                    }
+                    memcpy(&v, data, sizeof(v));
+                    data += sizeof(v);
+                    lua_pushnumber(L, v);
+                    return true;
+                }
+                case LST_STRING: {
+                    uint32_t len;
+                    if (end - data < static_cast<ptrdiff_t>(sizeof(len))) {
+                        return false;
+                    }
+                    memcpy(&len, data, sizeof(len));
+                    data += sizeof(len);
+                    if (end - data < static_cast<ptrdiff_t>(len)) {
+                        return false;
+                    }
+                    lua_pushlstring(L, data, len);
+                    data += len;
+                    return true;
+                }
+                case LST_TABLE: {
+                    luaL_checkstack(L, 3, "deserialize lua table");
+                    lua_newtable(L);
+                    while (data < end && LST_TABLE_END != *data) {
+                        if (!lua_deserialize_value(L, data, end, depth + 1)) {
+                            lua_pop(L, 1);
+                            return false;
+                        }
+                        if (!lua_deserialize_value(L, data, end, depth + 1)) {
+                            lua_pop(L, 2);
+                            return false;
+                        }
+
+                        if (lua_isnil(L, -2)) {
+                            lua_pop(L, 2);
+                        } else {
+                            lua_rawset(L, -3);
+                        }
+                    }
+
+                    if (data >= end) {
+                        lua_pop(L, 1);
+                        return false;
+                    }
+                    ++data;
+                    return true;
+                }
+                default:
+                    return false;
+                }
+            }
+        } // namespace detail
+
+        namespace fn {
+            bool serialize_value(lua_State *L, int index, std::string &out) {
+                size_t old_size = out.size();
+                if (!detail::lua_serialize_value(L, index, out, 0)) {
+                    out.resize(old_size);
+                    return false;
+                }
+
+                return true;
+            }
+
+            bool deserialize_value(lua_State *L, const char *data, size_t sz) {
+                int         top = lua_gettop(L);
+                const char *end = data + sz;
+                if (NULL == data || !detail::lua_deserialize_value(L, data, end, 0) || data != end) {
+                    lua_settop(L, top);
+                    lua_pushnil(L);
+                    return false;
+                }
+
+                return true;
+            }
+        } // namespace fn
+    }     // namespace lua
+} // namespace script
@@ -0,0 +1,40 @@
+#ifndef SCRIPT_LUA_LUASERIALIZE
+#define SCRIPT_LUA_LUASERIALIZE
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+extern "C" {
+#include "lua.h"
+}
+
+namespace script {
+    namespace lua {
+        namespace fn {
+            /**
+             * @brief 把lua值序列化为二进制数据
+             * @note 支持nil、boolean、number、string和由这些类型组成的table(不包含metatable)
+             * @note 不支持function、userdata、thread和有环的table
+             * @param L lua State
+             * @param index 要序列化的值的栈下标
+             * @param out 输出，序列化的数据会追加到末尾
+             * @return true if success
+             */
+            bool serialize_value(lua_State *L, int index, std::string &out);
+
+            /**
+             * @brief 反序列化serialize_value生成的数据并入栈
+             * @param L lua State
+             * @param data 数据
+             * @param sz 数据长度
+             * @note this API always push a value into stack, push nil if failed
+             * @return true if success
+             */
+            bool deserialize_value(lua_State *L, const char *data, size_t sz);
+        } // namespace fn
+    }     // namespace lua
+} // namespace script
+
+#endif
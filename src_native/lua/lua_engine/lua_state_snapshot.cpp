@@ -0,0 +1,809 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include "lauxlib.h"
+#include "lua.h"
+}
+
+#include <log/log_wrapper.h>
+
+#include "../lua_module/lua_adaptor.h"
+#include "lua_state_snapshot.h"
+
+namespace script {
+    namespace lua {
+#if LUA_VERSION_NUM >= 502
+        namespace detail {
+            // 对象类型
+            enum lua_snapshot_kind {
+                LSK_TABLE    = 'T',
+                LSK_FUNCTION = 'F',
+                LSK_NATIVE   = 'N',
+            };
+
+            // 值类型
+            enum lua_snapshot_tag {
+                LST_NIL     = 'n',
+                LST_FALSE   = 'f',
+                LST_TRUE    = 't',
+                LST_INTEGER = 'i',
+                LST_NUMBER  = 'd',
+                LST_STRING  = 's',
+                LST_REF     = 'r',
+                LST_UPVALUE = 'v', // 独立的upvalue
+                LST_JOIN    = 'j', // 和之前的闭包共享的upvalue
+            };
+
+            // 路径中整数键的前缀，字符串键不能以它开头，也不能包含'.'
+            static const char LUA_SNAPSHOT_INDEX_MARK = '\x01';
+
+            struct lua_snapshot_header {
+                char     magic[4];
+                int32_t  lua_version_num;
+                int32_t  integer_size;
+                int32_t  number_size;
+                uint32_t object_count;
+            };
+
+            static int lua_snapshot_dump_writer(lua_State *, const void *p, size_t sz, void *ud) {
+                reinterpret_cast<std::string *>(ud)->append(reinterpret_cast<const char *>(p), sz);
+                return 0;
+            }
+
+            static bool lua_snapshot_to_index(lua_State *L, int index, lua_Integer &out) {
+                if (LUA_TNUMBER != lua_type(L, index)) {
+                    return false;
+                }
+
+#if LUA_VERSION_NUM >= 503
+                if (!lua_isinteger(L, index)) {
+                    return false;
+                }
+                out = lua_tointeger(L, index);
+                return true;
+#else
+                lua_Number n = lua_tonumber(L, index);
+                out          = static_cast<lua_Integer>(n);
+                return static_cast<lua_Number>(out) == n;
+#endif
+            }
+
+            static void lua_snapshot_init_header(lua_snapshot_header &header, uint32_t object_count) {
+                memset(&header, 0, sizeof(header));
+                memcpy(header.magic, "LSNP", 4);
+                header.lua_version_num = static_cast<int32_t>(LUA_VERSION_NUM);
+                header.integer_size    = static_cast<int32_t>(sizeof(lua_Integer));
+                header.number_size     = static_cast<int32_t>(sizeof(lua_Number));
+                header.object_count    = object_count;
+            }
+
+            class lua_snapshot_writer {
+            public:
+                lua_snapshot_writer(lua_State *L) : L_(L), objs_index_(0), next_id_(0) {}
+
+                int run(std::string &out) {
+                    int top = lua_gettop(L_);
+                    luaL_checkstack(L_, 16, "lua snapshot");
+
+                    lua_newtable(L_);
+                    objs_index_ = lua_gettop(L_);
+
+                    build_paths();
+
+                    lua_pushglobaltable(L_);
+                    ref_object(lua_gettop(L_));
+                    lua_pop(L_, 1);
+
+                    // ref_object会追加新的对象，所以每次循环都要重新比较next_id_
+                    for (uint32_t id = 1; id <= next_id_ && error_.empty(); ++id) {
+                        lua_rawgeti(L_, objs_index_, static_cast<lua_Integer>(id));
+                        write_object(id, lua_gettop(L_));
+                        lua_pop(L_, 1);
+                    }
+
+                    lua_settop(L_, top);
+                    if (!error_.empty()) {
+                        out.swap(error_);
+                        return -1;
+                    }
+
+                    lua_snapshot_header header;
+                    lua_snapshot_init_header(header, next_id_);
+                    out.clear();
+                    out.reserve(sizeof(header) + body_.size());
+                    out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+                    out.append(body_);
+                    return 0;
+                }
+
+            private:
+                // 按广度优先给可以从_G通过字符串键或整数键访问到的对象记录最短路径
+                // 整数键用于数组中的C函数，例如package.searchers
+                void build_paths() {
+                    lua_newtable(L_);
+                    int queue_index = lua_gettop(L_);
+
+                    std::vector<std::string> queue_paths;
+                    lua_pushglobaltable(L_);
+                    paths_[lua_topointer(L_, -1)] = std::string();
+                    lua_rawseti(L_, queue_index, 1);
+                    queue_paths.push_back(std::string());
+
+                    for (size_t head = 0; head < queue_paths.size(); ++head) {
+                        lua_rawgeti(L_, queue_index, static_cast<lua_Integer>(head + 1));
+                        int table_index = lua_gettop(L_);
+
+                        lua_pushnil(L_);
+                        while (lua_next(L_, table_index)) {
+                            int         vt  = lua_type(L_, -1);
+                            const void *ptr = lua_topointer(L_, -1);
+                            std::string segment;
+                            if ((LUA_TTABLE == vt || LUA_TFUNCTION == vt || LUA_TUSERDATA == vt) && paths_.end() == paths_.find(ptr) &&
+                                make_segment(-2, segment)) {
+                                std::string path = queue_paths[head];
+                                if (!path.empty()) {
+                                    path += '.';
+                                }
+                                path += segment;
+                                paths_[ptr] = path;
+
+                                if (LUA_TTABLE == vt) {
+                                    queue_paths.push_back(path);
+                                    lua_pushvalue(L_, -1);
+                                    lua_rawseti(L_, queue_index, static_cast<lua_Integer>(queue_paths.size()));
+                                }
+                            }
+                            lua_pop(L_, 1);
+                        }
+
+                        lua_pop(L_, 1);
+                    }
+
+                    lua_pop(L_, 1);
+                }
+
+                // 键转换为路径中的一段，不能用作路径的键返回false
+                // 注意lua_next遍历中不能对数字键调用lua_tolstring
+                bool make_segment(int index, std::string &out) {
+                    lua_Integer n = 0;
+                    if (lua_snapshot_to_index(L_, index, n)) {
+                        char buf[32];
+                        int  len = snprintf(buf, sizeof(buf), "%c%lld", LUA_SNAPSHOT_INDEX_MARK, static_cast<long long>(n));
+                        out.assign(buf, static_cast<size_t>(len));
+                        return true;
+                    }
+
+                    if (LUA_TSTRING != lua_type(L_, index)) {
+                        return false;
+                    }
+
+                    size_t      key_len = 0;
+                    const char *key     = lua_tolstring(L_, index, &key_len);
+                    if (0 == key_len || LUA_SNAPSHOT_INDEX_MARK == key[0] || NULL != memchr(key, '.', key_len)) {
+                        return false;
+                    }
+
+                    out.assign(key, key_len);
+                    return true;
+                }
+
+                uint32_t ref_object(int index) {
+                    const void *                                          ptr  = lua_topointer(L_, index);
+                    std::unordered_map<const void *, uint32_t>::iterator iter = ids_.find(ptr);
+                    if (iter != ids_.end()) {
+                        return iter->second;
+                    }
+
+                    uint32_t id = ++next_id_;
+                    ids_[ptr]   = id;
+                    lua_pushvalue(L_, index);
+                    lua_rawseti(L_, objs_index_, static_cast<lua_Integer>(id));
+                    return id;
+                }
+
+                void write_u32(uint32_t v) { body_.append(reinterpret_cast<const char *>(&v), sizeof(v)); }
+
+                void write_string(const char *s, size_t len) {
+                    write_u32(static_cast<uint32_t>(len));
+                    body_.append(s, len);
+                }
+
+                bool write_path(const void *ptr) {
+                    std::unordered_map<const void *, std::string>::iterator iter = paths_.find(ptr);
+                    if (iter == paths_.end()) {
+                        body_.push_back(0);
+                        return false;
+                    }
+
+                    body_.push_back(1);
+                    write_string(iter->second.data(), iter->second.size());
+                    return true;
+                }
+
+                void write_value(int index) {
+                    index = lua_absindex(L_, index);
+                    switch (lua_type(L_, index)) {
+                    case LUA_TNIL:
+                    case LUA_TNONE:
+                        body_.push_back(static_cast<char>(LST_NIL));
+                        break;
+                    case LUA_TBOOLEAN:
+                        body_.push_back(static_cast<char>(lua_toboolean(L_, index) ? LST_TRUE : LST_FALSE));
+                        break;
+                    case LUA_TNUMBER: {
+#if LUA_VERSION_NUM >= 503
+                        if (lua_isinteger(L_, index)) {
+                            lua_Integer v = lua_tointeger(L_, index);
+                            body_.push_back(static_cast<char>(LST_INTEGER));
+                            body_.append(reinterpret_cast<const char *>(&v), sizeof(v));
+                            break;
+                        }
+#endif
+                        lua_Number v = lua_tonumber(L_, index);
+                        body_.push_back(static_cast<char>(LST_NUMBER));
+                        body_.append(reinterpret_cast<const char *>(&v), sizeof(v));
+                        break;
+                    }
+                    case LUA_TSTRING: {
+                        size_t      len = 0;
+                        const char *s   = lua_tolstring(L_, index, &len);
+                        body_.push_back(static_cast<char>(LST_STRING));
+                        write_string(s, len);
+                        break;
+                    }
+                    case LUA_TTABLE:
+                    case LUA_TFUNCTION:
+                    case LUA_TUSERDATA:
+                        body_.push_back(static_cast<char>(LST_REF));
+                        write_u32(ref_object(index));
+                        break;
+                    default:
+                        if (error_.empty()) {
+                            error_ = std::string("snapshot failed, type ") + luaL_typename(L_, index) + " is not supported";
+                        }
+                        body_.push_back(static_cast<char>(LST_NIL));
+                        break;
+                    }
+                }
+
+                void write_object(uint32_t id, int index) {
+                    const void *ptr = lua_topointer(L_, index);
+                    switch (lua_type(L_, index)) {
+                    case LUA_TTABLE: {
+                        body_.push_back(static_cast<char>(LSK_TABLE));
+                        write_path(ptr);
+
+                        if (lua_getmetatable(L_, index)) {
+                            write_value(-1);
+                            lua_pop(L_, 1);
+                        } else {
+                            body_.push_back(static_cast<char>(LST_NIL));
+                        }
+
+                        // 先占位，遍历后回填键值对数量
+                        size_t count_pos = body_.size();
+                        write_u32(0);
+                        uint32_t count = 0;
+                        lua_pushnil(L_);
+                        while (lua_next(L_, index)) {
+                            write_value(-2);
+                            write_value(-1);
+                            ++count;
+                            lua_pop(L_, 1);
+                        }
+                        memcpy(&body_[count_pos], &count, sizeof(count));
+                        break;
+                    }
+                    case LUA_TFUNCTION: {
+                        if (lua_iscfunction(L_, index)) {
+                            body_.push_back(static_cast<char>(LSK_NATIVE));
+                            if (!write_path(ptr) && error_.empty()) {
+                                error_ = "snapshot failed, C function can not be accessed from _G";
+                            }
+                            break;
+                        }
+
+                        body_.push_back(static_cast<char>(LSK_FUNCTION));
+                        std::string dump;
+                        lua_pushvalue(L_, index);
+#if LUA_VERSION_NUM >= 503
+                        int dump_res = lua_dump(L_, lua_snapshot_dump_writer, &dump, 0);
+#else
+                        int dump_res = lua_dump(L_, lua_snapshot_dump_writer, &dump);
+#endif
+                        lua_pop(L_, 1);
+                        if (0 != dump_res && error_.empty()) {
+                            error_ = "snapshot failed, dump lua function failed";
+                        }
+                        write_string(dump.data(), dump.size());
+
+                        uint32_t nups = 0;
+                        while (NULL != lua_getupvalue(L_, index, static_cast<int>(nups + 1))) {
+                            lua_pop(L_, 1);
+                            ++nups;
+                        }
+                        write_u32(nups);
+
+                        for (uint32_t i = 1; i <= nups; ++i) {
+                            void *upid = lua_upvalueid(L_, index, static_cast<int>(i));
+
+                            std::unordered_map<void *, std::pair<uint32_t, uint32_t> >::iterator iter = upvalues_.find(upid);
+                            if (iter != upvalues_.end()) {
+                                body_.push_back(static_cast<char>(LST_JOIN));
+                                write_u32(iter->second.first);
+                                write_u32(iter->second.second);
+                                continue;
+                            }
+
+                            upvalues_[upid] = std::make_pair(id, i);
+                            body_.push_back(static_cast<char>(LST_UPVALUE));
+                            lua_getupvalue(L_, index, static_cast<int>(i));
+                            write_value(-1);
+                            lua_pop(L_, 1);
+                        }
+                        break;
+                    }
+                    default: {
+                        body_.push_back(static_cast<char>(LSK_NATIVE));
+                        if (!write_path(ptr) && error_.empty()) {
+                            error_ = "snapshot failed, userdata can not be accessed from _G";
+                        }
+                        break;
+                    }
+                    }
+                }
+
+            private:
+                lua_State *                                                     L_;
+                int                                                             objs_index_;
+                uint32_t                                                        next_id_;
+                std::string                                                     body_;
+                std::string                                                     error_;
+                std::unordered_map<const void *, std::string>                   paths_;
+                std::unordered_map<const void *, uint32_t>                      ids_;
+                std::unordered_map<void *, std::pair<uint32_t, uint32_t> >      upvalues_; // upvalue => (闭包id, 序号)
+            };
+
+            class lua_snapshot_reader {
+            public:
+                lua_snapshot_reader(lua_State *L, const char *data, size_t sz) : L_(L), cur_(data), end_(data + sz), objs_index_(0) {}
+
+                int run(std::string &error) {
+                    lua_snapshot_header expect_header;
+                    lua_snapshot_header header;
+                    if (end_ - cur_ < static_cast<ptrdiff_t>(sizeof(header))) {
+                        error = "restore snapshot failed, data too short";
+                        return -1;
+                    }
+                    memcpy(&header, cur_, sizeof(header));
+                    cur_ += sizeof(header);
+
+                    lua_snapshot_init_header(expect_header, header.object_count);
+                    if (0 != memcmp(&header, &expect_header, sizeof(header))) {
+                        error = "restore snapshot failed, header mismatch";
+                        return -1;
+                    }
+
+                    int top = lua_gettop(L_);
+                    luaL_checkstack(L_, 16, "lua snapshot");
+                    lua_createtable(L_, static_cast<int>(header.object_count), 0);
+                    objs_index_ = lua_gettop(L_);
+
+                    // 第一遍: 创建所有对象，已存在的table和native对象从当前的全局环境中获取
+                    std::vector<const char *> bodies;
+                    bodies.resize(header.object_count + 1, NULL);
+                    for (uint32_t id = 1; id <= header.object_count && error_.empty(); ++id) {
+                        create_object(id, bodies);
+                    }
+
+                    // 第二遍: 填充table内容和函数的upvalue
+                    for (uint32_t id = 1; id <= header.object_count && error_.empty(); ++id) {
+                        if (NULL == bodies[id]) {
+                            continue;
+                        }
+
+                        cur_ = bodies[id];
+                        lua_rawgeti(L_, objs_index_, static_cast<lua_Integer>(id));
+                        if (lua_istable(L_, -1)) {
+                            fill_table(lua_gettop(L_));
+                        } else {
+                            fill_function(lua_gettop(L_));
+                        }
+                        lua_settop(L_, objs_index_);
+                    }
+
+                    lua_settop(L_, top);
+                    if (!error_.empty()) {
+                        error.swap(error_);
+                        return -1;
+                    }
+
+                    return 0;
+                }
+
+            private:
+                bool read_u32(uint32_t &out) {
+                    if (end_ - cur_ < static_cast<ptrdiff_t>(sizeof(out))) {
+                        set_error("data truncated");
+                        return false;
+                    }
+                    memcpy(&out, cur_, sizeof(out));
+                    cur_ += sizeof(out);
+                    return true;
+                }
+
+                bool read_string(const char *&s, size_t &len) {
+                    uint32_t l32 = 0;
+                    if (!read_u32(l32)) {
+                        return false;
+                    }
+
+                    if (end_ - cur_ < static_cast<ptrdiff_t>(l32)) {
+                        set_error("data truncated");
+                        return false;
+                    }
+
+                    s   = cur_;
+                    len = l32;
+                    cur_ += l32;
+                    return true;
+                }
+
+                bool read_path(std::string &path, bool &has_path) {
+                    if (cur_ >= end_) {
+                        set_error("data truncated");
+                        return false;
+                    }
+
+                    has_path = 0 != *cur_++;
+                    if (!has_path) {
+                        return true;
+                    }
+
+                    const char *s   = NULL;
+                    size_t      len = 0;
+                    if (!read_string(s, len)) {
+                        return false;
+                    }
+                    path.assign(s, len);
+                    return true;
+                }
+
+                // 按路径在全局环境中查找对象并入栈，找不到时压入nil
+                void push_path(const std::string &path) {
+                    lua_pushglobaltable(L_);
+                    size_t start = 0;
+                    while (!path.empty() && start <= path.size() && !lua_isnil(L_, -1)) {
+                        size_t end = path.find('.', start);
+                        if (std::string::npos == end) {
+                            end = path.size();
+                        }
+
+                        if (!lua_istable(L_, -1)) {
+                            lua_pop(L_, 1);
+                            lua_pushnil(L_);
+                            break;
+                        }
+
+                        if (end > start && LUA_SNAPSHOT_INDEX_MARK == path[start]) {
+                            lua_Integer n = static_cast<lua_Integer>(strtoll(path.c_str() + start + 1, NULL, 10));
+                            lua_rawgeti(L_, -1, n);
+                        } else {
+                            lua_pushlstring(L_, path.data() + start, end - start);
+                            lua_rawget(L_, -2);
+                        }
+                        lua_remove(L_, -2);
+                        start = end + 1;
+                    }
+                }
+
+                // 读取并压入一个值，引用的对象必须已经创建
+                bool read_value() {
+                    if (cur_ >= end_) {
+                        set_error("data truncated");
+                        return false;
+                    }
+
+                    char tag = *cur_++;
+                    switch (tag) {
+                    case LST_NIL:
+                        lua_pushnil(L_);
+                        return true;
+                    case LST_FALSE:
+                        lua_pushboolean(L_, 0);
+                        return true;
+                    case LST_TRUE:
+                        lua_pushboolean(L_, 1);
+                        return true;
+                    case LST_INTEGER: {
+                        lua_Integer v;
+                        if (end_ - cur_ < static_cast<ptrdiff_t>(sizeof(v))) {
+                            set_error("data truncated");
+                            return false;
+                        }
+                        memcpy(&v, cur_, sizeof(v));
+                        cur_ += sizeof(v);
+                        lua_pushinteger(L_, v);
+                        return true;
+                    }
+                    case LST_NUMBER: {
+                        lua_Number v;
+                        if (end_ - cur_ < static_cast<ptrdiff_t>(sizeof(v))) {
+                            set_error("data truncated");
+                            return false;
+                        }
+                        memcpy(&v, cur_, sizeof(v));
+                        cur_ += sizeof(v);
+                        lua_pushnumber(L_, v);
+                        return true;
+                    }
+                    case LST_STRING: {
+                        const char *s   = NULL;
+                        size_t      len = 0;
+                        if (!read_string(s, len)) {
+                            return false;
+                        }
+                        lua_pushlstring(L_, s, len);
+                        return true;
+                    }
+                    case LST_REF: {
+                        uint32_t id = 0;
+                        if (!read_u32(id)) {
+                            return false;
+                        }
+                        lua_rawgeti(L_, objs_index_, static_cast<lua_Integer>(id));
+                        return true;
+                    }
+                    default:
+                        set_error("unknown value tag");
+                        return false;
+                    }
+                }
+
+                // 跳过一个值，第一遍时引用的对象可能还没有创建
+                bool skip_value() {
+                    if (cur_ >= end_) {
+                        set_error("data truncated");
+                        return false;
+                    }
+
+                    char tag = *cur_;
+                    if (LST_REF == tag) {
+                        uint32_t id = 0;
+                        ++cur_;
+                        return read_u32(id);
+                    }
+
+                    if (!read_value()) {
+                        return false;
+                    }
+                    lua_pop(L_, 1);
+                    return true;
+                }
+
+                void create_object(uint32_t id, std::vector<const char *> &bodies) {
+                    if (cur_ >= end_) {
+                        set_error("data truncated");
+                        return;
+                    }
+
+                    char        kind     = *cur_++;
+                    std::string path;
+                    bool        has_path = false;
+                    switch (kind) {
+                    case LSK_TABLE: {
+                        if (!read_path(path, has_path)) {
+                            return;
+                        }
+
+                        if (has_path) {
+                            push_path(path);
+                            if (!lua_istable(L_, -1)) {
+                                lua_pop(L_, 1);
+                                lua_newtable(L_);
+                            }
+                        } else {
+                            lua_newtable(L_);
+                        }
+                        lua_rawseti(L_, objs_index_, static_cast<lua_Integer>(id));
+
+                        bodies[id] = cur_;
+                        uint32_t count = 0;
+                        if (!skip_value() || !read_u32(count)) {
+                            return;
+                        }
+                        for (uint32_t i = 0; i < count && error_.empty(); ++i) {
+                            skip_value();
+                            skip_value();
+                        }
+                        break;
+                    }
+                    case LSK_FUNCTION: {
+                        const char *dump     = NULL;
+                        size_t      dump_len = 0;
+                        if (!read_string(dump, dump_len)) {
+                            return;
+                        }
+
+                        if (LUA_OK != luaL_loadbufferx(L_, dump, dump_len, "=snapshot", "b")) {
+                            set_error(lua_tostring(L_, -1));
+                            lua_pop(L_, 1);
+                            return;
+                        }
+                        lua_rawseti(L_, objs_index_, static_cast<lua_Integer>(id));
+
+                        bodies[id] = cur_;
+                        uint32_t nups = 0;
+                        if (!read_u32(nups)) {
+                            return;
+                        }
+                        for (uint32_t i = 0; i < nups && error_.empty(); ++i) {
+                            if (cur_ >= end_) {
+                                set_error("data truncated");
+                                return;
+                            }
+
+                            char tag = *cur_++;
+                            if (LST_JOIN == tag) {
+                                uint32_t v = 0;
+                                read_u32(v);
+                                read_u32(v);
+                            } else {
+                                skip_value();
+                            }
+                        }
+                        break;
+                    }
+                    case LSK_NATIVE: {
+                        if (!read_path(path, has_path)) {
+                            return;
+                        }
+
+                        if (!has_path) {
+                            set_error("native object without path");
+                            return;
+                        }
+
+                        push_path(path);
+                        if (lua_isnil(L_, -1)) {
+                            lua_pop(L_, 1);
+                            set_error(("native object " + path + " not found").c_str());
+                            return;
+                        }
+                        lua_rawseti(L_, objs_index_, static_cast<lua_Integer>(id));
+                        break;
+                    }
+                    default:
+                        set_error("unknown object kind");
+                        return;
+                    }
+                }
+
+                void fill_table(int index) {
+                    if (!read_value()) {
+                        return;
+                    }
+
+                    if (lua_istable(L_, -1)) {
+                        lua_setmetatable(L_, index);
+                    } else {
+                        lua_pop(L_, 1);
+                    }
+
+                    uint32_t count = 0;
+                    if (!read_u32(count)) {
+                        return;
+                    }
+
+                    for (uint32_t i = 0; i < count; ++i) {
+                        if (!read_value()) {
+                            return;
+                        }
+                        if (!read_value()) {
+                            lua_pop(L_, 1);
+                            return;
+                        }
+
+                        if (lua_isnil(L_, -2)) {
+                            lua_pop(L_, 2);
+                        } else {
+                            lua_rawset(L_, index);
+                        }
+                    }
+                }
+
+                void fill_function(int index) {
+                    uint32_t nups = 0;
+                    if (!read_u32(nups)) {
+                        return;
+                    }
+
+                    for (uint32_t i = 1; i <= nups; ++i) {
+                        if (cur_ >= end_) {
+                            set_error("data truncated");
+                            return;
+                        }
+
+                        char tag = *cur_++;
+                        if (LST_JOIN == tag) {
+                            uint32_t owner_id = 0, owner_n = 0;
+                            if (!read_u32(owner_id) || !read_u32(owner_n)) {
+                                return;
+                            }
+
+                            lua_rawgeti(L_, objs_index_, static_cast<lua_Integer>(owner_id));
+                            if (lua_isfunction(L_, -1) && !lua_iscfunction(L_, -1)) {
+                                lua_upvaluejoin(L_, index, static_cast<int>(i), -1, static_cast<int>(owner_n));
+                            }
+                            lua_pop(L_, 1);
+                            continue;
+                        }
+
+                        if (!read_value()) {
+                            return;
+                        }
+
+                        if (NULL == lua_setupvalue(L_, index, static_cast<int>(i))) {
+                            lua_pop(L_, 1);
+                        }
+                    }
+                }
+
+                void set_error(const char *msg) {
+                    if (error_.empty()) {
+                        error_ = std::string("restore snapshot failed, ") + (NULL == msg ? "unknown error" : msg);
+                    }
+                }
+
+            private:
+                lua_State * L_;
+                const char *cur_;
+                const char *end_;
+                int         objs_index_;
+                std::string error_;
+            };
+        } // namespace detail
+#endif
+
+        namespace fn {
+            int snapshot_state(lua_State *L, std::string &out) {
+#if LUA_VERSION_NUM >= 502
+                detail::lua_snapshot_writer writer(L);
+                int                         ret = writer.run(out);
+                if (0 != ret) {
+                    WLOGERROR("%s", out.c_str());
+                }
+                return ret;
+#else
+                out = "snapshot is not supported in lua 5.1";
+                WLOGERROR("%s", out.c_str());
+                return -1;
+#endif
+            }
+
+            int restore_state(lua_State *L, const char *data, size_t sz, std::string *error) {
+                std::string err;
+#if LUA_VERSION_NUM >= 502
+                detail::lua_snapshot_reader reader(L, data, sz);
+                int                         ret = reader.run(err);
+#else
+                err     = "snapshot is not supported in lua 5.1";
+                int ret = -1;
+#endif
+                if (0 != ret) {
+                    WLOGERROR("%s", err.c_str());
+                    if (NULL != error) {
+                        error->swap(err);
+                    }
+                }
+                return ret;
+            }
+        } // namespace fn
+    }     // namespace lua
+} // namespace script
@@ -0,0 +1,44 @@
+#ifndef SCRIPT_LUA_LUASTATESNAPSHOT
+#define SCRIPT_LUA_LUASTATESNAPSHOT
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+extern "C" {
+#include "lua.h"
+}
+
+namespace script {
+    namespace lua {
+        namespace fn {
+            /**
+             * @brief 把全局环境(_G及可以从_G访问到的所有对象)保存为快照
+             * @note table按对象图保存，共享和循环引用都会保留，metatable也会保存
+             * @note lua函数使用lua_dump保存，upvalue按值保存，多个闭包共享的upvalue恢复时会重新关联
+             * @note C函数、userdata和C模块的table按从_G访问的路径(字符串键或整数键，如package.searchers中的加载器)保存，
+             *       恢复时从新的lua_State相同路径获取
+             * @note 不支持coroutine和lightuserdata，只支持lua 5.2及以上版本
+             * @param L lua State
+             * @param out 输出快照数据
+             * @return 0或错误码，失败时错误信息写入out
+             */
+            int snapshot_state(lua_State *L, std::string &out);
+
+            /**
+             * @brief 把快照恢复到lua_State
+             * @note L必须已经完成了和生成快照时相同的native初始化(luaL_openlibs、扩展库和native绑定)
+             * @note 快照中的数据会合并到L已有的全局环境中，已有但快照中没有的字段会保留
+             * @param L lua State
+             * @param data 快照数据
+             * @param sz 快照数据长度
+             * @param error 失败时输出错误信息，可以为空
+             * @return 0或错误码
+             */
+            int restore_state(lua_State *L, const char *data, size_t sz, std::string *error = NULL);
+        } // namespace fn
+    }     // namespace lua
+} // namespace script
+
+#endif
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+extern "C" {
+#include "lauxlib.h"
+}
+
+#include <log/log_wrapper.h>
+
+#include "../lua_module/lua_adaptor.h"
+#include "lua_binding_utils.h"
+#include "lua_tick_scheduler.h"
+
+namespace script {
+    namespace lua {
+        lua_tick_scheduler::lua_tick_scheduler(constructor_helper &helper)
+            : state_(helper.L), fixed_step_(33000), max_steps_(4), frame_budget_(std::chrono::microseconds::zero()), accumulator_(0), now_(0),
+              timer_id_seq_(0), frame_begin_(std::chrono::steady_clock::now()) {
+            memset(&stats_, 0, sizeof(stats_));
+            memset(stale_counts_, 0, sizeof(stale_counts_));
+        }
+
+        // lua_State由lua_engine关闭，这里不再访问
+        lua_tick_scheduler::~lua_tick_scheduler() {}
+
+        lua_tick_scheduler::ptr_t lua_tick_scheduler::create(lua_State *L) {
+            if (NULL == L) {
+                return ptr_t();
+            }
+
+            constructor_helper helper;
+            helper.L = L;
+            return std::make_shared<lua_tick_scheduler>(helper);
+        }
+
+        void lua_tick_scheduler::set_fixed_step(std::chrono::microseconds step) {
+            if (step.count() <= 0) {
+                WLOGERROR("fixed step of lua tick scheduler must be positive");
+                return;
+            }
+
+            fixed_step_ = static_cast<int64_t>(step.count());
+        }
+
+        int64_t lua_tick_scheduler::add_timer(lua_State *L, lane_t lane, std::chrono::microseconds interval, bool loop) {
+            if (!lua_isfunction(L, -1)) {
+                WLOGERROR("add timer to lua tick scheduler require a function");
+                lua_pop(L, 1);
+                return 0;
+            }
+
+            if (lane < 0 || lane >= LTL_MAX) {
+                lane = LTL_NORMAL;
+            }
+
+            timer_data_t timer;
+            timer.id       = ++timer_id_seq_;
+            timer.ref      = luaL_ref(L, LUA_REGISTRYINDEX);
+            timer.interval = std::max<int64_t>(1, static_cast<int64_t>(interval.count()));
+            timer.due      = now_ + timer.interval;
+            timer.last     = now_;
+            timer.lane     = lane;
+            timer.loop     = loop;
+
+            timers_[timer.id] = timer;
+
+            schedule_t sch;
+            sch.due = timer.due;
+            sch.id  = timer.id;
+            schedules_[lane].push_back(sch);
+            std::push_heap(schedules_[lane].begin(), schedules_[lane].end(), schedule_greater());
+            return timer.id;
+        }
+
+        bool lua_tick_scheduler::remove_timer(int64_t id) {
+            std::unordered_map<int64_t, timer_data_t>::iterator iter = timers_.find(id);
+            if (iter == timers_.end()) {
+                return false;
+            }
+
+            // 堆里的记录在出堆时跳过，失效的记录超过一半时整理堆
+            lane_t lane = iter->second.lane;
+            luaL_unref(state_, LUA_REGISTRYINDEX, iter->second.ref);
+            timers_.erase(iter);
+
+            if (++stale_counts_[lane] * 2 > schedules_[lane].size()) {
+                compact(lane);
+            }
+            return true;
+        }
+
+        void lua_tick_scheduler::compact(lane_t lane) {
+            std::vector<schedule_t> &heap = schedules_[lane];
+            size_t                   keep = 0;
+            for (size_t i = 0; i < heap.size(); ++i) {
+                std::unordered_map<int64_t, timer_data_t>::const_iterator iter = timers_.find(heap[i].id);
+                if (iter != timers_.end() && iter->second.due == heap[i].due) {
+                    heap[keep++] = heap[i];
+                }
+            }
+
+            heap.resize(keep);
+            std::make_heap(heap.begin(), heap.end(), schedule_greater());
+            stale_counts_[lane] = 0;
+        }
+
+        void lua_tick_scheduler::clear() {
+            for (std::unordered_map<int64_t, timer_data_t>::iterator iter = timers_.begin(); iter != timers_.end(); ++iter) {
+                luaL_unref(state_, LUA_REGISTRYINDEX, iter->second.ref);
+            }
+            timers_.clear();
+
+            for (int i = 0; i < LTL_MAX; ++i) {
+                schedules_[i].clear();
+                stale_counts_[i] = 0;
+            }
+        }
+
+        uint32_t lua_tick_scheduler::advance(std::chrono::microseconds delta) {
+            frame_begin_ = std::chrono::steady_clock::now();
+            ++stats_.frame_count;
+
+            if (delta.count() > 0) {
+                accumulator_ += static_cast<int64_t>(delta.count());
+            }
+
+            int64_t steps = accumulator_ / fixed_step_;
+            accumulator_ -= steps * fixed_step_;
+
+            // 不追帧，超出的步数直接丢弃
+            if (max_steps_ > 0 && steps > static_cast<int64_t>(max_steps_)) {
+                stats_.dropped_steps += static_cast<uint64_t>(steps - max_steps_);
+                steps = static_cast<int64_t>(max_steps_);
+            }
+
+            now_ += steps * fixed_step_;
+            stats_.step_count += static_cast<uint64_t>(steps);
+            return static_cast<uint32_t>(steps);
+        }
+
+        size_t lua_tick_scheduler::fire() {
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            size_t                                ret   = 0;
+
+            for (int i = 0; i < LTL_MAX; ++i) {
+                lane_t lane       = static_cast<lane_t>(i);
+                size_t lane_fired = 0;
+                bool   has_budget = LTL_CRITICAL != lane && frame_budget_.count() > 0;
+                while (true) {
+                    if (has_budget && std::chrono::steady_clock::now() - frame_begin_ >= frame_budget_ &&
+                        (LTL_DEFERRABLE == lane || lane_fired > 0)) {
+                        stats_.deferred_count += count_due(lane);
+                        break;
+                    }
+
+                    if (!fire_one(lane)) {
+                        break;
+                    }
+                    ++lane_fired;
+                }
+
+                ret += lane_fired;
+            }
+
+            std::chrono::nanoseconds cost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+            if (cost > stats_.max_fire_time) {
+                stats_.max_fire_time = cost;
+            }
+            return ret;
+        }
+
+        bool lua_tick_scheduler::fire_one(lane_t lane) {
+            std::vector<schedule_t> &heap = schedules_[lane];
+            while (!heap.empty() && heap.front().due <= now_) {
+                schedule_t sch = heap.front();
+                std::pop_heap(heap.begin(), heap.end(), schedule_greater());
+                heap.pop_back();
+
+                std::unordered_map<int64_t, timer_data_t>::iterator iter = timers_.find(sch.id);
+                if (iter == timers_.end() || iter->second.due != sch.due) {
+                    if (stale_counts_[lane] > 0) {
+                        --stale_counts_[lane];
+                    }
+                    continue;
+                }
+
+                // 回调中可能添加或移除定时器，先更新状态再调用
+                timer_data_t &timer   = iter->second;
+                int64_t       elapsed = now_ - timer.last;
+                int           ref     = timer.ref;
+                bool          loop    = timer.loop;
+
+                lua_State *         L = state_;
+                lua::lua_auto_block block(L);
+                int                 hmsg = fn::get_pcall_hmsg(L);
+                lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+
+                if (loop) {
+                    int64_t next = timer.due + timer.interval;
+                    // 错过多个周期时合并为一次，从当前时间重新计时
+                    if (next <= now_) {
+                        stats_.coalesced_count += static_cast<uint64_t>((now_ - timer.due) / timer.interval);
+                        next = now_ + timer.interval;
+                    }
+
+                    timer.due  = next;
+                    timer.last = now_;
+
+                    sch.due = next;
+                    heap.push_back(sch);
+                    std::push_heap(heap.begin(), heap.end(), schedule_greater());
+                } else {
+                    timers_.erase(iter);
+                    luaL_unref(L, LUA_REGISTRYINDEX, ref);
+                }
+
+                ++stats_.fired_count;
+                lua_pushnumber(L, static_cast<lua_Number>(elapsed) / 1000000.0);
+                if (0 != lua_pcall(L, 1, 0, hmsg)) {
+                    ++stats_.error_count;
+                    const char *msg = lua_tostring(L, -1);
+                    WLOGERROR("[Lua]: tick timer %lld failed.\n%s", static_cast<long long>(sch.id), NULL == msg ? "unknown error" : msg);
+                }
+                return true;
+            }
+
+            return false;
+        }
+
+        size_t lua_tick_scheduler::count_due(lane_t lane) const {
+            size_t                         ret  = 0;
+            const std::vector<schedule_t> &heap = schedules_[lane];
+            for (size_t i = 0; i < heap.size(); ++i) {
+                if (heap[i].due > now_) {
+                    continue;
+                }
+
+                std::unordered_map<int64_t, timer_data_t>::const_iterator iter = timers_.find(heap[i].id);
+                if (iter != timers_.end() && iter->second.due == heap[i].due) {
+                    ++ret;
+                }
+            }
+
+            return ret;
+        }
+
+        void lua_tick_scheduler::openlib(lua_State *L, lua_tick_scheduler *self) {
+            int top = lua_gettop(L);
+
+            luaL_Reg lib_funcs[] = {{"add_timer", lua_add_timer}, {"remove_timer", lua_remove_timer}, {NULL, NULL}};
+
+            lua_createtable(L, 0, 5);
+            for (luaL_Reg *reg = lib_funcs; NULL != reg->name; ++reg) {
+                lua_pushlightuserdata(L, self);
+                lua_pushcclosure(L, reg->func, 1);
+                lua_setfield(L, -2, reg->name);
+            }
+
+            lua_pushinteger(L, LTL_CRITICAL);
+            lua_setfield(L, -2, "CRITICAL");
+            lua_pushinteger(L, LTL_NORMAL);
+            lua_setfield(L, -2, "NORMAL");
+            lua_pushinteger(L, LTL_DEFERRABLE);
+            lua_setfield(L, -2, "DEFERRABLE");
+            lua_setglobal(L, "tick_scheduler");
+
+            lua_settop(L, top);
+        }
+
+        // id = tick_scheduler.add_timer(interval_ms, fn[, lane[, loop]])
+        int lua_tick_scheduler::lua_add_timer(lua_State *L) {
+            lua_tick_scheduler *self     = reinterpret_cast<lua_tick_scheduler *>(lua_touserdata(L, lua_upvalueindex(1)));
+            lua_Number          interval = luaL_checknumber(L, 1);
+            luaL_checktype(L, 2, LUA_TFUNCTION);
+            lua_Integer lane = luaL_optinteger(L, 3, LTL_NORMAL);
+            bool        loop = lua_toboolean(L, 4) ? true : false;
+            // NaN、inf和超出int64_t的值转换后是未定义行为，先检查范围，并为到期时间的累加保留余量
+            luaL_argcheck(L, interval >= 0 && interval <= static_cast<lua_Number>(std::numeric_limits<int64_t>::max() / 4000), 1, "invalid interval");
+            // 先检查范围再转换，超出int32_t的值转换后可能落回合法范围
+            luaL_argcheck(L, lane >= LTL_CRITICAL && lane < LTL_MAX, 3, "invalid lane");
+
+            if (NULL == self) {
+                lua_pushnil(L);
+                return 1;
+            }
+
+            lua_pushvalue(L, 2);
+            int64_t id = self->add_timer(L, static_cast<lane_t>(lane), std::chrono::microseconds(static_cast<int64_t>(interval * 1000)), loop);
+            if (0 == id) {
+                lua_pushnil(L);
+            } else {
+                lua_pushinteger(L, static_cast<lua_Integer>(id));
+            }
+            return 1;
+        }
+
+        // ok = tick_scheduler.remove_timer(id)
+        int lua_tick_scheduler::lua_remove_timer(lua_State *L) {
+            lua_tick_scheduler *self = reinterpret_cast<lua_tick_scheduler *>(lua_touserdata(L, lua_upvalueindex(1)));
+            lua_Integer         id   = luaL_checkinteger(L, 1);
+
+            lua_pushboolean(L, (NULL != self && self->remove_timer(static_cast<int64_t>(id))) ? 1 : 0);
+            return 1;
+        }
+    } // namespace lua
+} // namespace script
@@ -0,0 +1,192 @@
+#ifndef SCRIPT_LUA_LUATICKSCHEDULER
+#define SCRIPT_LUA_LUATICKSCHEDULER
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include "lua.h"
+}
+
+#include <design_pattern/noncopyable.h>
+
+namespace script {
+    namespace lua {
+
+        /**
+         * 固定步长的tick调度器
+         * advance()把帧间隔累积为固定步长，一帧最多执行max_steps步，超出的部分直接丢弃，不再追帧
+         * fire()按通道顺序触发到期的定时器:
+         *   LTL_CRITICAL   总是触发所有到期的定时器
+         *   LTL_NORMAL     帧预算用完后停止，但每帧至少触发一个，不会饿死
+         *   LTL_DEFERRABLE 只在帧预算有剩余时触发
+         * 没有触发的定时器保持到期状态，留到下一帧
+         * 循环定时器错过多个周期时只触发一次，参数为实际经过的时间，下一次从当前时间重新计时
+         * lua中可以通过全局表tick_scheduler使用:
+         * @code
+         *     local id = tick_scheduler.add_timer(interval_ms, function(elapsed) end, lane, loop)
+         *     tick_scheduler.remove_timer(id)
+         * @endcode
+         * lua中传入不存在的lane会报参数错误，C++接口中越界的lane按LTL_NORMAL处理
+         * lua中的interval_ms必须是有限的非负数，NaN、inf、负数和过大的值会报参数错误
+         * @note 非线程安全，只能在lua_engine所在的线程使用
+         */
+        class lua_tick_scheduler : public ::util::design_pattern::noncopyable {
+        public:
+            typedef std::shared_ptr<lua_tick_scheduler> ptr_t;
+
+            // 固定底层类型，越界的值也能可靠地做范围检查
+            enum lane_t : int32_t {
+                LTL_CRITICAL = 0,
+                LTL_NORMAL,
+                LTL_DEFERRABLE,
+                LTL_MAX,
+            };
+
+            struct stats_t {
+                uint64_t                 frame_count;     // advance()次数
+                uint64_t                 step_count;      // 执行的固定步数
+                uint64_t                 dropped_steps;   // 超出max_steps被丢弃的步数
+                uint64_t                 fired_count;     // 触发的定时器数
+                uint64_t                 coalesced_count; // 循环定时器被合并的周期数
+                uint64_t                 deferred_count;  // 因为帧预算推迟到下一帧的定时器数
+                uint64_t                 error_count;     // 回调出错次数
+                std::chrono::nanoseconds max_fire_time;   // 单次fire()的最大耗时
+            };
+
+        private:
+            struct constructor_helper {
+                lua_State *L;
+            };
+
+            struct timer_data_t {
+                int64_t id;
+                int     ref;      // 回调函数的registry引用
+                int64_t interval; // 微秒
+                int64_t due;      // 到期的虚拟时间(微秒)
+                int64_t last;     // 上一次触发的虚拟时间(微秒)
+                lane_t  lane;
+                bool    loop;
+            };
+
+            struct schedule_t {
+                int64_t due;
+                int64_t id;
+            };
+
+            struct schedule_greater {
+                inline bool operator()(const schedule_t &l, const schedule_t &r) const {
+                    return l.due != r.due ? l.due > r.due : l.id > r.id;
+                }
+            };
+
+        public:
+            lua_tick_scheduler(constructor_helper &helper);
+            ~lua_tick_scheduler();
+
+            static ptr_t create(lua_State *L);
+
+            /**
+             * @brief 设置固定步长，默认为33毫秒
+             */
+            void set_fixed_step(std::chrono::microseconds step);
+
+            inline std::chrono::microseconds get_fixed_step() const { return std::chrono::microseconds(fixed_step_); }
+
+            /**
+             * @brief 设置一帧最多执行的步数，默认为4，0表示不限制
+             */
+            inline void set_max_steps(uint32_t max_steps) { max_steps_ = max_steps; }
+
+            /**
+             * @brief 设置fire()中非关键通道的时间预算，默认为0(不限制)
+             * @note 预算从advance()开始计算，包含固定步长的更新耗时
+             */
+            inline void set_frame_budget(std::chrono::microseconds budget) { frame_budget_ = budget; }
+
+            /**
+             * @brief 添加定时器，回调函数在栈顶，调用后出栈
+             * @param L 这个lua_State或它的协程
+             * @param lane 优先级通道
+             * @param interval 间隔
+             * @param loop 是否循环
+             * @return 定时器id，失败返回0
+             */
+            int64_t add_timer(lua_State *L, lane_t lane, std::chrono::microseconds interval, bool loop);
+
+            /**
+             * @brief 移除定时器
+             * @return 定时器存在时返回true
+             */
+            bool remove_timer(int64_t id);
+
+            void clear();
+
+            /**
+             * @brief 开始一帧，累积帧间隔
+             * @param delta 帧间隔
+             * @return 这一帧需要执行的固定步数
+             */
+            uint32_t advance(std::chrono::microseconds delta);
+
+            /**
+             * @brief 触发到期的定时器
+             * @return 触发的定时器数
+             */
+            size_t fire();
+
+            /**
+             * @brief 获取虚拟时间
+             */
+            inline std::chrono::microseconds get_now() const { return std::chrono::microseconds(now_); }
+
+            inline size_t size() const { return timers_.size(); }
+
+            inline const stats_t &get_stats() const { return stats_; }
+
+            /**
+             * @brief 在lua中注册全局表tick_scheduler
+             */
+            static void openlib(lua_State *L, lua_tick_scheduler *self);
+
+        private:
+            /**
+             * @brief 触发通道中最早到期的定时器
+             * @return 没有到期的定时器时返回false
+             */
+            bool fire_one(lane_t lane);
+
+            size_t count_due(lane_t lane) const;
+
+            /**
+             * @brief 移除堆中已经失效的记录
+             */
+            void compact(lane_t lane);
+
+            static int lua_add_timer(lua_State *L);
+            static int lua_remove_timer(lua_State *L);
+
+        private:
+            lua_State *                               state_;
+            int64_t                                   fixed_step_;
+            uint32_t                                  max_steps_;
+            std::chrono::microseconds                 frame_budget_;
+            int64_t                                   accumulator_;
+            int64_t                                   now_;
+            int64_t                                   timer_id_seq_;
+            std::chrono::steady_clock::time_point     frame_begin_;
+            std::unordered_map<int64_t, timer_data_t> timers_;
+            std::vector<schedule_t>                   schedules_[LTL_MAX]; // 按到期时间排列的最小堆
+            size_t                                    stale_counts_[LTL_MAX]; // 堆中被移除的定时器留下的记录数
+            stats_t                                   stats_;
+        };
+    } // namespace lua
+} // namespace script
+
+#endif